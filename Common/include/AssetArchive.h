@@ -0,0 +1,60 @@
+#ifndef ASSETARCHIVE_H_
+#define ASSETARCHIVE_H_
+#include "AssetArchiveFormat.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AssetArchive.h
+/// @brief read only view of an archive built by the PackAssets tool. The whole file is memory mapped once and
+/// find() hands back views straight into the mapping so nothing is copied or re-read.
+/// @class AssetArchive
+//----------------------------------------------------------------------------------------------------------------------
+class AssetArchive
+{
+public :
+  AssetArchive() = default;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map the archive, check isOpen() to see if it worked
+  /// @param[in] _fname the archive to map
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit AssetArchive(const std::string &_fname);
+  ~AssetArchive();
+  AssetArchive(const AssetArchive &) = delete;
+  AssetArchive &operator=(const AssetArchive &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map an archive, any previous one is closed first
+  /// @param[in] _fname the archive to map
+  /// @param[in] _verify if true re-hash every entry and refuse archives that don't match
+  /// @returns true if the archive is usable
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open(const std::string &_fname, bool _verify = false);
+  void close();
+  bool isOpen() const { return m_data != nullptr; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief look up an entry by its path in the archive (e.g. "shaders/TextureVert.glsl")
+  /// @returns a view of the payload inside the mapping or an empty view if not present, the view is valid
+  /// until the archive is closed
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string_view find(std::string_view _name) const;
+  bool contains(std::string_view _name) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief re-hash an entry and compare against the stored hash, always true if the archive has no hashes
+  //----------------------------------------------------------------------------------------------------------------------
+  bool verify(std::string_view _name) const;
+  size_t numEntries() const;
+  std::string_view entryName(size_t _index) const;
+
+private :
+  const ArchiveEntry *findEntry(std::string_view _name) const;
+  bool validate(bool _verify) const;
+  const unsigned char *m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ASSETARCHIVEFORMAT_H_
+#define ASSETARCHIVEFORMAT_H_
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AssetArchiveFormat.h
+/// @brief on disk layout of the packed asset archive shared by the PackAssets tool and the runtime reader.
+/// The file is
+///   ArchiveHeader
+///   ArchiveEntry[entryCount] sorted by name so we can binary search
+///   name strings (not null terminated)
+///   payloads, each starting on an ARCHIVE_ALIGNMENT boundary
+/// All values are little endian, which is all we build for.
+//----------------------------------------------------------------------------------------------------------------------
+constexpr char ARCHIVE_MAGIC[4] = {'N', 'G', 'L', 'A'};
+constexpr uint32_t ARCHIVE_VERSION = 1;
+constexpr uint64_t ARCHIVE_ALIGNMENT = 64;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief set in ArchiveHeader::flags when every entry carries a content hash
+//----------------------------------------------------------------------------------------------------------------------
+constexpr uint32_t ARCHIVE_HAS_HASHES = 1;
+
+struct ArchiveHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t flags;
+  uint64_t namesOffset;
+  uint64_t namesSize;
+};
+
+struct ArchiveEntry
+{
+  uint64_t offset;
+  uint64_t size;
+  uint64_t hash;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+};
+
+static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader must be tightly packed");
+static_assert(sizeof(ArchiveEntry) == 32, "ArchiveEntry must be tightly packed");
+
+#endif
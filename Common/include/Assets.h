@@ -0,0 +1,44 @@
+#ifndef ASSETS_H_
+#define ASSETS_H_
+#include "AssetArchive.h"
+#include <string>
+#include <string_view>
+#include <QImage>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Assets.h
+/// @brief static access to the demo's packed asset archive, in the same style as ngl::ShaderLib. If no archive
+/// is mounted (or an entry is missing) the loaders fall back to the loose files so shaders can still be edited
+/// without re-packing.
+/// @class Assets
+//----------------------------------------------------------------------------------------------------------------------
+class Assets
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map the archive for this demo, in debug builds the content hashes are checked as well
+  /// @param[in] _fname the archive built by add_asset_archive (e.g. Cube.assets)
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool mount(const std::string &_fname);
+  static void unmount();
+  static const AssetArchive &archive();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the raw bytes of an asset, empty if it is not in the archive
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::string_view read(std::string_view _fname);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replacement for ngl::ShaderLib::loadShaderSource that reads from the archive when it can
+  //----------------------------------------------------------------------------------------------------------------------
+  static void loadShaderSource(std::string_view _shaderName, const std::string &_fname);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decode an image directly from the mapped bytes, falls back to QImage::load
+  /// @param[in] _fname path of the image relative to the demo (e.g. textures/crate.bmp)
+  /// @param[out] o_image the decoded image
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool loadImage(const std::string &_fname, QImage &o_image);
+
+private :
+  static AssetArchive s_archive;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BATCHTRANSFORM_H_
+#define BATCHTRANSFORM_H_
+#include <ngl/Mat4.h>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BatchTransform.h
+/// @brief builds model or MVP matrices for many instances at once. The positions and Euler rotations are held as
+/// structure of arrays, so each Float4 lane is one instance and four instances go through the kernel together,
+/// including a vectorised sin / cos. Results are written back as ordinary ngl::Mat4s. The rotation order matches
+/// ngl::Transformation (X then Y then Z, in degrees), so the batch can replace a per instance
+/// reset / setRotation / setPosition / getMatrix loop.
+/// @class BatchTransform
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformArrays
+{
+  std::vector<float> px, py, pz;
+  std::vector<float> rx, ry, rz;
+  void resize(size_t _count);
+  size_t size() const {return px.size();}
+};
+
+class BatchTransform
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief below this many instances the whole-array versions don't use the ThreadPool
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t PARALLEL_MIN = 8192;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief model matrices for instances [_begin,_end) written to o_models[0.._end-_begin), on the calling thread
+  //----------------------------------------------------------------------------------------------------------------------
+  static void models(const TransformArrays &_in, size_t _begin, size_t _end, ngl::Mat4 *o_models);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _viewProject * model for instances [_begin,_end), on the calling thread
+  //----------------------------------------------------------------------------------------------------------------------
+  static void mvps(const TransformArrays &_in, size_t _begin, size_t _end, const ngl::Mat4 &_viewProject,
+                   ngl::Mat4 *o_mvps);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief every instance, split over the ThreadPool once there are PARALLEL_MIN or more
+  //----------------------------------------------------------------------------------------------------------------------
+  static void models(const TransformArrays &_in, ngl::Mat4 *o_models);
+  static void mvps(const TransformArrays &_in, const ngl::Mat4 &_viewProject, ngl::Mat4 *o_mvps);
+};
+
+#endif
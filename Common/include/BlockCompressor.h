@@ -0,0 +1,106 @@
+#ifndef BLOCKCOMPRESSOR_H_
+#define BLOCKCOMPRESSOR_H_
+#include <ngl/Types.h>
+#include "TextureStorage.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BlockCompressor.h
+/// @brief CPU encoder for the 4x4 block compressed texture formats. Blocks are independent so each image is
+/// split into rows of blocks and encoded across the ThreadPool. Results are cached in the TextureCache so a
+/// texture is only ever compressed once.
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the supported block formats
+/// BC1 RGB (+1 bit alpha) 4bpp, BC3 RGBA 8bpp, BC4 single channel 4bpp, BC5 two channel 8bpp (normal maps)
+/// BC7 RGBA 8bpp, only mode 6 (single subset, 4 bit indices) is emitted which is what most fast encoders use
+//----------------------------------------------------------------------------------------------------------------------
+enum class BlockFormat : uint32_t
+{
+  BC1,
+  BC3,
+  BC4,
+  BC5,
+  BC7
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief Fast fits endpoints to the bounding box, High uses the principal axis plus a least squares refit
+//----------------------------------------------------------------------------------------------------------------------
+enum class CompressionQuality : uint32_t
+{
+  Fast,
+  High
+};
+
+struct CompressedLevel
+{
+  int width;
+  int height;
+  std::vector<unsigned char> data;
+};
+
+struct CompressedTexture
+{
+  BlockFormat format;
+  std::vector<CompressedLevel> levels;
+  size_t sizeInBytes() const;
+};
+
+class BlockCompressor
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bytes per 4x4 block, 8 for BC1/BC4 16 for the rest
+  //----------------------------------------------------------------------------------------------------------------------
+  static size_t blockBytes(BlockFormat _format);
+  static GLenum internalFormat(BlockFormat _format);
+  static const char *name(BlockFormat _format);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief check the current context can sample the format (S3TC is an extension, BPTC needs GL 4.2)
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool isSupported(BlockFormat _format);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compress a single image
+  /// @param[in] _pixels 8 bit per channel pixels, rows top to bottom
+  /// @param[in] _width,_height image size, doesn't need to be a multiple of 4
+  /// @param[in] _channels 1 (grey), 2, 3 or 4, missing channels read as 0 and missing alpha as 255
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::vector<unsigned char> compress(const unsigned char *_pixels, int _width, int _height, int _channels,
+                                             BlockFormat _format, CompressionQuality _quality);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief box filter a full mip chain and compress every level, served from the TextureCache if the same
+  /// pixels have been compressed with the same settings before
+  //----------------------------------------------------------------------------------------------------------------------
+  static CompressedTexture compressMipChain(const unsigned char *_pixels, int _width, int _height, int _channels,
+                                            BlockFormat _format, CompressionQuality _quality);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create a GL_TEXTURE_2D with all the levels, returns 0 if the format isn't supported
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLuint createTexture(const CompressedTexture &_texture, const SamplerState &_sampler = SamplerState());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the compressed version of TextureStorage::createFromFile. The image is compressed with
+  /// compressMipChain, or uploaded as mip mapped RGBA8 when the context can't sample _format
+  /// @param[out] o_compressed whether _format was used, o_bytes the size of every level as uploaded
+  /// @returns the texture id or 0 if the image could not be loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLuint createFromFile(const std::string &_fname, BlockFormat _format, CompressionQuality _quality, bool &o_compressed,
+                               size_t &o_bytes, const SamplerState &_sampler = SamplerState());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief (de)serialise for the cache
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::vector<unsigned char> serialise(const CompressedTexture &_texture);
+  static bool deserialise(const std::vector<unsigned char> &_data, CompressedTexture &o_texture);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CUBEIMAGE_H_
+#define CUBEIMAGE_H_
+#include "Float4.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file CubeImage.h
+/// @brief six square faces of linear RGBA float texels in GL face order (+X -X +Y -Y +Z -Z) used by the CPU
+/// environment processing (prefiltering, SH projection, conversion). Face coordinates follow the GL spec so
+/// texel (0,0) is the first texel uploaded for each face.
+/// @class CubeImage
+//----------------------------------------------------------------------------------------------------------------------
+class CubeImage
+{
+public :
+  CubeImage() = default;
+  explicit CubeImage(int _size);
+  int size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  float *texel(int _face, int _x, int _y) { return &m_data[index(_face, _x, _y)]; }
+  const float *texel(int _face, int _x, int _y) const { return &m_data[index(_face, _x, _y)]; }
+  float *face(int _face) { return texel(_face, 0, 0); }
+  const float *face(int _face) const { return texel(_face, 0, 0); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief unit direction through face position _s,_t (0-1 across the face)
+  //----------------------------------------------------------------------------------------------------------------------
+  static void direction(int _face, float _s, float _t, float o_dir[3]);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the face a direction hits and where on it (0-1), the inverse of direction
+  //----------------------------------------------------------------------------------------------------------------------
+  static void faceCoordinates(const float _dir[3], int &o_face, float &o_s, float &o_t);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief solid angle covered by texel _x,_y of a _size face, all of them sum to 4 pi
+  //----------------------------------------------------------------------------------------------------------------------
+  static float texelSolidAngle(int _x, int _y, int _size);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bilinear lookup inside one face, clamped to the face edge
+  //----------------------------------------------------------------------------------------------------------------------
+  Float4 sampleFace(int _face, float _s, float _t) const;
+  Float4 sample(const float _dir[3]) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build from six 8 bit faces (1-4 channels), _srgb decodes the gamma 2.2 curve to linear
+  //----------------------------------------------------------------------------------------------------------------------
+  static CubeImage fromBytes(const std::array<const unsigned char *, 6> &_faces, int _size, int _channels, bool _srgb);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write one face as RGBA8, clamping to 0-1 and re-applying gamma if _srgb is set
+  //----------------------------------------------------------------------------------------------------------------------
+  void toBytes(int _face, unsigned char *o_pixels, bool _srgb) const;
+
+private :
+  size_t index(int _face, int _x, int _y) const
+  {
+    return ((size_t(_face) * size_t(m_size) + size_t(_y)) * size_t(m_size) + size_t(_x)) * 4;
+  }
+  int m_size = 0;
+  std::vector<float> m_data;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a cube image and its mips, level 0 first
+//----------------------------------------------------------------------------------------------------------------------
+using CubeChain = std::vector<CubeImage>;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief filter _base down to 1x1 across the face edges (CubeMipBuilder)
+//----------------------------------------------------------------------------------------------------------------------
+CubeChain buildCubeChain(const CubeImage &_base);
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief trilinear lookup in a chain, _lod is clamped to the levels present
+//----------------------------------------------------------------------------------------------------------------------
+Float4 sampleCubeChain(const CubeChain &_chain, const float _dir[3], float _lod);
+
+#endif
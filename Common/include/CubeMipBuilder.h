@@ -0,0 +1,45 @@
+#ifndef CUBEMIPBUILDER_H_
+#define CUBEMIPBUILDER_H_
+#include "CubeImage.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file CubeMipBuilder.h
+/// @brief CPU mip chain for cube maps that filters across face edges. glGenerateMipmap and a plain 2x2 box
+/// treat each face as a separate 2D image, so the low mips of neighbouring faces drift apart and seams show
+/// even with GL_TEXTURE_CUBE_MAP_SEAMLESS. Here each level is a 4x4 tent of the level above, and taps that
+/// fall off a face are read from the neighbouring face through an adjacency table.
+/// @class CubeMipBuilder
+//----------------------------------------------------------------------------------------------------------------------
+class CubeMipBuilder
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief face edges in texel space, Left is x < 0, Right x >= size, Top y < 0 and Bottom y >= size
+  //----------------------------------------------------------------------------------------------------------------------
+  enum Edge { Left, Right, Top, Bottom };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the face across an edge, the edge of that face we come in through and whether the position
+  /// along the edge runs the other way
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Neighbour
+  {
+    int face;
+    int edge;
+    bool flip;
+  };
+  static const Neighbour &neighbour(int _face, int _edge);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief texel lookup that may step up to a face width off the face, the 3 face corners clamp
+  //----------------------------------------------------------------------------------------------------------------------
+  static const float *fetch(const CubeImage &_image, int _face, int _x, int _y);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief half size level, rows of all six faces are spread over the ThreadPool
+  //----------------------------------------------------------------------------------------------------------------------
+  static CubeImage downsample(const CubeImage &_image);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _base and _levels-1 mips below it, 0 goes down to 1x1
+  //----------------------------------------------------------------------------------------------------------------------
+  static CubeChain build(const CubeImage &_base, int _levels = 0);
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CULLGRID_H_
+#define CULLGRID_H_
+#include "BatchTransform.h"
+#include "Frustum.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file CullGrid.h
+/// @brief CPU frustum culling for large static instance sets. The instances are bucketed once into a power of two
+/// grid of cells on the XZ plane and sorted into Morton (Z) order of their cells. Each cell and each 2x2, 4x4 ...
+/// block of cells above it is then one contiguous range of instances. Culling walks that quadtree, testing the
+/// four children of a node together in one Float4 pass per plane. A node fully inside the frustum is accepted
+/// whole without visiting its children, and one fully outside is dropped with them, so the cost follows the number
+/// of cells the frustum edges cross rather than the number of instances.
+/// @class CullGrid
+//----------------------------------------------------------------------------------------------------------------------
+struct CullRange
+{
+  uint32_t first;
+  uint32_t count;
+};
+
+class CullGrid
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bucket the instances and sort io_instances into cell order
+  /// @param[in] _radius bounding radius of every instance around its position
+  /// @param[in] _leafInstances rough number of instances per leaf cell
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(TransformArrays &io_instances, float _radius, size_t _leafInstances = 64);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the sort done by build, order()[slot] is the index the instance had before
+  //----------------------------------------------------------------------------------------------------------------------
+  const std::vector<uint32_t> &order() const {return m_order;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ranges of the sorted instances whose cells touch the frustum, neighbouring ranges are merged
+  //----------------------------------------------------------------------------------------------------------------------
+  void cull(const Frustum &_frustum, std::vector<CullRange> &o_ranges);
+  size_t numLeaves() const {return m_levels.empty() ? 0 : m_levels.back().first.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief nodes bounds-tested by the last cull, for the stats overlay
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t nodesTested() const {return m_nodesTested;}
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one quadtree level as structure of arrays, 4^level nodes in Morton order so the children of node n are
+  /// 4n .. 4n+3 of the next level
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Level
+  {
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    std::vector<uint32_t> first, end;
+  };
+  std::vector<Level> m_levels;
+  std::vector<uint32_t> m_order;
+  size_t m_nodesTested = 0;
+  void cullChildren(const Frustum &_frustum, size_t _level, size_t _parent, std::vector<CullRange> &o_ranges);
+  static void addRange(std::vector<CullRange> &o_ranges, uint32_t _first, uint32_t _end);
+};
+
+#endif
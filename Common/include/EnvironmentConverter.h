@@ -0,0 +1,55 @@
+#ifndef ENVIRONMENTCONVERTER_H_
+#define ENVIRONMENTCONVERTER_H_
+#include "CubeImage.h"
+#include "FloatImage.h"
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief reconstruction filter used when resampling, Cubic is Catmull-Rom (sharper, 16 taps)
+//----------------------------------------------------------------------------------------------------------------------
+enum class Resample : uint32_t
+{
+  Bilinear,
+  Cubic
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file EnvironmentConverter.h
+/// @brief conversion between the environment layouts, equirectangular (latitude / longitude) panoramas, cube
+/// maps and octahedral maps. Every output texel is mapped to a direction and the source sampled there, rows are
+/// spread over the ThreadPool. Used in process by CubeMap and from the command line by the EnvConvert tool.
+///
+/// Equirectangular panoramas are centred on -Z (u = 0.5) with +X at u = 0.75 and the seam (u = 0) at +Z, v = 0
+/// is straight up. Octahedral maps fold the +Z hemisphere into the centre diamond and -Z into the corners.
+/// @class EnvironmentConverter
+//----------------------------------------------------------------------------------------------------------------------
+class EnvironmentConverter
+{
+public :
+  static CubeImage equirectToCube(const FloatImage &_equirect, int _faceSize, Resample _filter = Resample::Bilinear);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the panorama is _width x _width / 2
+  //----------------------------------------------------------------------------------------------------------------------
+  static FloatImage cubeToEquirect(const CubeImage &_cube, int _width, Resample _filter = Resample::Bilinear);
+  static FloatImage cubeToOctahedral(const CubeImage &_cube, int _size, Resample _filter = Resample::Bilinear);
+  static FloatImage equirectToOctahedral(const FloatImage &_equirect, int _size, Resample _filter = Resample::Bilinear);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief half size mip of an octahedral map using a 4x4 tent filter. Taps that fall off an edge wrap
+  /// to where that direction really is (mirrored along the same edge) so there are no seams at the folds.
+  //----------------------------------------------------------------------------------------------------------------------
+  static FloatImage downsampleOctahedral(const FloatImage &_octahedral);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mappings, _u,_v are 0-1 across the image
+  //----------------------------------------------------------------------------------------------------------------------
+  static void equirectDirection(float _u, float _v, float o_dir[3]);
+  static void equirectCoordinates(const float _dir[3], float &o_u, float &o_v);
+  static void octahedralDirection(float _u, float _v, float o_dir[3]);
+  static void octahedralCoordinates(const float _dir[3], float &o_u, float &o_v);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief filtered lookups in each layout
+  //----------------------------------------------------------------------------------------------------------------------
+  static Float4 sampleEquirect(const FloatImage &_equirect, const float _dir[3], Resample _filter);
+  static Float4 sampleCube(const CubeImage &_cube, const float _dir[3], Resample _filter);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ENVIRONMENTFILTER_H_
+#define ENVIRONMENTFILTER_H_
+#include "CubeImage.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file EnvironmentFilter.h
+/// @brief offline convolution of environment cube maps on the CPU, see Karis "Real Shading in Unreal Engine 4"
+/// @class EnvironmentFilter
+//----------------------------------------------------------------------------------------------------------------------
+class EnvironmentFilter
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the roughness mip _level of a _levels long GGX chain was filtered with (level 0 is the mirror)
+  //----------------------------------------------------------------------------------------------------------------------
+  static float levelRoughness(int _level, int _levels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build a roughness indexed specular chain, each level is the source convolved with the GGX lobe
+  /// for that roughness (assuming N = V = R). The lobe is importance sampled and each sample reads a mip of
+  /// the source matched to its solid angle, which keeps the noise down with a small sample count.
+  /// Rows of every face are spread over the ThreadPool.
+  /// @param[in] _source the environment, usually linear
+  /// @param[in] _levels number of levels to produce, each half the size of the one before
+  /// @param[in] _samples GGX samples per texel
+  //----------------------------------------------------------------------------------------------------------------------
+  static CubeChain prefilterGGX(const CubeImage &_source, int _levels, unsigned int _samples = 64);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef FLOAT4_H_
+#define FLOAT4_H_
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOAT4_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FLOAT4_NEON 1
+#include <arm_neon.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Float4.h
+/// @brief four floats processed together, used for RGBA texels in the CPU side image filtering. Maps to SSE on
+/// x86, NEON on ARM (Apple silicon) and plain floats everywhere else so the results are the same on all three.
+/// @class Float4
+//----------------------------------------------------------------------------------------------------------------------
+struct Float4
+{
+#if defined(FLOAT4_SSE)
+  __m128 v;
+  Float4() : v(_mm_setzero_ps()) {}
+  explicit Float4(__m128 _v) : v(_v) {}
+  explicit Float4(float _s) : v(_mm_set1_ps(_s)) {}
+  Float4(float _x, float _y, float _z, float _w) : v(_mm_setr_ps(_x, _y, _z, _w)) {}
+  static Float4 load(const float *_p) { return Float4(_mm_loadu_ps(_p)); }
+  void store(float *_p) const { _mm_storeu_ps(_p, v); }
+  Float4 operator+(const Float4 &_r) const { return Float4(_mm_add_ps(v, _r.v)); }
+  Float4 operator-(const Float4 &_r) const { return Float4(_mm_sub_ps(v, _r.v)); }
+  Float4 operator*(const Float4 &_r) const { return Float4(_mm_mul_ps(v, _r.v)); }
+  Float4 operator*(float _s) const { return Float4(_mm_mul_ps(v, _mm_set1_ps(_s))); }
+  static Float4 min(const Float4 &_a, const Float4 &_b) { return Float4(_mm_min_ps(_a.v, _b.v)); }
+  static Float4 max(const Float4 &_a, const Float4 &_b) { return Float4(_mm_max_ps(_a.v, _b.v)); }
+  // the four as rows of a 4x4 matrix, turns four SoA lanes into four AoS records
+  static void transpose(Float4 &_a, Float4 &_b, Float4 &_c, Float4 &_d) { _MM_TRANSPOSE4_PS(_a.v, _b.v, _c.v, _d.v); }
+  // per lane _test >= 0 ? _a : _b
+  static Float4 select(const Float4 &_test, const Float4 &_a, const Float4 &_b)
+  {
+    __m128 mask = _mm_cmpge_ps(_test.v, _mm_setzero_ps());
+    return Float4(_mm_or_ps(_mm_and_ps(mask, _a.v), _mm_andnot_ps(mask, _b.v)));
+  }
+#elif defined(FLOAT4_NEON)
+  float32x4_t v;
+  Float4() : v(vdupq_n_f32(0.0f)) {}
+  explicit Float4(float32x4_t _v) : v(_v) {}
+  explicit Float4(float _s) : v(vdupq_n_f32(_s)) {}
+  Float4(float _x, float _y, float _z, float _w)
+  {
+    const float f[4] = {_x, _y, _z, _w};
+    v = vld1q_f32(f);
+  }
+  static Float4 load(const float *_p) { return Float4(vld1q_f32(_p)); }
+  void store(float *_p) const { vst1q_f32(_p, v); }
+  Float4 operator+(const Float4 &_r) const { return Float4(vaddq_f32(v, _r.v)); }
+  Float4 operator-(const Float4 &_r) const { return Float4(vsubq_f32(v, _r.v)); }
+  Float4 operator*(const Float4 &_r) const { return Float4(vmulq_f32(v, _r.v)); }
+  Float4 operator*(float _s) const { return Float4(vmulq_n_f32(v, _s)); }
+  static Float4 min(const Float4 &_a, const Float4 &_b) { return Float4(vminq_f32(_a.v, _b.v)); }
+  static Float4 max(const Float4 &_a, const Float4 &_b) { return Float4(vmaxq_f32(_a.v, _b.v)); }
+  static void transpose(Float4 &_a, Float4 &_b, Float4 &_c, Float4 &_d)
+  {
+    float32x4x2_t ab = vtrnq_f32(_a.v, _b.v);
+    float32x4x2_t cd = vtrnq_f32(_c.v, _d.v);
+    _a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    _b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    _c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    _d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+  }
+  static Float4 select(const Float4 &_test, const Float4 &_a, const Float4 &_b)
+  {
+    return Float4(vbslq_f32(vcgeq_f32(_test.v, vdupq_n_f32(0.0f)), _a.v, _b.v));
+  }
+#else
+  float v[4];
+  Float4() : v{0.0f, 0.0f, 0.0f, 0.0f} {}
+  explicit Float4(float _s) : v{_s, _s, _s, _s} {}
+  Float4(float _x, float _y, float _z, float _w) : v{_x, _y, _z, _w} {}
+  static Float4 load(const float *_p) { return Float4(_p[0], _p[1], _p[2], _p[3]); }
+  void store(float *_p) const
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      _p[i] = v[i];
+    }
+  }
+  Float4 operator+(const Float4 &_r) const { return Float4(v[0] + _r.v[0], v[1] + _r.v[1], v[2] + _r.v[2], v[3] + _r.v[3]); }
+  Float4 operator-(const Float4 &_r) const { return Float4(v[0] - _r.v[0], v[1] - _r.v[1], v[2] - _r.v[2], v[3] - _r.v[3]); }
+  Float4 operator*(const Float4 &_r) const { return Float4(v[0] * _r.v[0], v[1] * _r.v[1], v[2] * _r.v[2], v[3] * _r.v[3]); }
+  Float4 operator*(float _s) const { return Float4(v[0] * _s, v[1] * _s, v[2] * _s, v[3] * _s); }
+  static Float4 min(const Float4 &_a, const Float4 &_b)
+  {
+    return Float4(_a.v[0] < _b.v[0] ? _a.v[0] : _b.v[0], _a.v[1] < _b.v[1] ? _a.v[1] : _b.v[1],
+                  _a.v[2] < _b.v[2] ? _a.v[2] : _b.v[2], _a.v[3] < _b.v[3] ? _a.v[3] : _b.v[3]);
+  }
+  static Float4 max(const Float4 &_a, const Float4 &_b)
+  {
+    return Float4(_a.v[0] > _b.v[0] ? _a.v[0] : _b.v[0], _a.v[1] > _b.v[1] ? _a.v[1] : _b.v[1],
+                  _a.v[2] > _b.v[2] ? _a.v[2] : _b.v[2], _a.v[3] > _b.v[3] ? _a.v[3] : _b.v[3]);
+  }
+  static void transpose(Float4 &_a, Float4 &_b, Float4 &_c, Float4 &_d)
+  {
+    Float4 a = _a, b = _b, c = _c, d = _d;
+    _a = Float4(a.v[0], b.v[0], c.v[0], d.v[0]);
+    _b = Float4(a.v[1], b.v[1], c.v[1], d.v[1]);
+    _c = Float4(a.v[2], b.v[2], c.v[2], d.v[2]);
+    _d = Float4(a.v[3], b.v[3], c.v[3], d.v[3]);
+  }
+  static Float4 select(const Float4 &_test, const Float4 &_a, const Float4 &_b)
+  {
+    return Float4(_test.v[0] >= 0.0f ? _a.v[0] : _b.v[0], _test.v[1] >= 0.0f ? _a.v[1] : _b.v[1],
+                  _test.v[2] >= 0.0f ? _a.v[2] : _b.v[2], _test.v[3] >= 0.0f ? _a.v[3] : _b.v[3]);
+  }
+#endif
+  Float4 &operator+=(const Float4 &_r) { return *this = *this + _r; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _a + (_b - _a) * _t, used for the bilinear / trilinear blends
+  //----------------------------------------------------------------------------------------------------------------------
+  static Float4 lerp(const Float4 &_a, const Float4 &_b, float _t) { return _a + (_b - _a) * _t; }
+};
+
+#endif
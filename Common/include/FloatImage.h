@@ -0,0 +1,44 @@
+#ifndef FLOATIMAGE_H_
+#define FLOATIMAGE_H_
+#include "Float4.h"
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FloatImage.h
+/// @brief a 2D image of linear RGBA float texels, row 0 first, used for panoramas and octahedral maps
+/// @class FloatImage
+//----------------------------------------------------------------------------------------------------------------------
+class FloatImage
+{
+public :
+  FloatImage() = default;
+  FloatImage(int _width, int _height);
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+  bool empty() const { return m_data.empty(); }
+  float *texel(int _x, int _y) { return &m_data[(size_t(_y) * size_t(m_width) + size_t(_x)) * 4]; }
+  const float *texel(int _x, int _y) const { return &m_data[(size_t(_y) * size_t(m_width) + size_t(_x)) * 4]; }
+  float *data() { return m_data.data(); }
+  const float *data() const { return m_data.data(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build from 8 bit pixels with 1-4 channels, _srgb decodes the gamma 2.2 curve to linear
+  //----------------------------------------------------------------------------------------------------------------------
+  static FloatImage fromBytes(const unsigned char *_pixels, int _width, int _height, int _channels, bool _srgb);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write RGBA8, clamped to 0-1 and gamma encoded if _srgb is set
+  //----------------------------------------------------------------------------------------------------------------------
+  void toBytes(unsigned char *o_pixels, bool _srgb) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the 8 bit to float conversions shared with CubeImage, _count texels at a time
+  //----------------------------------------------------------------------------------------------------------------------
+  static void decodeTexels(const unsigned char *_src, size_t _count, int _channels, bool _srgb, float *o_dst);
+  static void encodeTexels(const float *_src, size_t _count, bool _srgb, unsigned char *o_dst);
+
+private :
+  int m_width = 0;
+  int m_height = 0;
+  std::vector<float> m_data;
+};
+
+#endif
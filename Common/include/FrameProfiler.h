@@ -0,0 +1,192 @@
+#ifndef FRAMEPROFILER_H_
+#define FRAMEPROFILER_H_
+#include <ngl/Types.h>
+#include <ngl/Text.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief per frame CPU and GPU timings for the demos. The CPU side comes from a steady clock, the frame time is
+/// the interval between beginFrame calls and the CPU time the span up to endFrame. GPU time is measured around
+/// named passes with GL_TIME_ELAPSED queries, double buffered per pass. A result is only read once
+/// GL_QUERY_RESULT_AVAILABLE says it has come in, and it is booked to the frame that issued it, so the GPU columns
+/// trail by a frame or two but the pipeline never stalls. If a pass's query from two frames back still hasn't
+/// come in, that pass goes untimed for the frame rather than waiting.
+/// @class FrameProfiler
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief min / avg / p99 over the last WINDOW values, plus a running total since reset for longer averages
+//----------------------------------------------------------------------------------------------------------------------
+class RollingStats
+{
+public :
+  static constexpr size_t WINDOW = 240;
+  struct Summary
+  {
+    double min = 0.0;
+    double avg = 0.0;
+    double p99 = 0.0;
+  };
+  void add(double _value);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief statistics of the values in the window, all 0 if there are none
+  //----------------------------------------------------------------------------------------------------------------------
+  Summary summary() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief values and their sum since the last reset(), not limited to the window
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t count() const {return m_count;}
+  double total() const {return m_total;}
+  double mean() const {return m_count != 0 ? m_total / double(m_count) : 0.0;}
+  void reset();
+
+private :
+  std::vector<double> m_values;
+  size_t m_next = 0;
+  size_t m_count = 0;
+  double m_total = 0.0;
+};
+
+class FrameProfiler
+{
+public :
+  static constexpr size_t FRAMES = 2;
+  FrameProfiler() = default;
+  FrameProfiler(const FrameProfiler &) = delete;
+  FrameProfiler &operator=(const FrameProfiler &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief deletes the queries so the GL context must still be current, a recording in progress is written out
+  //----------------------------------------------------------------------------------------------------------------------
+  ~FrameProfiler();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start a frame, first reading back any GPU results that have come in
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginFrame();
+  void endFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief time the GL commands up to endPass under _name, the queries are created the first time a name is used.
+  /// Passes can't nest, GL allows one GL_TIME_ELAPSED query active at a time, so beginning a pass ends the
+  /// current one. Nothing else may run a GL_TIME_ELAPSED query inside a pass. A pass can run more than once a
+  /// frame, each run gets its own query and the frame's CPU and GPU times for it are the sums.
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginPass(const std::string &_name);
+  void endPass();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief frame interval, CPU time and summed GPU time of the passes, in ms. Frames where a pass went untimed
+  /// are left out of the GPU statistics
+  //----------------------------------------------------------------------------------------------------------------------
+  const RollingStats &frameTime() const {return m_frameTime;}
+  const RollingStats &cpuTime() const {return m_cpuTime;}
+  const RollingStats &gpuTime() const {return m_gpuTime;}
+  double fps() const;
+  size_t numPasses() const {return m_passes.size();}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief index of the pass called _name, numPasses() if it hasn't run yet
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t passIndex(const std::string &_name) const;
+  const std::string &passName(size_t _pass) const {return m_passes[_pass].name;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief statistics of each run of the pass, the CSV has the per frame sums
+  //----------------------------------------------------------------------------------------------------------------------
+  const RollingStats &passCpuTime(size_t _pass) const {return m_passes[_pass].cpuTime;}
+  const RollingStats &passGpuTime(size_t _pass) const {return m_passes[_pass].gpuTime;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief clear every statistic, e.g. to average over a run of frames from total() / count()
+  //----------------------------------------------------------------------------------------------------------------------
+  void reset();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw the statistics a line each going down from _y, with the recording state last
+  /// @returns the y of the next free line
+  //----------------------------------------------------------------------------------------------------------------------
+  int draw(ngl::Text &_text, int _x, int _y) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line for a window title when a demo has no text overlay
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true at most once a second, for refreshing a window title with summary() without asking the window
+  /// system for a retitle every frame
+  //----------------------------------------------------------------------------------------------------------------------
+  bool summaryDue();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief keep every frame from now on, stopRecording writes them to _path as CSV. A frame is kept once its GPU
+  /// results are in (or given up on), so the last frame or two before stopping are not in the file
+  //----------------------------------------------------------------------------------------------------------------------
+  void startRecording(const std::string &_path);
+  bool stopRecording();
+  bool recording() const {return m_recording;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start recording or stop and write the file, for a key press
+  //----------------------------------------------------------------------------------------------------------------------
+  void toggleRecording(const std::string &_path);
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one GL_TIME_ELAPSED query, the frame it timed and whether its result is still to be read
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Query
+  {
+    GLuint id = 0;
+    uint64_t frame = 0;
+    bool pending = false;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the queries of one pass for even or odd frames, one per time the pass runs in a frame
+  //----------------------------------------------------------------------------------------------------------------------
+  struct QuerySlot
+  {
+    std::vector<Query> queries;
+    uint64_t frame = 0;
+    size_t used = 0;
+  };
+  struct Pass
+  {
+    std::string name;
+    std::array<QuerySlot, FRAMES> slots;
+    RollingStats cpuTime;
+    RollingStats gpuTime;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a frame waiting on its GPU results, times in ms and -1 for a pass not run or not timed
+  //----------------------------------------------------------------------------------------------------------------------
+  struct FrameRecord
+  {
+    uint64_t index = 0;
+    double frameTime = 0.0;
+    double cpuTime = 0.0;
+    std::vector<double> passCpu;
+    std::vector<double> passGpu;
+    size_t pending = 0;
+    bool ended = false;
+    bool complete = true;
+  };
+  void collect();
+  void retire();
+  bool writeCsv() const;
+  std::vector<Pass> m_passes;
+  // the pass being timed or -1
+  int m_activePass = -1;
+  // the query of the active pass, null if it went untimed
+  Query *m_activeQuery = nullptr;
+  std::chrono::steady_clock::time_point m_frameStart;
+  std::chrono::steady_clock::time_point m_passStart;
+  std::chrono::steady_clock::time_point m_summaryTime;
+  bool m_hasFrame = false;
+  uint64_t m_frame = 0;
+  // the current frame at the back, older ones still waiting on queries in front
+  std::deque<FrameRecord> m_inFlight;
+  RollingStats m_frameTime;
+  RollingStats m_cpuTime;
+  RollingStats m_gpuTime;
+  bool m_recording = false;
+  std::string m_recordPath;
+  std::vector<FrameRecord> m_records;
+};
+
+#endif
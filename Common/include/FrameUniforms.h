@@ -0,0 +1,99 @@
+#ifndef FRAMEUNIFORMS_H_
+#define FRAMEUNIFORMS_H_
+#include <ngl/Mat3.h>
+#include <ngl/Mat4.h>
+#include <array>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameUniforms.h
+/// @brief std140 uniform buffers for the matrices so the demos stop setting MVP / M / normalMatrix by name on
+/// every draw. The camera block (FrameData, binding 0) is written once per frame. Each object gets a slot in
+/// the ObjectData block (binding 1), and all slots go up in one write before the draws. A draw then only
+/// moves the glBindBufferRange offset. The buffer is a ring of FRAMES segments fenced on the GPU, so a
+/// frame never writes over data the previous ones are still reading.
+/// Shaders declare
+/// @code
+/// layout(std140) uniform FrameData { mat4 view; mat4 projection; mat4 viewProjection; vec4 eye; };
+/// layout(std140) uniform ObjectData { mat4 model; mat4 MVP; mat3 normalMatrix; };
+/// @endcode
+//----------------------------------------------------------------------------------------------------------------------
+struct FrameData
+{
+  ngl::Mat4 view;
+  ngl::Mat4 projection;
+  ngl::Mat4 viewProjection;
+  std::array<float, 4> eye;
+};
+
+struct ObjectData
+{
+  ngl::Mat4 model;
+  ngl::Mat4 MVP;
+  // std140 pads each mat3 column to a vec4
+  std::array<std::array<float, 4>, 3> normalMatrix;
+};
+
+static_assert(sizeof(FrameData) == 208, "FrameData must match the std140 layout");
+static_assert(sizeof(ObjectData) == 176, "ObjectData must match the std140 layout");
+
+class FrameUniforms
+{
+public :
+  static constexpr GLuint FRAME_BINDING = 0;
+  static constexpr GLuint OBJECT_BINDING = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief frames in flight, the ring has this many segments
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t FRAMES = 3;
+  FrameUniforms() = default;
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+  ~FrameUniforms();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief point a program's FrameData / ObjectData blocks (whichever it uses) at the shared bindings
+  //----------------------------------------------------------------------------------------------------------------------
+  static void bindBlocks(GLuint _program);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start a frame, clears the objects from the last one. The eye position is taken from the view
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginFrame(const ngl::Mat4 &_view, const ngl::Mat4 &_project);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue an object, MVP is done here once rather than per vertex
+  /// @returns the slot to pass to bindObject
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t addObject(const ngl::Mat4 &_model);
+  size_t addObject(const ngl::Mat4 &_model, const ngl::Mat3 &_normalMatrix);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the frame and all queued objects to the next ring segment and bind FrameData, may be called
+  /// more than once a frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void upload();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bind one object slot of the uploaded segment to OBJECT_BINDING
+  //----------------------------------------------------------------------------------------------------------------------
+  void bindObject(size_t _slot);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fence the segment once the frame's draws are issued
+  //----------------------------------------------------------------------------------------------------------------------
+  void endFrame();
+  size_t numObjects() const {return m_objects.size();}
+private :
+  FrameData m_frame;
+  std::vector<ObjectData> m_objects;
+  GLuint m_buffer = 0;
+  // bytes per segment and the aligned stride of each block within it
+  size_t m_segmentSize = 0;
+  size_t m_frameStride = 0;
+  size_t m_objectStride = 0;
+  size_t m_segment = 0;
+  // the current segment has been written and not yet fenced
+  bool m_uploaded = false;
+  std::array<GLsync, FRAMES> m_fences = {{nullptr, nullptr, nullptr}};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief (re)allocate so a segment holds at least _objects
+  //----------------------------------------------------------------------------------------------------------------------
+  void reserve(size_t _objects);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <array>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Frustum.h
+/// @brief the six clip planes of a view projection (Gribb / Hartmann), normalised so the plane distance is in
+/// world units. Plane order is left, right, bottom, top, near, far, each (a,b,c,d) with the inside positive. The
+/// planes are laid out as 24 floats so they can be passed straight to glUniform4fv(location, 6, data()).
+/// @class Frustum
+//----------------------------------------------------------------------------------------------------------------------
+class Frustum
+{
+public :
+  Frustum() = default;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief planes of _viewProject in the space it takes its input from, pass project * view * model to cull
+  /// in model space
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit Frustum(const ngl::Mat4 &_viewProject);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief conservative tests, true unless the volume is fully outside one plane
+  //----------------------------------------------------------------------------------------------------------------------
+  bool sphereVisible(const ngl::Vec3 &_centre, float _radius) const;
+  bool boxVisible(const ngl::Vec3 &_min, const ngl::Vec3 &_max) const;
+  const float *data() const {return m_planes[0].data();}
+  const std::array<float, 4> &plane(size_t _i) const {return m_planes[_i];}
+
+private :
+  std::array<std::array<float, 4>, 6> m_planes = {};
+};
+
+#endif
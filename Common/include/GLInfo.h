@@ -0,0 +1,20 @@
+#ifndef GLINFO_H_
+#define GLINFO_H_
+#include <ngl/Types.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GLInfo.h
+/// @brief queries on the current context so optional paths can fall back when a feature is missing (for example
+/// mac OSX stops at GL 4.1), these need a current context.
+//----------------------------------------------------------------------------------------------------------------------
+class GLInfo
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the context version is at least _major._minor
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool hasVersion(int _major, int _minor);
+  static bool hasExtension(const char *_name);
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef HDRIMAGE_H_
+#define HDRIMAGE_H_
+#include "FloatImage.h"
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file HDRImage.h
+/// @brief minimal loader for Radiance .hdr (RGBE) images, flat and run length encoded scanlines. Any of the eight
+/// orientations the resolution string allows is flipped / transposed to top to bottom rows. OpenEXR needs a full
+/// library (half floats, several compressors) so .exr is reported as unsupported, convert to .hdr first.
+/// @class HDRImage
+//----------------------------------------------------------------------------------------------------------------------
+class HDRImage
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load a linear float image, alpha is set to 1
+  /// @returns false and reports why if the file can't be read
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool load(const std::string &_fname, FloatImage &o_image);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true for the extensions load understands (or knows to reject)
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool isHDR(const std::string &_fname);
+};
+
+#endif
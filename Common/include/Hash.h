@@ -0,0 +1,25 @@
+#ifndef HASH_H_
+#define HASH_H_
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Hash.h
+/// @brief 64 bit FNV-1a hash used to tag archive entries and cached data, it is not cryptographic but is
+/// cheap and good enough to spot stale or corrupt data
+//----------------------------------------------------------------------------------------------------------------------
+constexpr uint64_t FNV1A64_SEED = 14695981039346656037ull;
+
+inline uint64_t fnv1a64(const void *_data, size_t _size, uint64_t _seed = FNV1A64_SEED)
+{
+  auto bytes = static_cast<const unsigned char *>(_data);
+  uint64_t hash = _seed;
+  for (size_t i = 0; i < _size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+#endif
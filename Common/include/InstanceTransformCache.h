@@ -0,0 +1,95 @@
+#ifndef INSTANCETRANSFORMCACHE_H_
+#define INSTANCETRANSFORMCACHE_H_
+#include <ngl/Mat4.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file InstanceTransformCache.h
+/// @brief per instance model matrices computed once from a generator and kept in cache line aligned chunks of
+/// CHUNK_SIZE, each with its own VBO. Only entries marked dirty are recomputed (in parallel on the ThreadPool).
+/// upload() copies only the runs of changed matrices into the chunk VBOs, so a static field costs nothing after
+/// the first frame. Chunks are allocated whole and kept when the count changes, so going from 10k to 10M instances
+/// adds chunks rather than reallocating (and copying) one huge array and buffer. The camera is not part of the
+/// cache, the shader applies it once per vertex from the FrameData block.
+/// @class InstanceTransformCache
+//----------------------------------------------------------------------------------------------------------------------
+class InstanceTransformCache
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief builds the model matrix of one instance, called from the pool threads so it must not touch GL
+  //----------------------------------------------------------------------------------------------------------------------
+  using Generator = std::function<ngl::Mat4(size_t _index)>;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fills o_matrices[0.._end-_begin) for instances [_begin,_end), called once per run of dirty entries so a
+  /// batched kernel (e.g. BatchTransform::models) can be used, also from the pool threads. A run never crosses a
+  /// chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  using RangeGenerator = std::function<void(size_t _begin, size_t _end, ngl::Mat4 *o_matrices)>;
+  InstanceTransformCache() = default;
+  InstanceTransformCache(const InstanceTransformCache &) = delete;
+  InstanceTransformCache &operator=(const InstanceTransformCache &) = delete;
+  ~InstanceTransformCache();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief (re)size the cache, every entry starts dirty. Chunks already allocated are reused
+  //----------------------------------------------------------------------------------------------------------------------
+  void reset(size_t _count, Generator _generator);
+  void reset(size_t _count, RangeGenerator _generator);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flag entries to be recomputed and re-uploaded, [_begin,_end) for the range version
+  //----------------------------------------------------------------------------------------------------------------------
+  void markDirty(size_t _index);
+  void markDirty(size_t _begin, size_t _end);
+  void markAllDirty();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recompute the dirty matrices, they stay flagged until upload()
+  /// @returns the number recomputed
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t update();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy each run of dirty matrices to its chunk VBO (created on first use) and clear the flags
+  /// @returns the bytes uploaded
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t upload();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief instances per chunk, 4 MB of matrices
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t CHUNK_SIZE = 65536;
+  size_t numChunks() const {return (m_count + CHUNK_SIZE - 1) / CHUNK_SIZE;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the VBO of chunk _chunk, 0 until the first upload. It holds instances [_chunk * CHUNK_SIZE,
+  /// _chunk * CHUNK_SIZE + chunkCount(_chunk))
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint buffer(size_t _chunk) const {return m_chunks[_chunk].buffer;}
+  size_t chunkCount(size_t _chunk) const {return std::min(CHUNK_SIZE, m_count - _chunk * CHUNK_SIZE);}
+  size_t size() const {return m_count;}
+  size_t numDirty() const {return m_numDirty;}
+  const ngl::Mat4 &matrix(size_t _index) const {return m_chunks[_index / CHUNK_SIZE].matrices[_index % CHUNK_SIZE];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief alignment of each chunk's matrix array, one cache line
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t ALIGNMENT = 64;
+
+private :
+  struct AlignedDelete
+  {
+    void operator()(ngl::Mat4 *_p) const;
+  };
+  struct Chunk
+  {
+    std::unique_ptr<ngl::Mat4[], AlignedDelete> matrices;
+    GLuint buffer = 0;
+  };
+  std::vector<Chunk> m_chunks;
+  std::vector<uint8_t> m_dirty;
+  size_t m_count = 0;
+  size_t m_numDirty = 0;
+  RangeGenerator m_generator;
+};
+
+#endif
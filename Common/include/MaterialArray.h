@@ -0,0 +1,56 @@
+#ifndef MATERIALARRAY_H_
+#define MATERIALARRAY_H_
+#include "TextureStorage.h"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MaterialArray.h
+/// @brief named materials packed as the layers of one GL_TEXTURE_2D_ARRAY, so instances with different textures
+/// still share a texture binding and can go in one draw, each picking its layer in the shader. Every texture must be
+/// the array's size. Storage for all the layers is allocated up front, so the capacity is fixed by create(). Adding a
+/// name that is already there returns its layer rather than using another one.
+/// @class MaterialArray
+//----------------------------------------------------------------------------------------------------------------------
+class MaterialArray
+{
+public :
+  MaterialArray() = default;
+  MaterialArray(const MaterialArray &) = delete;
+  MaterialArray &operator=(const MaterialArray &) = delete;
+  ~MaterialArray();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allocate RGBA8 storage with a full mip chain for _capacity layers of _width x _height
+  //----------------------------------------------------------------------------------------------------------------------
+  void create(GLsizei _width, GLsizei _height, GLsizei _capacity, const SamplerState &_sampler = SamplerState());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief upload level 0 of the next layer from 8 bit pixels (_format GL_RGB or GL_RGBA)
+  /// @returns the layer of _name, -1 if the size is wrong or the array is full
+  //----------------------------------------------------------------------------------------------------------------------
+  int add(const std::string &_name, const void *_pixels, GLenum _format, GLsizei _width, GLsizei _height);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the mip chains of every layer, call once after the adds
+  //----------------------------------------------------------------------------------------------------------------------
+  void generateMipmaps();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the layer of _name, -1 if it hasn't been added
+  //----------------------------------------------------------------------------------------------------------------------
+  int layer(const std::string &_name) const;
+  GLuint id() const {return m_id;}
+  size_t size() const {return m_layers.size();}
+  size_t capacity() const {return size_t(m_capacity);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GPU size of the whole array including the mip chains
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t sizeInBytes() const {return size_t(m_width) * size_t(m_height) * 4 * size_t(m_capacity) * 4 / 3;}
+
+private :
+  GLuint m_id = 0;
+  GLsizei m_width = 0;
+  GLsizei m_height = 0;
+  GLsizei m_capacity = 0;
+  std::unordered_map<std::string, int> m_layers;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef MESHBUILDER_H_
+#define MESHBUILDER_H_
+#include <ngl/Types.h>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshBuilder.h
+/// @brief builds indexed meshes with every attribute interleaved in one VBO. Vertices are added one per corner as
+/// floats. Each is packed to its attribute formats and deduplicated on the packed bytes, so the demo cube given as
+/// 36 corners comes out as 18 vertices and 36 indices, its UVs repeat across faces so faces share corners. The
+/// stride and offsets come from the VertexLayout, so the buffer sizes and glVertexAttribPointer calls can't
+/// disagree with the data.
+/// @class MeshBuilder
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief storage of one attribute component. NormalizedShort maps [-1,1] to the full int16 range
+//----------------------------------------------------------------------------------------------------------------------
+enum class AttributeFormat {Float, HalfFloat, NormalizedShort};
+
+struct VertexAttribute
+{
+  GLuint location;
+  GLint components;
+  AttributeFormat format;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the attributes of one interleaved vertex in order, each starting on a 4 byte boundary
+//----------------------------------------------------------------------------------------------------------------------
+class VertexLayout
+{
+public :
+  VertexLayout() = default;
+  VertexLayout(std::initializer_list<VertexAttribute> _attributes);
+  const std::vector<VertexAttribute> &attributes() const {return m_attributes;}
+  size_t offset(size_t _attribute) const {return m_offsets[_attribute];}
+  size_t stride() const {return m_stride;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief float components per vertex passed to MeshBuilder::addVertex
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t numComponents() const {return m_numComponents;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glVertexAttribPointer / enable every attribute for the bound VAO from the bound GL_ARRAY_BUFFER
+  //----------------------------------------------------------------------------------------------------------------------
+  void apply() const;
+
+private :
+  std::vector<VertexAttribute> m_attributes;
+  std::vector<size_t> m_offsets;
+  size_t m_stride = 0;
+  size_t m_numComponents = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the GL objects of an uploaded mesh, the VAO has the vertex buffer, attributes and index buffer bound
+//----------------------------------------------------------------------------------------------------------------------
+struct Mesh
+{
+  VertexLayout layout;
+  GLuint vao = 0;
+  GLuint vertexBuffer = 0;
+  GLuint indexBuffer = 0;
+  size_t numVertices = 0;
+  GLsizei numIndices = 0;
+  // GL_UNSIGNED_SHORT up to 65536 vertices, GL_UNSIGNED_INT above
+  GLenum indexType = GL_UNSIGNED_SHORT;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief point the currently bound VAO at this mesh's buffers so other VAOs (e.g. with instance attributes) can
+  /// share the geometry
+  //----------------------------------------------------------------------------------------------------------------------
+  void attach() const;
+  void release();
+};
+
+class MeshBuilder
+{
+public :
+  explicit MeshBuilder(const VertexLayout &_layout);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add the next corner, layout().numComponents() floats with each attribute's components in order
+  /// @returns its index, shared with any earlier vertex that packs to the same bytes
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t addVertex(const float *_values);
+  uint32_t addVertex(std::initializer_list<float> _values);
+  size_t numVertices() const {return m_numVertices;}
+  size_t numIndices() const {return m_indices.size();}
+  const VertexLayout &layout() const {return m_layout;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the packed, interleaved vertices and the indices into them, e.g. for baking copies with a StaticBatch
+  //----------------------------------------------------------------------------------------------------------------------
+  const std::vector<unsigned char> &vertices() const {return m_vertices;}
+  const std::vector<uint32_t> &indices() const {return m_indices;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the VAO, the interleaved vertex buffer and the index buffer
+  //----------------------------------------------------------------------------------------------------------------------
+  Mesh upload(GLenum _usage = GL_STATIC_DRAW) const;
+
+private :
+  VertexLayout m_layout;
+  std::vector<unsigned char> m_vertices;
+  size_t m_numVertices = 0;
+  std::vector<uint32_t> m_indices;
+  // packed vertex hash to the vertices with that hash
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_lookup;
+};
+
+#endif
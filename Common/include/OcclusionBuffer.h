@@ -0,0 +1,61 @@
+#ifndef OCCLUSIONBUFFER_H_
+#define OCCLUSIONBUFFER_H_
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file OcclusionBuffer.h
+/// @brief a small software depth buffer for CPU occlusion culling. A few near occluders are rasterised into it four
+/// pixels at a time with Float4, then a hierarchical Z (Hi-Z) pyramid is built where each texel holds the furthest
+/// depth of the four below it. An instance's screen bounds are tested against the level where they cover at most
+/// 2x2 texels, so every test reads four values whatever its size. Both sides are conservative. Occluders only
+/// write pixels they cover completely, with the furthest depth inside the pixel, and the tests use the nearest
+/// depth of the bounds. So a wrong answer can only keep a hidden instance, never drop a visible one. Depth is NDC
+/// z / w and the buffer clears to 1 (the far plane).
+/// @class OcclusionBuffer
+//----------------------------------------------------------------------------------------------------------------------
+class OcclusionBuffer
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief both sizes must be powers of two and the width at least 4
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit OcclusionBuffer(size_t _width = 256, size_t _height = 128);
+  void clear();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rasterise the front faces of the box [_min,_max] transformed by _mvp. Triangles crossing the near plane
+  /// are skipped, leaving out an occluder is always safe
+  //----------------------------------------------------------------------------------------------------------------------
+  void rasterizeBox(const ngl::Mat4 &_mvp, const ngl::Vec3 &_min, const ngl::Vec3 &_max);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the Hi-Z levels from the depth, call after the occluders and before the tests
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildHiZ();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the box [_min,_max] transformed by _mvp is behind the occluders everywhere it covers. A box
+  /// crossing the near plane is never occluded, one partly off screen is tested on the part that is on it
+  //----------------------------------------------------------------------------------------------------------------------
+  bool boxOccluded(const ngl::Mat4 &_mvp, const ngl::Vec3 &_min, const ngl::Vec3 &_max) const;
+  size_t width() const {return m_width;}
+  size_t height() const {return m_height;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief front facing triangles rasterised since the last clear, for the stats overlay
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t numTriangles() const {return m_numTriangles;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief level 0 is the full resolution depth, each level after it is half the size
+  //----------------------------------------------------------------------------------------------------------------------
+  const std::vector<float> &level(size_t _level) const {return m_levels[_level];}
+  size_t numLevels() const {return m_levels.size();}
+
+private :
+  void rasterizeTriangle(const float *_a, const float *_b, const float *_c);
+  size_t m_width;
+  size_t m_height;
+  std::vector<std::vector<float>> m_levels;
+  size_t m_numTriangles = 0;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PACKEDHDR_H_
+#define PACKEDHDR_H_
+#include <ngl/Types.h>
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PackedHDR.h
+/// @brief 32 bit per texel HDR formats, a quarter of RGBA32F and half of RGBA16F. RGB9E5 shares one 5 bit
+/// exponent across three 9 bit mantissas (EXT_texture_shared_exponent), R11G11B10F stores three unsigned
+/// small floats (6/6/5 bit mantissas, 5 bit exponents). Neither has alpha or negative values.
+/// Packing is done four texels at a time with SSE2 or NEON when available and spread over the ThreadPool.
+//----------------------------------------------------------------------------------------------------------------------
+enum class PackedFormat : uint32_t
+{
+  RGB9E5,
+  R11G11B10F
+};
+
+class PackedHDR
+{
+public :
+  static GLenum internalFormat(PackedFormat _format);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the type to pass with GL_RGB when uploading packed texels
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLenum pixelType(PackedFormat _format);
+  static const char *name(PackedFormat _format);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief pack _count RGBA float texels (alpha ignored) into o_packed
+  //----------------------------------------------------------------------------------------------------------------------
+  static void pack(const float *_rgba, size_t _count, PackedFormat _format, uint32_t *o_packed);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief reference scalar versions, also used for the tail that doesn't fill a SIMD group
+  //----------------------------------------------------------------------------------------------------------------------
+  static uint32_t packRGB9E5(float _r, float _g, float _b);
+  static uint32_t packR11G11B10F(float _r, float _g, float _b);
+  static void unpack(uint32_t _packed, PackedFormat _format, float o_rgb[3]);
+};
+
+#endif
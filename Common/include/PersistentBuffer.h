@@ -0,0 +1,74 @@
+#ifndef PERSISTENTBUFFER_H_
+#define PERSISTENTBUFFER_H_
+#include <ngl/Types.h>
+#include <array>
+#include <cstddef>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PersistentBuffer.h
+/// @brief a buffer for data rewritten every frame without the implicit sync of glBufferData / glBufferSubData. It
+/// is split into FRAMES regions, each fenced once the frame's draws using it are issued. The CPU writes frame N+2
+/// while the GPU still reads frame N, and only waits if the GPU falls a full ring behind. Each wait is counted.
+/// With GL 4.4 or ARB_buffer_storage the storage is immutable and mapped once, persistent and coherent. Without it
+/// (mac OSX) each region is mapped unsynchronized per frame instead, guarded by the same fences.
+/// @class PersistentBuffer
+//----------------------------------------------------------------------------------------------------------------------
+class PersistentBuffer
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief frames in flight, the buffer has this many regions
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t FRAMES = 3;
+  PersistentBuffer() = default;
+  PersistentBuffer(const PersistentBuffer &) = delete;
+  PersistentBuffer &operator=(const PersistentBuffer &) = delete;
+  ~PersistentBuffer();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make each region at least _bytes. Growing replaces the buffer, so anything pointing at buffer() (e.g.
+  /// VAO attributes) has to be set again
+  /// @returns true if the buffer was (re)created
+  //----------------------------------------------------------------------------------------------------------------------
+  bool reserve(size_t _bytes);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief move to the next region, waiting on its fence if the GPU still uses it
+  /// @returns where to write up to regionSize() bytes, nullptr if the map failed
+  //----------------------------------------------------------------------------------------------------------------------
+  void *beginWrite();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief finish the writes, only unmaps on the fallback path as the persistent mapping is coherent
+  //----------------------------------------------------------------------------------------------------------------------
+  void endWrite();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fence the region once the draws reading it are issued
+  //----------------------------------------------------------------------------------------------------------------------
+  void fence();
+  GLuint buffer() const {return m_buffer;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief byte offset in buffer() of the region being written / drawn this frame
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t offset() const {return m_region * m_regionSize;}
+  size_t regionSize() const {return m_regionSize;}
+  bool persistent() const {return m_persistent;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief times beginWrite had to block on the GPU since creation and how long the last one took in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t numWaits() const {return m_numWaits;}
+  double lastWaitTime() const {return m_lastWaitTime;}
+
+private :
+  void release();
+  GLuint m_buffer = 0;
+  size_t m_regionSize = 0;
+  size_t m_region = 0;
+  bool m_persistent = false;
+  // the whole persistently mapped range, nullptr on the fallback path
+  unsigned char *m_mapped = nullptr;
+  // the current region has been written and not yet fenced
+  bool m_written = false;
+  std::array<GLsync, FRAMES> m_fences = {{nullptr, nullptr, nullptr}};
+  size_t m_numWaits = 0;
+  double m_lastWaitTime = 0.0;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SPHERICALHARMONICS_H_
+#define SPHERICALHARMONICS_H_
+#include "CubeImage.h"
+#include <array>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SphericalHarmonics.h
+/// @brief order 2 (9 coefficient) spherical harmonic projection of environments for diffuse lighting, see
+/// Ramamoorthi and Hanrahan "An Efficient Representation for Irradiance Environment Maps"
+//----------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief one RGB coefficient per basis function padded to a vec4 so the array can be copied straight into
+/// a std140 uniform block (vec4 sh[9])
+//----------------------------------------------------------------------------------------------------------------------
+struct SHCoefficients
+{
+  std::array<std::array<float, 4>, 9> c{};
+};
+
+class SphericalHarmonics
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief project the environment onto the first 9 SH basis functions. Every texel is weighted by its solid
+  /// angle and rows are summed in parallel across the ThreadPool then reduced in order so the result is the
+  /// same whatever the thread count.
+  //----------------------------------------------------------------------------------------------------------------------
+  static SHCoefficients project(const CubeImage &_env);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief convolve radiance coefficients with the clamped cosine lobe and divide by pi, evaluating the
+  /// result for a normal gives the outgoing radiance of a white lambertian surface
+  //----------------------------------------------------------------------------------------------------------------------
+  static SHCoefficients irradiance(const SHCoefficients &_radiance);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief evaluate the 9 basis functions for unit direction _dir
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::array<float, 9> basis(const float _dir[3]);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief reconstruct RGB in direction _dir
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::array<float, 3> evaluate(const SHCoefficients &_sh, const float _dir[3]);
+};
+
+#endif
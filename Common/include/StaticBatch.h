@@ -0,0 +1,78 @@
+#ifndef STATICBATCH_H_
+#define STATICBATCH_H_
+#include "MeshBuilder.h"
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class Frustum;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file StaticBatch.h
+/// @brief bakes many copies of one mesh into a single static VBO for geometry that never moves. Every copy's
+/// positions are transformed by its model matrix once, on the ThreadPool, so drawing needs no per instance data at
+/// all. Consecutive instances are grouped into chunks that share one index pattern and are drawn with
+/// glDrawElementsBaseVertex, one call per chunk, each culled on its bounds. Chunks are only spatially compact if
+/// the instances are in spatial order (e.g. sorted by a CullGrid). The memory cost is the whole mesh per instance,
+/// so this trades a lot of VBO for the draw overhead.
+/// @class StaticBatch
+//----------------------------------------------------------------------------------------------------------------------
+class StaticBatch
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the model matrix of instance _index, called from the pool threads so it must not touch GL
+  //----------------------------------------------------------------------------------------------------------------------
+  using MatrixSource = std::function<const ngl::Mat4 &(size_t _index)>;
+  struct Chunk
+  {
+    GLint baseVertex;
+    size_t first;
+    size_t count;
+    ngl::Vec3 min;
+    ngl::Vec3 max;
+  };
+  StaticBatch() = default;
+  StaticBatch(const StaticBatch &) = delete;
+  StaticBatch &operator=(const StaticBatch &) = delete;
+  ~StaticBatch();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief bake _count copies of _mesh. Its first attribute must be a 3 float position, the rest are copied as
+  /// they are, so normals or tangents would come out unrotated
+  /// @param _chunkInstances instances per chunk, 0 for as many as 16 bit indices allow
+  /// @returns false if the layout can't be baked
+  //----------------------------------------------------------------------------------------------------------------------
+  bool bake(const MeshBuilder &_mesh, size_t _count, const MatrixSource &_matrix, size_t _chunkInstances = 0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw every chunk, or only those whose bounds pass _frustum (in the same space as the matrices)
+  /// @returns the instances drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t draw(const Frustum *_frustum = nullptr);
+  void release();
+  size_t numInstances() const {return m_numInstances;}
+  size_t numChunks() const {return m_chunks.size();}
+  const Chunk &chunk(size_t _chunk) const {return m_chunks[_chunk];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief chunks drawn by the last draw()
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t chunksDrawn() const {return m_chunksDrawn;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GPU memory of the baked vertices and the shared index pattern
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t vertexBytes() const {return m_vertexBytes;}
+  size_t indexBytes() const {return m_indexBytes;}
+
+private :
+  Mesh m_mesh;
+  std::vector<Chunk> m_chunks;
+  // indices per copy of the source mesh
+  size_t m_meshIndices = 0;
+  size_t m_numInstances = 0;
+  size_t m_chunksDrawn = 0;
+  size_t m_vertexBytes = 0;
+  size_t m_indexBytes = 0;
+};
+
+#endif
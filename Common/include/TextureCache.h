@@ -0,0 +1,30 @@
+#ifndef TEXTURECACHE_H_
+#define TEXTURECACHE_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TextureCache.h
+/// @brief on disk cache for expensive CPU texture processing (block compression, prefiltering etc). Entries are
+/// keyed by a 64 bit hash of the inputs and the processing parameters, the caller is responsible for building a
+/// key that changes whenever the output would. The directory defaults to .texturecache next to the executable
+/// and can be moved with the TEXTURE_CACHE_DIR environment variable.
+/// @class TextureCache
+//----------------------------------------------------------------------------------------------------------------------
+class TextureCache
+{
+public :
+  static std::string directory();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read a cached blob
+  /// @param[in] _key the hash of everything that went into making the data
+  /// @param[out] o_data the cached bytes
+  /// @returns false if there is no entry or it is corrupt
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool load(uint64_t _key, std::vector<unsigned char> &o_data);
+  static bool store(uint64_t _key, const void *_data, size_t _size);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef TEXTURESTORAGE_H_
+#define TEXTURESTORAGE_H_
+#include <ngl/Types.h>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TextureStorage.h
+/// @brief texture creation shared by all the demos. Textures get immutable storage for every level up front
+/// (glTextureStorage*) and are then filled / configured with the direct state access calls so nothing has to be
+/// bound just to edit it. Contexts without GL 4.5 (mac OSX stops at 4.1) fall back to bind to edit with
+/// glTexStorage* or, below 4.2, a one off glTexImage* allocation of every level.
+//----------------------------------------------------------------------------------------------------------------------
+struct SamplerState
+{
+  GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLenum magFilter = GL_LINEAR;
+  GLenum wrap = GL_REPEAT;
+};
+
+class TextureStorage
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GL 4.5 or ARB_direct_state_access
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool hasDirectStateAccess();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GL 4.2 or ARB_texture_storage
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool hasImmutableStorage();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of levels in a full mip chain down to 1x1x1
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLsizei fullMipLevels(GLsizei _width, GLsizei _height = 1, GLsizei _depth = 1);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allocate a texture with all of its levels
+  /// @param[in] _target GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D or GL_TEXTURE_2D_ARRAY
+  /// @param[in] _levels number of mip levels to allocate
+  /// @param[in] _internalFormat sized internal format (GL_RGBA8, GL_COMPRESSED_RGBA_BPTC_UNORM etc)
+  /// @param[in] _width,_height,_depth size of level 0, depth is the layer count for arrays and ignored for 2D / cube
+  /// @param[in] _sampler filtering and wrap mode
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLuint create(GLenum _target, GLsizei _levels, GLenum _internalFormat, GLsizei _width, GLsizei _height,
+                       GLsizei _depth = 1, const SamplerState &_sampler = SamplerState());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill part of a level
+  /// @param[in] _layer the cube face (0-5 in +X -X +Y -Y +Z -Z order), the first array layer or the z offset
+  /// @param[in] _depth number of layers / slices to fill, ignored for 2D and cube maps
+  //----------------------------------------------------------------------------------------------------------------------
+  static void upload(GLenum _target, GLuint _id, GLint _level, GLint _layer, GLsizei _width, GLsizei _height, GLsizei _depth,
+                     GLenum _format, GLenum _type, const void *_pixels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill a level with pre compressed blocks, same layer rules as upload
+  //----------------------------------------------------------------------------------------------------------------------
+  static void uploadCompressed(GLenum _target, GLuint _id, GLint _level, GLint _layer, GLsizei _width, GLsizei _height,
+                               GLsizei _depth, GLenum _internalFormat, GLsizei _size, const void *_data);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decode an image with ngl::Image and build a mip mapped RGBA8 texture from it, this replaces
+  /// ngl::Texture::setTextureGL which respecifies the texture with glTexImage2D
+  /// @returns the texture id or 0 if the image could not be loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  static GLuint createFromFile(const std::string &_fname, const SamplerState &_sampler = SamplerState());
+  static void generateMipmaps(GLenum _target, GLuint _id);
+  static void setParameter(GLenum _target, GLuint _id, GLenum _name, GLint _value);
+  static void setParameter(GLenum _target, GLuint _id, GLenum _name, GLfloat _value);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ThreadPool.h
+/// @brief a small persistent pool of worker threads used for the CPU side texture / instance processing.
+/// Work is handed out in chunks from an atomic counter and the calling thread joins in, so parallelFor
+/// blocks until everything is done. Calls made from inside a job just run inline.
+/// @class ThreadPool
+//----------------------------------------------------------------------------------------------------------------------
+class ThreadPool
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the shared pool, created on first use with one thread per core
+  //----------------------------------------------------------------------------------------------------------------------
+  static ThreadPool &instance();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @param[in] _threads total number of threads including the caller, so 1 means run everything inline
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit ThreadPool(unsigned int _threads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  size_t numThreads() const { return m_workers.size() + 1; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief call _func(begin,end) over [0,_count) in chunks of at most _grain items
+  //----------------------------------------------------------------------------------------------------------------------
+  void parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_func, size_t _grain = 1);
+
+private :
+  void workerLoop();
+  void runChunks();
+  std::vector<std::thread> m_workers;
+  std::mutex m_submit;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  const std::function<void(size_t, size_t)> *m_job = nullptr;
+  size_t m_count = 0;
+  size_t m_grain = 1;
+  std::atomic<size_t> m_next{0};
+  size_t m_active = 0;
+  uint64_t m_generation = 0;
+  bool m_quit = false;
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include "AssetArchive.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetArchive::AssetArchive(const std::string &_fname)
+{
+  open(_fname);
+}
+
+AssetArchive::~AssetArchive()
+{
+  close();
+}
+
+bool AssetArchive::open(const std::string &_fname, bool _verify)
+{
+  close();
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(_fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr)
+  {
+    CloseHandle(file);
+    return false;
+  }
+  m_data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  m_size = static_cast<size_t>(size.QuadPart);
+  m_file = file;
+  m_mapping = mapping;
+#else
+  int fd = ::open(_fname.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+  void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  m_data = static_cast<const unsigned char *>(data);
+  m_size = static_cast<size_t>(info.st_size);
+#endif
+  if (m_data == nullptr || !validate(_verify))
+  {
+    std::cerr << "AssetArchive: " << _fname << " is not a valid asset archive\n";
+    close();
+    return false;
+  }
+  return true;
+}
+
+void AssetArchive::close()
+{
+#if defined(_WIN32)
+  // each handle on its own, MapViewOfFile can fail after the file and mapping were opened
+  if (m_data != nullptr)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr)
+  {
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    m_mapping = nullptr;
+  }
+  if (m_file != nullptr)
+  {
+    CloseHandle(static_cast<HANDLE>(m_file));
+    m_file = nullptr;
+  }
+#else
+  if (m_data != nullptr)
+  {
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+  }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+bool AssetArchive::validate(bool _verify) const
+{
+  if (m_size < sizeof(ArchiveHeader))
+  {
+    return false;
+  }
+  auto header = reinterpret_cast<const ArchiveHeader *>(m_data);
+  if (std::memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 || header->version != ARCHIVE_VERSION)
+  {
+    return false;
+  }
+  uint64_t tocEnd = sizeof(ArchiveHeader) + uint64_t(header->entryCount) * sizeof(ArchiveEntry);
+  if (tocEnd > m_size || header->namesOffset < tocEnd || header->namesOffset + header->namesSize > m_size)
+  {
+    return false;
+  }
+  auto toc = reinterpret_cast<const ArchiveEntry *>(m_data + sizeof(ArchiveHeader));
+  for (uint32_t i = 0; i < header->entryCount; ++i)
+  {
+    const ArchiveEntry &e = toc[i];
+    if (e.offset + e.size > m_size || uint64_t(e.nameOffset) + e.nameLength > header->namesSize)
+    {
+      return false;
+    }
+    if (_verify && (header->flags & ARCHIVE_HAS_HASHES) && fnv1a64(m_data + e.offset, e.size) != e.hash)
+    {
+      std::cerr << "AssetArchive: hash mismatch for " << entryName(i) << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t AssetArchive::numEntries() const
+{
+  return m_data ? reinterpret_cast<const ArchiveHeader *>(m_data)->entryCount : 0;
+}
+
+std::string_view AssetArchive::entryName(size_t _index) const
+{
+  auto header = reinterpret_cast<const ArchiveHeader *>(m_data);
+  auto toc = reinterpret_cast<const ArchiveEntry *>(m_data + sizeof(ArchiveHeader));
+  auto names = reinterpret_cast<const char *>(m_data + header->namesOffset);
+  return std::string_view(names + toc[_index].nameOffset, toc[_index].nameLength);
+}
+
+const ArchiveEntry *AssetArchive::findEntry(std::string_view _name) const
+{
+  if (m_data == nullptr)
+  {
+    return nullptr;
+  }
+  auto header = reinterpret_cast<const ArchiveHeader *>(m_data);
+  auto toc = reinterpret_cast<const ArchiveEntry *>(m_data + sizeof(ArchiveHeader));
+  auto names = reinterpret_cast<const char *>(m_data + header->namesOffset);
+  auto nameOf = [names](const ArchiveEntry &_e)
+  { return std::string_view(names + _e.nameOffset, _e.nameLength); };
+  // the packer sorts the toc by name
+  auto end = toc + header->entryCount;
+  auto it = std::lower_bound(toc, end, _name, [&nameOf](const ArchiveEntry &_e, std::string_view _n)
+                             { return nameOf(_e) < _n; });
+  return (it != end && nameOf(*it) == _name) ? it : nullptr;
+}
+
+std::string_view AssetArchive::find(std::string_view _name) const
+{
+  auto entry = findEntry(_name);
+  if (entry == nullptr)
+  {
+    return std::string_view();
+  }
+  return std::string_view(reinterpret_cast<const char *>(m_data + entry->offset), entry->size);
+}
+
+bool AssetArchive::contains(std::string_view _name) const
+{
+  return findEntry(_name) != nullptr;
+}
+
+bool AssetArchive::verify(std::string_view _name) const
+{
+  auto entry = findEntry(_name);
+  if (entry == nullptr)
+  {
+    return false;
+  }
+  if (!(reinterpret_cast<const ArchiveHeader *>(m_data)->flags & ARCHIVE_HAS_HASHES))
+  {
+    return true;
+  }
+  return fnv1a64(m_data + entry->offset, entry->size) == entry->hash;
+}
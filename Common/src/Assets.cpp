@@ -0,0 +1,59 @@
+#include "Assets.h"
+#include <ngl/ShaderLib.h>
+#include <iostream>
+
+AssetArchive Assets::s_archive;
+
+bool Assets::mount(const std::string &_fname)
+{
+#ifdef NDEBUG
+  constexpr bool verify = false;
+#else
+  constexpr bool verify = true;
+#endif
+  if (!s_archive.open(_fname, verify))
+  {
+    std::cerr << "Assets: no archive " << _fname << " using loose files\n";
+    return false;
+  }
+  std::cout << "Assets: mounted " << _fname << " with " << s_archive.numEntries() << " entries\n";
+  return true;
+}
+
+void Assets::unmount()
+{
+  s_archive.close();
+}
+
+const AssetArchive &Assets::archive()
+{
+  return s_archive;
+}
+
+std::string_view Assets::read(std::string_view _fname)
+{
+  return s_archive.find(_fname);
+}
+
+void Assets::loadShaderSource(std::string_view _shaderName, const std::string &_fname)
+{
+  auto source = s_archive.find(_fname);
+  if (source.empty())
+  {
+    ngl::ShaderLib::loadShaderSource(_shaderName, _fname);
+  }
+  else
+  {
+    ngl::ShaderLib::loadShaderSourceFromString(_shaderName, source);
+  }
+}
+
+bool Assets::loadImage(const std::string &_fname, QImage &o_image)
+{
+  auto data = s_archive.find(_fname);
+  if (data.empty())
+  {
+    return o_image.load(_fname.c_str());
+  }
+  return o_image.loadFromData(reinterpret_cast<const uchar *>(data.data()), static_cast<int>(data.size()));
+}
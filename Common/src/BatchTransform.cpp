@@ -0,0 +1,181 @@
+#include "BatchTransform.h"
+#include "Float4.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#if defined(FLOAT4_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  constexpr float DEG_TO_RAD = 3.14159265358979f / 180.0f;
+  constexpr float TWO_OVER_PI = 0.636619772367581f;
+  // pi/2 split in two so the range reduction keeps its precision for large angles (Cody-Waite)
+  constexpr float PIO2_HI = 1.5703125f;
+  constexpr float PIO2_LO = 4.83826794897e-4f;
+  // instances per ThreadPool chunk, a multiple of 4 so only the last chunk has a partial block
+  constexpr size_t GRAIN = 1024;
+
+  // sin / cos of the reduced angle r in [-pi/4, pi/4], Taylor to r^7 and r^8 is within 4e-7
+  void sinCosReduced(const Float4 &_r, Float4 &o_sin, Float4 &o_cos)
+  {
+    Float4 r2 = _r * _r;
+    o_sin = _r + _r * r2 * (Float4(-1.0f / 6.0f) + r2 * (Float4(1.0f / 120.0f) + r2 * Float4(-1.0f / 5040.0f)));
+    o_cos = Float4(1.0f) + r2 * (Float4(-0.5f) + r2 * (Float4(1.0f / 24.0f) + r2 * (Float4(-1.0f / 720.0f) +
+                                                                                      r2 * Float4(1.0f / 40320.0f))));
+  }
+
+  // x = q pi/2 + r, the quadrant q picks which of sin r / cos r each result is and its sign
+  void sinCos(const Float4 &_degrees, Float4 &o_sin, Float4 &o_cos)
+  {
+#if defined(FLOAT4_SSE)
+    __m128 x = _mm_mul_ps(_degrees.v, _mm_set1_ps(DEG_TO_RAD));
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(PIO2_HI))), _mm_mul_ps(qf, _mm_set1_ps(PIO2_LO)));
+    Float4 s, c;
+    sinCosReduced(Float4(r), s, c);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    // bit 1 of q (q + 1 for cos) moved up to the float sign bit
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+    __m128 sinv = _mm_or_ps(_mm_and_ps(swap, c.v), _mm_andnot_ps(swap, s.v));
+    __m128 cosv = _mm_or_ps(_mm_and_ps(swap, s.v), _mm_andnot_ps(swap, c.v));
+    o_sin = Float4(_mm_xor_ps(sinv, sinSign));
+    o_cos = Float4(_mm_xor_ps(cosv, cosSign));
+#elif defined(FLOAT4_NEON)
+    float32x4_t x = vmulq_n_f32(_degrees.v, DEG_TO_RAD);
+    float32x4_t t = vmulq_n_f32(x, TWO_OVER_PI);
+    // round to nearest, the conversion truncates
+    float32x4_t half = vbslq_f32(vcgeq_f32(t, vdupq_n_f32(0.0f)), vdupq_n_f32(0.5f), vdupq_n_f32(-0.5f));
+    int32x4_t q = vcvtq_s32_f32(vaddq_f32(t, half));
+    float32x4_t qf = vcvtq_f32_s32(q);
+    float32x4_t r = vsubq_f32(vsubq_f32(x, vmulq_n_f32(qf, PIO2_HI)), vmulq_n_f32(qf, PIO2_LO));
+    Float4 s, c;
+    sinCosReduced(Float4(r), s, c);
+    int32x4_t one = vdupq_n_s32(1);
+    int32x4_t two = vdupq_n_s32(2);
+    uint32x4_t swap = vceqq_s32(vandq_s32(q, one), one);
+    uint32x4_t sinSign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(q, two), 30));
+    uint32x4_t cosSign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(vaddq_s32(q, one), two), 30));
+    float32x4_t sinv = vbslq_f32(swap, c.v, s.v);
+    float32x4_t cosv = vbslq_f32(swap, s.v, c.v);
+    o_sin = Float4(vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sinv), sinSign)));
+    o_cos = Float4(vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cosv), cosSign)));
+#else
+    for (int i = 0; i < 4; ++i)
+    {
+      o_sin.v[i] = std::sin(_degrees.v[i] * DEG_TO_RAD);
+      o_cos.v[i] = std::cos(_degrees.v[i] * DEG_TO_RAD);
+    }
+#endif
+  }
+
+  // four consecutive entries, zero padded past _count so a partial block can go through the same code
+  Float4 loadLanes(const std::vector<float> &_values, size_t _i, size_t _count)
+  {
+    if (_count == 4)
+    {
+      return Float4::load(&_values[_i]);
+    }
+    float lanes[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    std::copy(_values.begin() + long(_i), _values.begin() + long(_i + _count), lanes);
+    return Float4::load(lanes);
+  }
+
+  // up to four instances starting at _i, m[c][r] holds element (column c, row r) of each lane's matrix, the
+  // optional _viewProject is applied before the transpose back to one Mat4 per instance
+  void transformBlock(const TransformArrays &_in, size_t _i, size_t _count, const ngl::Mat4 *_viewProject,
+                      ngl::Mat4 *o_out)
+  {
+    Float4 sx, cx, sy, cy, sz, cz;
+    sinCos(loadLanes(_in.rx, _i, _count), sx, cx);
+    sinCos(loadLanes(_in.ry, _i, _count), sy, cy);
+    sinCos(loadLanes(_in.rz, _i, _count), sz, cz);
+    const Float4 zero(0.0f);
+    const Float4 one(1.0f);
+    // Rz * Ry * Rx, columns of the rotation then the translation
+    Float4 m[4][4] = {
+        {cz * cy, sz * cy, zero - sy, zero},
+        {cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, zero},
+        {cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, zero},
+        {loadLanes(_in.px, _i, _count), loadLanes(_in.py, _i, _count), loadLanes(_in.pz, _i, _count), one}};
+    if (_viewProject != nullptr)
+    {
+      // (VP * M) column c = sum over k of VP column k * M[c][k]
+      const auto &vp = _viewProject->m_m;
+      Float4 mvp[4][4];
+      for (int c = 0; c < 4; ++c)
+      {
+        for (int r = 0; r < 4; ++r)
+        {
+          mvp[c][r] = m[c][0] * vp[0][r] + m[c][1] * vp[1][r] + m[c][2] * vp[2][r] + m[c][3] * vp[3][r];
+        }
+      }
+      std::copy(&mvp[0][0], &mvp[0][0] + 16, &m[0][0]);
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+      Float4::transpose(m[c][0], m[c][1], m[c][2], m[c][3]);
+      for (size_t lane = 0; lane < _count; ++lane)
+      {
+        m[c][lane].store(&o_out[lane].m_m[c][0]);
+      }
+    }
+  }
+
+  void transformRange(const TransformArrays &_in, size_t _begin, size_t _end, const ngl::Mat4 *_viewProject,
+                      ngl::Mat4 *o_out)
+  {
+    for (size_t i = _begin; i < _end; i += 4)
+    {
+      transformBlock(_in, i, std::min<size_t>(4, _end - i), _viewProject, o_out + (i - _begin));
+    }
+  }
+
+  void transformAll(const TransformArrays &_in, const ngl::Mat4 *_viewProject, ngl::Mat4 *o_out)
+  {
+    size_t count = _in.size();
+    if (count < BatchTransform::PARALLEL_MIN)
+    {
+      transformRange(_in, 0, count, _viewProject, o_out);
+      return;
+    }
+    ThreadPool::instance().parallelFor(count, [&](size_t _begin, size_t _end)
+    {
+      transformRange(_in, _begin, _end, _viewProject, o_out + _begin);
+    }, GRAIN);
+  }
+} // end anon namespace
+
+void TransformArrays::resize(size_t _count)
+{
+  for (auto *values : {&px, &py, &pz, &rx, &ry, &rz})
+  {
+    values->resize(_count, 0.0f);
+  }
+}
+
+void BatchTransform::models(const TransformArrays &_in, size_t _begin, size_t _end, ngl::Mat4 *o_models)
+{
+  transformRange(_in, _begin, _end, nullptr, o_models);
+}
+
+void BatchTransform::mvps(const TransformArrays &_in, size_t _begin, size_t _end, const ngl::Mat4 &_viewProject,
+                          ngl::Mat4 *o_mvps)
+{
+  transformRange(_in, _begin, _end, &_viewProject, o_mvps);
+}
+
+void BatchTransform::models(const TransformArrays &_in, ngl::Mat4 *o_models)
+{
+  transformAll(_in, nullptr, o_models);
+}
+
+void BatchTransform::mvps(const TransformArrays &_in, const ngl::Mat4 &_viewProject, ngl::Mat4 *o_mvps)
+{
+  transformAll(_in, &_viewProject, o_mvps);
+}
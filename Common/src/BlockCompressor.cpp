@@ -0,0 +1,966 @@
+#include "BlockCompressor.h"
+#include "GLInfo.h"
+#include "Hash.h"
+#include "TextureCache.h"
+#include "TextureStorage.h"
+#include "ThreadPool.h"
+#include <ngl/Image.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+  // bump this whenever the encoder output changes so stale cache entries are ignored
+  constexpr uint64_t ENCODER_VERSION = 1;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a 4x4 block unpacked to float RGBA in the 0-255 range
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Block
+  {
+    float px[16][4];
+  };
+
+  void fetchBlock(const unsigned char *_pixels, int _width, int _height, int _channels, int _bx, int _by, Block &o_block)
+  {
+    for (int y = 0; y < 4; ++y)
+    {
+      // replicate the edge pixels into blocks that hang off the image
+      int sy = std::min(_by * 4 + y, _height - 1);
+      for (int x = 0; x < 4; ++x)
+      {
+        int sx = std::min(_bx * 4 + x, _width - 1);
+        const unsigned char *p = _pixels + (size_t(sy) * _width + sx) * _channels;
+        float *o = o_block.px[y * 4 + x];
+        o[0] = p[0];
+        o[1] = _channels == 1 ? p[0] : p[1];
+        o[2] = _channels == 1 ? p[0] : (_channels > 2 ? p[2] : 0.0f);
+        o[3] = _channels > 3 ? p[3] : 255.0f;
+      }
+    }
+  }
+
+  float clampByte(float _v)
+  {
+    return std::min(255.0f, std::max(0.0f, _v));
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief endpoints from the bounding box of the block, channels that are anti-correlated with the channel
+  /// with the largest range are flipped so we get the right diagonal, then inset a little as in stb_dxt
+  //----------------------------------------------------------------------------------------------------------------------
+  template <int N>
+  void boundingBoxEndpoints(const Block &_block, float o_e0[N], float o_e1[N])
+  {
+    float mn[N], mx[N], mean[N];
+    for (int c = 0; c < N; ++c)
+    {
+      mn[c] = 255.0f;
+      mx[c] = 0.0f;
+      mean[c] = 0.0f;
+    }
+    for (auto &p : _block.px)
+    {
+      for (int c = 0; c < N; ++c)
+      {
+        mn[c] = std::min(mn[c], p[c]);
+        mx[c] = std::max(mx[c], p[c]);
+        mean[c] += p[c] / 16.0f;
+      }
+    }
+    int ref = 0;
+    for (int c = 1; c < N; ++c)
+    {
+      if (mx[c] - mn[c] > mx[ref] - mn[ref])
+      {
+        ref = c;
+      }
+    }
+    for (int c = 0; c < N; ++c)
+    {
+      float cov = 0.0f;
+      for (auto &p : _block.px)
+      {
+        cov += (p[c] - mean[c]) * (p[ref] - mean[ref]);
+      }
+      if (cov < 0.0f)
+      {
+        std::swap(mn[c], mx[c]);
+      }
+      float inset = (mx[c] - mn[c]) / 16.0f;
+      o_e0[c] = mx[c] - inset;
+      o_e1[c] = mn[c] + inset;
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief endpoints from the extent of the block along its principal axis (power iteration on the covariance)
+  //----------------------------------------------------------------------------------------------------------------------
+  template <int N>
+  void principalAxisEndpoints(const Block &_block, float o_e0[N], float o_e1[N])
+  {
+    float mean[N] = {};
+    for (auto &p : _block.px)
+    {
+      for (int c = 0; c < N; ++c)
+      {
+        mean[c] += p[c] / 16.0f;
+      }
+    }
+    float cov[N][N] = {};
+    for (auto &p : _block.px)
+    {
+      for (int i = 0; i < N; ++i)
+      {
+        for (int j = 0; j < N; ++j)
+        {
+          cov[i][j] += (p[i] - mean[i]) * (p[j] - mean[j]);
+        }
+      }
+    }
+    // start from the bounding box diagonal which is usually close
+    float axis[N];
+    float e0[N], e1[N];
+    boundingBoxEndpoints<N>(_block, e0, e1);
+    for (int c = 0; c < N; ++c)
+    {
+      axis[c] = e0[c] - e1[c];
+    }
+    for (int iter = 0; iter < 8; ++iter)
+    {
+      float next[N] = {};
+      float len = 0.0f;
+      for (int i = 0; i < N; ++i)
+      {
+        for (int j = 0; j < N; ++j)
+        {
+          next[i] += cov[i][j] * axis[j];
+        }
+        len = std::max(len, std::abs(next[i]));
+      }
+      if (len < 1e-6f)
+      {
+        break;
+      }
+      for (int c = 0; c < N; ++c)
+      {
+        axis[c] = next[c] / len;
+      }
+    }
+    float len2 = 0.0f;
+    for (int c = 0; c < N; ++c)
+    {
+      len2 += axis[c] * axis[c];
+    }
+    if (len2 < 1e-8f)
+    {
+      // flat block
+      for (int c = 0; c < N; ++c)
+      {
+        o_e0[c] = o_e1[c] = mean[c];
+      }
+      return;
+    }
+    float tmin = 1e30f, tmax = -1e30f;
+    for (auto &p : _block.px)
+    {
+      float t = 0.0f;
+      for (int c = 0; c < N; ++c)
+      {
+        t += (p[c] - mean[c]) * axis[c];
+      }
+      tmin = std::min(tmin, t);
+      tmax = std::max(tmax, t);
+    }
+    for (int c = 0; c < N; ++c)
+    {
+      o_e0[c] = clampByte(mean[c] + axis[c] * tmax / len2);
+      o_e1[c] = clampByte(mean[c] + axis[c] * tmin / len2);
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief solve for the endpoints that best reproduce the block given the chosen indices, each pixel is
+  /// modelled as (1-w)*e0 + w*e1 where w is the weight of the index it uses
+  //----------------------------------------------------------------------------------------------------------------------
+  template <int N>
+  bool leastSquaresRefit(const Block &_block, const uint8_t _indices[16], const float *_weights, float o_e0[N], float o_e1[N])
+  {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float r0[N] = {}, r1[N] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+      float w = _weights[_indices[i]];
+      float iw = 1.0f - w;
+      a += iw * iw;
+      b += iw * w;
+      c += w * w;
+      for (int ch = 0; ch < N; ++ch)
+      {
+        r0[ch] += iw * _block.px[i][ch];
+        r1[ch] += w * _block.px[i][ch];
+      }
+    }
+    float det = a * c - b * b;
+    if (std::abs(det) < 1e-6f)
+    {
+      return false;
+    }
+    for (int ch = 0; ch < N; ++ch)
+    {
+      o_e0[ch] = clampByte((c * r0[ch] - b * r1[ch]) / det);
+      o_e1[ch] = clampByte((a * r1[ch] - b * r0[ch]) / det);
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  // BC1
+  //----------------------------------------------------------------------------------------------------------------------
+  // weight of colour1 for each of the 4 colour mode indices
+  constexpr float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+  uint16_t pack565(const float _c[3])
+  {
+    auto q = [](float _v, int _max)
+    { return static_cast<uint16_t>(std::lround(clampByte(_v) * _max / 255.0f)); };
+    return static_cast<uint16_t>((q(_c[0], 31) << 11) | (q(_c[1], 63) << 5) | q(_c[2], 31));
+  }
+
+  void unpack565(uint16_t _v, float o_c[3])
+  {
+    int r = _v >> 11, g = (_v >> 5) & 63, b = _v & 31;
+    o_c[0] = float((r << 3) | (r >> 2));
+    o_c[1] = float((g << 2) | (g >> 4));
+    o_c[2] = float((b << 3) | (b >> 2));
+  }
+
+  float bc1Indices(const Block &_block, uint16_t _c0, uint16_t _c1, uint8_t o_indices[16])
+  {
+    float palette[4][3];
+    unpack565(_c0, palette[0]);
+    unpack565(_c1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+      palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+      palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+      float best = 1e30f;
+      for (uint8_t k = 0; k < 4; ++k)
+      {
+        float err = 0.0f;
+        for (int c = 0; c < 3; ++c)
+        {
+          float d = _block.px[i][c] - palette[k][c];
+          err += d * d;
+        }
+        if (err < best)
+        {
+          best = err;
+          o_indices[i] = k;
+        }
+      }
+      total += best;
+    }
+    return total;
+  }
+
+  void writeBC1(uint16_t _c0, uint16_t _c1, uint8_t _indices[16], unsigned char *o_out)
+  {
+    // colour0 > colour1 selects the 4 colour mode, equal endpoints would select the 3 colour + transparent mode
+    if (_c0 < _c1)
+    {
+      std::swap(_c0, _c1);
+      for (int i = 0; i < 16; ++i)
+      {
+        _indices[i] ^= 1;
+      }
+    }
+    else if (_c0 == _c1)
+    {
+      std::fill(_indices, _indices + 16, uint8_t(0));
+    }
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      bits |= uint32_t(_indices[i]) << (2 * i);
+    }
+    o_out[0] = _c0 & 0xff;
+    o_out[1] = _c0 >> 8;
+    o_out[2] = _c1 & 0xff;
+    o_out[3] = _c1 >> 8;
+    std::memcpy(o_out + 4, &bits, 4);
+  }
+
+  void encodeBC1(const Block &_block, CompressionQuality _quality, unsigned char *o_out)
+  {
+    float e0[3], e1[3];
+    if (_quality == CompressionQuality::Fast)
+    {
+      boundingBoxEndpoints<3>(_block, e0, e1);
+    }
+    else
+    {
+      principalAxisEndpoints<3>(_block, e0, e1);
+    }
+    uint16_t c0 = pack565(e0), c1 = pack565(e1);
+    uint8_t indices[16];
+    float error = bc1Indices(_block, c0, c1, indices);
+    if (_quality == CompressionQuality::High)
+    {
+      for (int iter = 0; iter < 2; ++iter)
+      {
+        if (!leastSquaresRefit<3>(_block, indices, BC1_WEIGHTS, e0, e1))
+        {
+          break;
+        }
+        uint16_t n0 = pack565(e0), n1 = pack565(e1);
+        uint8_t nIndices[16];
+        float nError = bc1Indices(_block, n0, n1, nIndices);
+        if (nError >= error)
+        {
+          break;
+        }
+        c0 = n0;
+        c1 = n1;
+        error = nError;
+        std::copy(nIndices, nIndices + 16, indices);
+      }
+    }
+    writeBC1(c0, c1, indices, o_out);
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  // BC4, also used for the BC3 alpha and the two BC5 channels
+  //----------------------------------------------------------------------------------------------------------------------
+  void bc4Palette(int _a0, int _a1, float o_palette[8])
+  {
+    o_palette[0] = float(_a0);
+    o_palette[1] = float(_a1);
+    if (_a0 > _a1)
+    {
+      for (int k = 2; k < 8; ++k)
+      {
+        o_palette[k] = ((8 - k) * _a0 + (k - 1) * _a1) / 7.0f;
+      }
+    }
+    else
+    {
+      for (int k = 2; k < 6; ++k)
+      {
+        o_palette[k] = ((6 - k) * _a0 + (k - 1) * _a1) / 5.0f;
+      }
+      o_palette[6] = 0.0f;
+      o_palette[7] = 255.0f;
+    }
+  }
+
+  float bc4Indices(const float _values[16], int _a0, int _a1, uint8_t o_indices[16])
+  {
+    float palette[8];
+    bc4Palette(_a0, _a1, palette);
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+      float best = 1e30f;
+      for (uint8_t k = 0; k < 8; ++k)
+      {
+        float d = _values[i] - palette[k];
+        if (d * d < best)
+        {
+          best = d * d;
+          o_indices[i] = k;
+        }
+      }
+      total += best;
+    }
+    return total;
+  }
+
+  void encodeBC4(const float _values[16], CompressionQuality _quality, unsigned char *o_out)
+  {
+    float mn = 255.0f, mx = 0.0f;
+    float innerMin = 255.0f, innerMax = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+      mn = std::min(mn, _values[i]);
+      mx = std::max(mx, _values[i]);
+      if (_values[i] > 0.0f && _values[i] < 255.0f)
+      {
+        innerMin = std::min(innerMin, _values[i]);
+        innerMax = std::max(innerMax, _values[i]);
+      }
+    }
+    int a0 = int(std::lround(mx)), a1 = int(std::lround(mn));
+    uint8_t indices[16];
+    float error = bc4Indices(_values, a0, a1, indices);
+    if (_quality == CompressionQuality::High)
+    {
+      auto tryEndpoints = [&](int _n0, int _n1)
+      {
+        uint8_t nIndices[16];
+        float nError = bc4Indices(_values, _n0, _n1, nIndices);
+        if (nError < error)
+        {
+          error = nError;
+          a0 = _n0;
+          a1 = _n1;
+          std::copy(nIndices, nIndices + 16, indices);
+        }
+      };
+      // the 6 value mode has exact 0 and 255 so fit the endpoints to what is left
+      if (innerMin <= innerMax)
+      {
+        tryEndpoints(int(std::lround(innerMin)), int(std::lround(innerMax)));
+      }
+      if (a0 > a1)
+      {
+        float weights[8] = {0.0f, 1.0f};
+        for (int k = 2; k < 8; ++k)
+        {
+          weights[k] = (k - 1) / 7.0f;
+        }
+        Block block;
+        for (int i = 0; i < 16; ++i)
+        {
+          block.px[i][0] = _values[i];
+        }
+        float e0, e1;
+        if (leastSquaresRefit<1>(block, indices, weights, &e0, &e1))
+        {
+          int n0 = int(std::lround(e0)), n1 = int(std::lround(e1));
+          if (n0 < n1)
+          {
+            std::swap(n0, n1);
+          }
+          if (n0 != n1)
+          {
+            tryEndpoints(n0, n1);
+          }
+        }
+      }
+    }
+    o_out[0] = static_cast<unsigned char>(a0);
+    o_out[1] = static_cast<unsigned char>(a1);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+      bits |= uint64_t(indices[i]) << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+      o_out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+  }
+
+  void encodeChannel(const Block &_block, int _channel, CompressionQuality _quality, unsigned char *o_out)
+  {
+    float values[16];
+    for (int i = 0; i < 16; ++i)
+    {
+      values[i] = _block.px[i][_channel];
+    }
+    encodeBC4(values, _quality, o_out);
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  // BC7 mode 6, RGBA endpoints at 7 bits plus a p-bit each and 16 interpolated values
+  //----------------------------------------------------------------------------------------------------------------------
+  constexpr int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+  struct BC7Endpoints
+  {
+    int q[2][4];
+    int p[2];
+  };
+
+  void quantiseBC7(const float _e[4], int _p, int o_q[4])
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      o_q[c] = std::min(127, std::max(0, int(std::lround((_e[c] - _p) / 2.0f))));
+    }
+  }
+
+  float bc7Indices(const Block &_block, const BC7Endpoints &_ep, bool _exhaustive, uint8_t o_indices[16])
+  {
+    int v[2][4];
+    for (int e = 0; e < 2; ++e)
+    {
+      for (int c = 0; c < 4; ++c)
+      {
+        v[e][c] = (_ep.q[e][c] << 1) | _ep.p[e];
+      }
+    }
+    float palette[16][4];
+    for (int k = 0; k < 16; ++k)
+    {
+      for (int c = 0; c < 4; ++c)
+      {
+        palette[k][c] = float(((64 - BC7_WEIGHTS4[k]) * v[0][c] + BC7_WEIGHTS4[k] * v[1][c] + 32) >> 6);
+      }
+    }
+    float dir[4], dirLen2 = 0.0f;
+    for (int c = 0; c < 4; ++c)
+    {
+      dir[c] = float(v[1][c] - v[0][c]);
+      dirLen2 += dir[c] * dir[c];
+    }
+    auto error = [&](int _i, int _k)
+    {
+      float err = 0.0f;
+      for (int c = 0; c < 4; ++c)
+      {
+        float d = _block.px[_i][c] - palette[_k][c];
+        err += d * d;
+      }
+      return err;
+    };
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+      int first = 0, last = 15;
+      if (!_exhaustive && dirLen2 > 0.0f)
+      {
+        // project onto the endpoint line and only test the neighbouring weights
+        float t = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+          t += (_block.px[i][c] - v[0][c]) * dir[c];
+        }
+        int k = int(std::lround(std::min(1.0f, std::max(0.0f, t / dirLen2)) * 15.0f));
+        first = std::max(0, k - 1);
+        last = std::min(15, k + 1);
+      }
+      float best = 1e30f;
+      for (int k = first; k <= last; ++k)
+      {
+        float err = error(i, k);
+        if (err < best)
+        {
+          best = err;
+          o_indices[i] = static_cast<uint8_t>(k);
+        }
+      }
+      total += best;
+    }
+    return total;
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief pick the p-bits for a pair of float endpoints, High tries all four combinations against the block
+  //----------------------------------------------------------------------------------------------------------------------
+  float fitBC7(const Block &_block, const float _e0[4], const float _e1[4], CompressionQuality _quality,
+               BC7Endpoints &o_ep, uint8_t o_indices[16])
+  {
+    const float *e[2] = {_e0, _e1};
+    if (_quality == CompressionQuality::Fast)
+    {
+      for (int i = 0; i < 2; ++i)
+      {
+        float bestErr = 1e30f;
+        for (int p = 0; p < 2; ++p)
+        {
+          int q[4];
+          quantiseBC7(e[i], p, q);
+          float err = 0.0f;
+          for (int c = 0; c < 4; ++c)
+          {
+            float d = e[i][c] - float((q[c] << 1) | p);
+            err += d * d;
+          }
+          if (err < bestErr)
+          {
+            bestErr = err;
+            o_ep.p[i] = p;
+            std::copy(q, q + 4, o_ep.q[i]);
+          }
+        }
+      }
+      return bc7Indices(_block, o_ep, false, o_indices);
+    }
+    float bestErr = 1e30f;
+    for (int combo = 0; combo < 4; ++combo)
+    {
+      BC7Endpoints ep;
+      uint8_t indices[16];
+      for (int i = 0; i < 2; ++i)
+      {
+        ep.p[i] = (combo >> i) & 1;
+        quantiseBC7(e[i], ep.p[i], ep.q[i]);
+      }
+      float err = bc7Indices(_block, ep, true, indices);
+      if (err < bestErr)
+      {
+        bestErr = err;
+        o_ep = ep;
+        std::copy(indices, indices + 16, o_indices);
+      }
+    }
+    return bestErr;
+  }
+
+  struct BitWriter
+  {
+    unsigned char *out;
+    int pos = 0;
+    void write(uint32_t _value, int _bits)
+    {
+      for (int i = 0; i < _bits; ++i, ++pos)
+      {
+        if ((_value >> i) & 1)
+        {
+          out[pos >> 3] |= static_cast<unsigned char>(1 << (pos & 7));
+        }
+      }
+    }
+  };
+
+  void encodeBC7(const Block &_block, CompressionQuality _quality, unsigned char *o_out)
+  {
+    float e0[4], e1[4];
+    if (_quality == CompressionQuality::Fast)
+    {
+      boundingBoxEndpoints<4>(_block, e0, e1);
+    }
+    else
+    {
+      principalAxisEndpoints<4>(_block, e0, e1);
+    }
+    BC7Endpoints ep;
+    uint8_t indices[16];
+    float error = fitBC7(_block, e0, e1, _quality, ep, indices);
+    if (_quality == CompressionQuality::High)
+    {
+      float weights[16];
+      for (int k = 0; k < 16; ++k)
+      {
+        weights[k] = BC7_WEIGHTS4[k] / 64.0f;
+      }
+      for (int iter = 0; iter < 2; ++iter)
+      {
+        if (!leastSquaresRefit<4>(_block, indices, weights, e0, e1))
+        {
+          break;
+        }
+        BC7Endpoints nEp;
+        uint8_t nIndices[16];
+        float nError = fitBC7(_block, e0, e1, _quality, nEp, nIndices);
+        if (nError >= error)
+        {
+          break;
+        }
+        error = nError;
+        ep = nEp;
+        std::copy(nIndices, nIndices + 16, indices);
+      }
+    }
+    // the anchor (first) index only stores 3 bits so its top bit must be 0, swap the endpoints if it isn't
+    if (indices[0] >= 8)
+    {
+      std::swap(ep.q[0], ep.q[1]);
+      std::swap(ep.p[0], ep.p[1]);
+      for (auto &i : indices)
+      {
+        i = static_cast<uint8_t>(15 - i);
+      }
+    }
+    std::fill(o_out, o_out + 16, 0);
+    BitWriter bits{o_out};
+    // mode 6 is six 0 bits then a 1
+    bits.write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+      bits.write(uint32_t(ep.q[0][c]), 7);
+      bits.write(uint32_t(ep.q[1][c]), 7);
+    }
+    bits.write(uint32_t(ep.p[0]), 1);
+    bits.write(uint32_t(ep.p[1]), 1);
+    bits.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+    {
+      bits.write(indices[i], 4);
+    }
+  }
+
+  void encodeBlock(const Block &_block, BlockFormat _format, CompressionQuality _quality, unsigned char *o_out)
+  {
+    switch (_format)
+    {
+    case BlockFormat::BC1:
+      encodeBC1(_block, _quality, o_out);
+      break;
+    case BlockFormat::BC3:
+      encodeChannel(_block, 3, _quality, o_out);
+      encodeBC1(_block, _quality, o_out + 8);
+      break;
+    case BlockFormat::BC4:
+      encodeChannel(_block, 0, _quality, o_out);
+      break;
+    case BlockFormat::BC5:
+      encodeChannel(_block, 0, _quality, o_out);
+      encodeChannel(_block, 1, _quality, o_out + 8);
+      break;
+    case BlockFormat::BC7:
+      encodeBC7(_block, _quality, o_out);
+      break;
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief 2x2 box filter to the next mip level, odd sizes clamp at the edge
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<unsigned char> downsample(const unsigned char *_pixels, int _width, int _height, int _channels)
+  {
+    int w = std::max(1, _width / 2), h = std::max(1, _height / 2);
+    std::vector<unsigned char> out(size_t(w) * h * _channels);
+    ThreadPool::instance().parallelFor(size_t(h), [&](size_t _begin, size_t _end)
+    {
+      for (size_t y = _begin; y < _end; ++y)
+      {
+        int y0 = std::min(int(y) * 2, _height - 1), y1 = std::min(int(y) * 2 + 1, _height - 1);
+        for (int x = 0; x < w; ++x)
+        {
+          int x0 = std::min(x * 2, _width - 1), x1 = std::min(x * 2 + 1, _width - 1);
+          for (int c = 0; c < _channels; ++c)
+          {
+            int sum = _pixels[(size_t(y0) * _width + x0) * _channels + c] + _pixels[(size_t(y0) * _width + x1) * _channels + c] +
+                      _pixels[(size_t(y1) * _width + x0) * _channels + c] + _pixels[(size_t(y1) * _width + x1) * _channels + c];
+            out[(y * w + x) * _channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+          }
+        }
+      }
+    }, 16);
+    return out;
+  }
+} // end anon namespace
+
+size_t CompressedTexture::sizeInBytes() const
+{
+  size_t size = 0;
+  for (auto &l : levels)
+  {
+    size += l.data.size();
+  }
+  return size;
+}
+
+size_t BlockCompressor::blockBytes(BlockFormat _format)
+{
+  return (_format == BlockFormat::BC1 || _format == BlockFormat::BC4) ? 8 : 16;
+}
+
+GLenum BlockCompressor::internalFormat(BlockFormat _format)
+{
+  switch (_format)
+  {
+  case BlockFormat::BC1:
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case BlockFormat::BC3:
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case BlockFormat::BC4:
+    return GL_COMPRESSED_RED_RGTC1;
+  case BlockFormat::BC5:
+    return GL_COMPRESSED_RG_RGTC2;
+  case BlockFormat::BC7:
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  return GL_NONE;
+}
+
+const char *BlockCompressor::name(BlockFormat _format)
+{
+  constexpr const char *names[] = {"BC1", "BC3", "BC4", "BC5", "BC7"};
+  return names[static_cast<size_t>(_format)];
+}
+
+bool BlockCompressor::isSupported(BlockFormat _format)
+{
+  switch (_format)
+  {
+  case BlockFormat::BC1:
+  case BlockFormat::BC3:
+    return GLInfo::hasExtension("GL_EXT_texture_compression_s3tc");
+  case BlockFormat::BC4:
+  case BlockFormat::BC5:
+    return GLInfo::hasVersion(3, 0);
+  case BlockFormat::BC7:
+    return GLInfo::hasVersion(4, 2) || GLInfo::hasExtension("GL_ARB_texture_compression_bptc");
+  }
+  return false;
+}
+
+std::vector<unsigned char> BlockCompressor::compress(const unsigned char *_pixels, int _width, int _height, int _channels,
+                                                     BlockFormat _format, CompressionQuality _quality)
+{
+  int blocksX = (_width + 3) / 4;
+  int blocksY = (_height + 3) / 4;
+  size_t bytes = blockBytes(_format);
+  std::vector<unsigned char> out(size_t(blocksX) * blocksY * bytes);
+  // one job per row of blocks, rows are independent so there is no sharing between threads
+  ThreadPool::instance().parallelFor(size_t(blocksY), [&](size_t _begin, size_t _end)
+  {
+    Block block;
+    for (size_t by = _begin; by < _end; ++by)
+    {
+      for (int bx = 0; bx < blocksX; ++bx)
+      {
+        fetchBlock(_pixels, _width, _height, _channels, bx, int(by), block);
+        encodeBlock(block, _format, _quality, &out[(by * blocksX + bx) * bytes]);
+      }
+    }
+  });
+  return out;
+}
+
+CompressedTexture BlockCompressor::compressMipChain(const unsigned char *_pixels, int _width, int _height, int _channels,
+                                                    BlockFormat _format, CompressionQuality _quality)
+{
+  uint64_t params[] = {ENCODER_VERSION, uint64_t(_width), uint64_t(_height), uint64_t(_channels),
+                       uint64_t(_format), uint64_t(_quality)};
+  uint64_t key = fnv1a64(_pixels, size_t(_width) * _height * _channels, fnv1a64(params, sizeof(params)));
+  CompressedTexture texture;
+  std::vector<unsigned char> cached;
+  if (TextureCache::load(key, cached) && deserialise(cached, texture))
+  {
+    return texture;
+  }
+  texture.format = _format;
+  std::vector<unsigned char> level(_pixels, _pixels + size_t(_width) * _height * _channels);
+  int w = _width, h = _height;
+  for (;;)
+  {
+    texture.levels.push_back({w, h, compress(level.data(), w, h, _channels, _format, _quality)});
+    if (w == 1 && h == 1)
+    {
+      break;
+    }
+    level = downsample(level.data(), w, h, _channels);
+    w = std::max(1, w / 2);
+    h = std::max(1, h / 2);
+  }
+  auto blob = serialise(texture);
+  TextureCache::store(key, blob.data(), blob.size());
+  return texture;
+}
+
+GLuint BlockCompressor::createTexture(const CompressedTexture &_texture, const SamplerState &_sampler)
+{
+  if (_texture.levels.empty() || !isSupported(_texture.format))
+  {
+    std::cerr << "BlockCompressor: " << name(_texture.format) << " not supported by this context\n";
+    return 0;
+  }
+  GLenum format = internalFormat(_texture.format);
+  auto &base = _texture.levels.front();
+  GLuint id = TextureStorage::create(GL_TEXTURE_2D, GLsizei(_texture.levels.size()), format, base.width, base.height, 1,
+                                     _sampler);
+  for (size_t i = 0; i < _texture.levels.size(); ++i)
+  {
+    auto &l = _texture.levels[i];
+    TextureStorage::uploadCompressed(GL_TEXTURE_2D, id, GLint(i), 0, l.width, l.height, 1, format,
+                                     GLsizei(l.data.size()), l.data.data());
+  }
+  return id;
+}
+
+GLuint BlockCompressor::createFromFile(const std::string &_fname, BlockFormat _format, CompressionQuality _quality,
+                                      bool &o_compressed, size_t &o_bytes, const SamplerState &_sampler)
+{
+  o_compressed = false;
+  o_bytes = 0;
+  ngl::Image image;
+  if (!image.load(_fname))
+  {
+    std::cerr << "BlockCompressor: unable to load " << _fname << '\n';
+    return 0;
+  }
+  int width = int(image.width());
+  int height = int(image.height());
+  // checked first so an unsupported format doesn't pay for the compression
+  if (isSupported(_format))
+  {
+    int channels = image.format() == GL_RGBA ? 4 : 3;
+    auto compressed = compressMipChain(image.getPixels(), width, height, channels, _format, _quality);
+    GLuint id = createTexture(compressed, _sampler);
+    if (id != 0)
+    {
+      o_compressed = true;
+      o_bytes = compressed.sizeInBytes();
+      return id;
+    }
+  }
+  std::cerr << "BlockCompressor: " << name(_format) << " not available, " << _fname << " is uploaded as RGBA8\n";
+  GLsizei levels = TextureStorage::fullMipLevels(width, height);
+  GLuint id = TextureStorage::create(GL_TEXTURE_2D, levels, GL_RGBA8, width, height, 1, _sampler);
+  TextureStorage::upload(GL_TEXTURE_2D, id, 0, 0, width, height, 1, image.format(), GL_UNSIGNED_BYTE, image.getPixels());
+  TextureStorage::generateMipmaps(GL_TEXTURE_2D, id);
+  for (GLsizei l = 0; l < levels; ++l)
+  {
+    o_bytes += size_t(std::max(1, width >> l)) * size_t(std::max(1, height >> l)) * 4;
+  }
+  return id;
+}
+
+std::vector<unsigned char> BlockCompressor::serialise(const CompressedTexture &_texture)
+{
+  std::vector<unsigned char> out;
+  auto put = [&out](const void *_data, size_t _size)
+  {
+    auto bytes = static_cast<const unsigned char *>(_data);
+    out.insert(out.end(), bytes, bytes + _size);
+  };
+  uint32_t header[2] = {static_cast<uint32_t>(_texture.format), static_cast<uint32_t>(_texture.levels.size())};
+  put(header, sizeof(header));
+  for (auto &l : _texture.levels)
+  {
+    uint32_t size[3] = {uint32_t(l.width), uint32_t(l.height), uint32_t(l.data.size())};
+    put(size, sizeof(size));
+    put(l.data.data(), l.data.size());
+  }
+  return out;
+}
+
+bool BlockCompressor::deserialise(const std::vector<unsigned char> &_data, CompressedTexture &o_texture)
+{
+  size_t pos = 0;
+  auto get = [&](void *o_dst, size_t _size)
+  {
+    if (pos + _size > _data.size())
+    {
+      return false;
+    }
+    std::memcpy(o_dst, _data.data() + pos, _size);
+    pos += _size;
+    return true;
+  };
+  uint32_t header[2];
+  if (!get(header, sizeof(header)) || header[0] > static_cast<uint32_t>(BlockFormat::BC7))
+  {
+    return false;
+  }
+  o_texture.format = static_cast<BlockFormat>(header[0]);
+  o_texture.levels.resize(header[1]);
+  for (auto &l : o_texture.levels)
+  {
+    uint32_t size[3];
+    if (!get(size, sizeof(size)))
+    {
+      return false;
+    }
+    l.width = int(size[0]);
+    l.height = int(size[1]);
+    l.data.resize(size[2]);
+    if (!get(l.data.data(), l.data.size()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,142 @@
+#include "CubeImage.h"
+#include "CubeMipBuilder.h"
+#include "FloatImage.h"
+#include <algorithm>
+#include <cmath>
+
+CubeImage::CubeImage(int _size) : m_size(_size), m_data(size_t(_size) * size_t(_size) * 6 * 4, 0.0f)
+{
+}
+
+void CubeImage::direction(int _face, float _s, float _t, float o_dir[3])
+{
+  float sc = 2.0f * _s - 1.0f;
+  float tc = 2.0f * _t - 1.0f;
+  float x, y, z;
+  // the inverse of the major axis table in the GL spec (8.13 cube map texture selection)
+  switch (_face)
+  {
+  case 0 : x = 1.0f; y = -tc; z = -sc; break;
+  case 1 : x = -1.0f; y = -tc; z = sc; break;
+  case 2 : x = sc; y = 1.0f; z = tc; break;
+  case 3 : x = sc; y = -1.0f; z = -tc; break;
+  case 4 : x = sc; y = -tc; z = 1.0f; break;
+  default : x = -sc; y = -tc; z = -1.0f; break;
+  }
+  float invLen = 1.0f / std::sqrt(x * x + y * y + z * z);
+  o_dir[0] = x * invLen;
+  o_dir[1] = y * invLen;
+  o_dir[2] = z * invLen;
+}
+
+void CubeImage::faceCoordinates(const float _dir[3], int &o_face, float &o_s, float &o_t)
+{
+  float ax = std::fabs(_dir[0]);
+  float ay = std::fabs(_dir[1]);
+  float az = std::fabs(_dir[2]);
+  float ma, sc, tc;
+  if (ax >= ay && ax >= az)
+  {
+    o_face = _dir[0] > 0.0f ? 0 : 1;
+    ma = ax;
+    sc = _dir[0] > 0.0f ? -_dir[2] : _dir[2];
+    tc = -_dir[1];
+  }
+  else if (ay >= az)
+  {
+    o_face = _dir[1] > 0.0f ? 2 : 3;
+    ma = ay;
+    sc = _dir[0];
+    tc = _dir[1] > 0.0f ? _dir[2] : -_dir[2];
+  }
+  else
+  {
+    o_face = _dir[2] > 0.0f ? 4 : 5;
+    ma = az;
+    sc = _dir[2] > 0.0f ? _dir[0] : -_dir[0];
+    tc = -_dir[1];
+  }
+  o_s = 0.5f * (sc / ma + 1.0f);
+  o_t = 0.5f * (tc / ma + 1.0f);
+}
+
+namespace
+{
+  // integral of the solid angle from the face centre to (x,y) on the z=1 plane
+  float areaElement(float _x, float _y)
+  {
+    return std::atan2(_x * _y, std::sqrt(_x * _x + _y * _y + 1.0f));
+  }
+} // end anon namespace
+
+float CubeImage::texelSolidAngle(int _x, int _y, int _size)
+{
+  float inv = 1.0f / float(_size);
+  float x0 = 2.0f * float(_x) * inv - 1.0f;
+  float y0 = 2.0f * float(_y) * inv - 1.0f;
+  float x1 = x0 + 2.0f * inv;
+  float y1 = y0 + 2.0f * inv;
+  return areaElement(x0, y0) - areaElement(x0, y1) - areaElement(x1, y0) + areaElement(x1, y1);
+}
+
+Float4 CubeImage::sampleFace(int _face, float _s, float _t) const
+{
+  float fx = _s * float(m_size) - 0.5f;
+  float fy = _t * float(m_size) - 0.5f;
+  float flx = std::floor(fx);
+  float fly = std::floor(fy);
+  float tx = fx - flx;
+  float ty = fy - fly;
+  int last = m_size - 1;
+  int x0 = std::clamp(int(flx), 0, last);
+  int y0 = std::clamp(int(fly), 0, last);
+  int x1 = std::clamp(int(flx) + 1, 0, last);
+  int y1 = std::clamp(int(fly) + 1, 0, last);
+  Float4 top = Float4::lerp(Float4::load(texel(_face, x0, y0)), Float4::load(texel(_face, x1, y0)), tx);
+  Float4 bottom = Float4::lerp(Float4::load(texel(_face, x0, y1)), Float4::load(texel(_face, x1, y1)), tx);
+  return Float4::lerp(top, bottom, ty);
+}
+
+Float4 CubeImage::sample(const float _dir[3]) const
+{
+  int face;
+  float s, t;
+  faceCoordinates(_dir, face, s, t);
+  return sampleFace(face, s, t);
+}
+
+CubeImage CubeImage::fromBytes(const std::array<const unsigned char *, 6> &_faces, int _size, int _channels, bool _srgb)
+{
+  CubeImage out(_size);
+  for (int f = 0; f < 6; ++f)
+  {
+    FloatImage::decodeTexels(_faces[size_t(f)], size_t(_size) * size_t(_size), _channels, _srgb, out.face(f));
+  }
+  return out;
+}
+
+void CubeImage::toBytes(int _face, unsigned char *o_pixels, bool _srgb) const
+{
+  FloatImage::encodeTexels(face(_face), size_t(m_size) * size_t(m_size), _srgb, o_pixels);
+}
+
+CubeChain buildCubeChain(const CubeImage &_base)
+{
+  return CubeMipBuilder::build(_base);
+}
+
+Float4 sampleCubeChain(const CubeChain &_chain, const float _dir[3], float _lod)
+{
+  int face;
+  float s, t;
+  CubeImage::faceCoordinates(_dir, face, s, t);
+  float lod = std::clamp(_lod, 0.0f, float(_chain.size() - 1));
+  size_t l0 = size_t(lod);
+  size_t l1 = std::min(l0 + 1, _chain.size() - 1);
+  Float4 a = _chain[l0].sampleFace(face, s, t);
+  if (l1 == l0)
+  {
+    return a;
+  }
+  return Float4::lerp(a, _chain[l1].sampleFace(face, s, t), lod - float(l0));
+}
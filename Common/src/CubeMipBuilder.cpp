@@ -0,0 +1,129 @@
+#include "CubeMipBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+  using AdjacencyTable = std::array<std::array<CubeMipBuilder::Neighbour, 4>, 6>;
+
+  // derived once from the face direction math so it can't disagree with CubeImage::direction, step just
+  // off each edge a quarter of the way along and see where the direction lands
+  AdjacencyTable buildAdjacency()
+  {
+    AdjacencyTable table;
+    const float eps = 1e-3f;
+    const float along = 0.25f;
+    for (int f = 0; f < 6; ++f)
+    {
+      for (int e = 0; e < 4; ++e)
+      {
+        float s = e == CubeMipBuilder::Left ? -eps : e == CubeMipBuilder::Right ? 1.0f + eps : along;
+        float t = e == CubeMipBuilder::Top ? -eps : e == CubeMipBuilder::Bottom ? 1.0f + eps : along;
+        float dir[3];
+        CubeImage::direction(f, s, t, dir);
+        CubeMipBuilder::Neighbour &n = table[size_t(f)][size_t(e)];
+        float ns, nt;
+        CubeImage::faceCoordinates(dir, n.face, ns, nt);
+        // the closest edge of the new face is the one we crossed
+        const float distance[4] = {ns, 1.0f - ns, nt, 1.0f - nt};
+        n.edge = int(std::min_element(distance, distance + 4) - distance);
+        float nAlong = n.edge == CubeMipBuilder::Left || n.edge == CubeMipBuilder::Right ? nt : ns;
+        n.flip = nAlong > 0.5f;
+      }
+    }
+    return table;
+  }
+
+  const AdjacencyTable &adjacency()
+  {
+    static const AdjacencyTable table = buildAdjacency();
+    return table;
+  }
+} // end anon namespace
+
+const CubeMipBuilder::Neighbour &CubeMipBuilder::neighbour(int _face, int _edge)
+{
+  return adjacency()[size_t(_face)][size_t(_edge)];
+}
+
+const float *CubeMipBuilder::fetch(const CubeImage &_image, int _face, int _x, int _y)
+{
+  int size = _image.size();
+  int last = size - 1;
+  bool outX = _x < 0 || _x > last;
+  bool outY = _y < 0 || _y > last;
+  if (!outX && !outY)
+  {
+    return _image.texel(_face, _x, _y);
+  }
+  int edge, depth, position;
+  if (outX)
+  {
+    // only three faces meet at a corner so there is nothing diagonal to read, stay on the row
+    edge = _x < 0 ? Left : Right;
+    depth = _x < 0 ? -_x - 1 : _x - size;
+    position = std::clamp(_y, 0, last);
+  }
+  else
+  {
+    edge = _y < 0 ? Top : Bottom;
+    depth = _y < 0 ? -_y - 1 : _y - size;
+    position = _x;
+  }
+  const Neighbour &n = neighbour(_face, edge);
+  depth = std::min(depth, last);
+  if (n.flip)
+  {
+    position = last - position;
+  }
+  switch (n.edge)
+  {
+  case Left : return _image.texel(n.face, depth, position);
+  case Right : return _image.texel(n.face, last - depth, position);
+  case Top : return _image.texel(n.face, position, depth);
+  default : return _image.texel(n.face, position, last - depth);
+  }
+}
+
+CubeImage CubeMipBuilder::downsample(const CubeImage &_image)
+{
+  int half = std::max(1, _image.size() / 2);
+  CubeImage out(half);
+  const float tent[4] = {1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f};
+  // every row of every face is independent
+  ThreadPool::instance().parallelFor(size_t(6 * half), [&](size_t _begin, size_t _end)
+  {
+    for (size_t row = _begin; row < _end; ++row)
+    {
+      int f = int(row) / half;
+      int y = int(row) % half;
+      for (int x = 0; x < half; ++x)
+      {
+        Float4 sum;
+        for (int j = 0; j < 4; ++j)
+        {
+          Float4 line;
+          for (int i = 0; i < 4; ++i)
+          {
+            line += Float4::load(fetch(_image, f, 2 * x - 1 + i, 2 * y - 1 + j)) * tent[i];
+          }
+          sum += line * tent[j];
+        }
+        sum.store(out.texel(f, x, y));
+      }
+    }
+  });
+  return out;
+}
+
+CubeChain CubeMipBuilder::build(const CubeImage &_base, int _levels)
+{
+  CubeChain chain;
+  chain.push_back(_base);
+  while (chain.back().size() > 1 && (_levels <= 0 || int(chain.size()) < _levels))
+  {
+    chain.push_back(downsample(chain.back()));
+  }
+  return chain;
+}
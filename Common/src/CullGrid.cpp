@@ -0,0 +1,231 @@
+#include "CullGrid.h"
+#include "Float4.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  // spread the low 16 bits of _v to the even bits
+  uint32_t part1By1(uint32_t _v)
+  {
+    _v &= 0x0000ffff;
+    _v = (_v | (_v << 8)) & 0x00ff00ff;
+    _v = (_v | (_v << 4)) & 0x0f0f0f0f;
+    _v = (_v | (_v << 2)) & 0x33333333;
+    _v = (_v | (_v << 1)) & 0x55555555;
+    return _v;
+  }
+
+  uint32_t morton(uint32_t _x, uint32_t _z)
+  {
+    return part1By1(_x) | (part1By1(_z) << 1);
+  }
+
+  void sortBy(std::vector<float> &io_values, const std::vector<uint32_t> &_order)
+  {
+    std::vector<float> sorted(io_values.size());
+    for (size_t i = 0; i < _order.size(); ++i)
+    {
+      sorted[i] = io_values[_order[i]];
+    }
+    io_values.swap(sorted);
+  }
+} // end anon namespace
+
+void CullGrid::build(TransformArrays &io_instances, float _radius, size_t _leafInstances)
+{
+  size_t count = io_instances.size();
+  m_levels.clear();
+  m_order.resize(count);
+  if (count == 0)
+  {
+    return;
+  }
+  float minX = *std::min_element(io_instances.px.begin(), io_instances.px.end());
+  float maxX = *std::max_element(io_instances.px.begin(), io_instances.px.end());
+  float minZ = *std::min_element(io_instances.pz.begin(), io_instances.pz.end());
+  float maxZ = *std::max_element(io_instances.pz.begin(), io_instances.pz.end());
+  // the largest power of two side that still gives about _leafInstances per leaf
+  uint32_t depth = 0;
+  while (depth < 15 && (size_t(1) << (2 * (depth + 1))) * std::max<size_t>(1, _leafInstances) <= count)
+  {
+    ++depth;
+  }
+  uint32_t side = 1u << depth;
+  float cellX = std::max(maxX - minX, 1e-6f) / float(side);
+  float cellZ = std::max(maxZ - minZ, 1e-6f) / float(side);
+
+  // counting sort of the instances by the Morton code of their leaf
+  std::vector<uint32_t> code(count);
+  size_t leaves = size_t(side) * side;
+  std::vector<uint32_t> start(leaves + 1, 0);
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint32_t cx = std::min(side - 1, uint32_t(std::max(0.0f, (io_instances.px[i] - minX) / cellX)));
+    uint32_t cz = std::min(side - 1, uint32_t(std::max(0.0f, (io_instances.pz[i] - minZ) / cellZ)));
+    code[i] = morton(cx, cz);
+    ++start[code[i] + 1];
+  }
+  for (size_t l = 0; l < leaves; ++l)
+  {
+    start[l + 1] += start[l];
+  }
+  std::vector<uint32_t> next(start.begin(), start.end() - 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_order[next[code[i]]++] = uint32_t(i);
+  }
+  for (auto *values : {&io_instances.px, &io_instances.py, &io_instances.pz, &io_instances.rx, &io_instances.ry, &io_instances.rz})
+  {
+    sortBy(*values, m_order);
+  }
+
+  // leaf bounds from the sorted instances, then each level up is the union of its four children
+  m_levels.resize(depth + 1);
+  for (size_t level = 0; level <= depth; ++level)
+  {
+    size_t nodes = size_t(1) << (2 * level);
+    Level &l = m_levels[level];
+    for (auto *values : {&l.minX, &l.minY, &l.minZ, &l.maxX, &l.maxY, &l.maxZ})
+    {
+      values->assign(nodes, 0.0f);
+    }
+    l.first.assign(nodes, 0);
+    l.end.assign(nodes, 0);
+  }
+  Level &leafLevel = m_levels[depth];
+  const float inf = std::numeric_limits<float>::max();
+  for (size_t leaf = 0; leaf < leaves; ++leaf)
+  {
+    leafLevel.first[leaf] = start[leaf];
+    leafLevel.end[leaf] = start[leaf + 1];
+    float bounds[6] = {inf, inf, inf, -inf, -inf, -inf};
+    for (uint32_t i = start[leaf]; i < start[leaf + 1]; ++i)
+    {
+      bounds[0] = std::min(bounds[0], io_instances.px[i] - _radius);
+      bounds[1] = std::min(bounds[1], io_instances.py[i] - _radius);
+      bounds[2] = std::min(bounds[2], io_instances.pz[i] - _radius);
+      bounds[3] = std::max(bounds[3], io_instances.px[i] + _radius);
+      bounds[4] = std::max(bounds[4], io_instances.py[i] + _radius);
+      bounds[5] = std::max(bounds[5], io_instances.pz[i] + _radius);
+    }
+    // empty leaves keep zero bounds, they are skipped by their empty range
+    if (start[leaf] != start[leaf + 1])
+    {
+      leafLevel.minX[leaf] = bounds[0];
+      leafLevel.minY[leaf] = bounds[1];
+      leafLevel.minZ[leaf] = bounds[2];
+      leafLevel.maxX[leaf] = bounds[3];
+      leafLevel.maxY[leaf] = bounds[4];
+      leafLevel.maxZ[leaf] = bounds[5];
+    }
+  }
+  for (size_t level = depth; level-- > 0;)
+  {
+    Level &parent = m_levels[level];
+    const Level &child = m_levels[level + 1];
+    for (size_t n = 0; n < parent.first.size(); ++n)
+    {
+      parent.first[n] = child.first[4 * n];
+      parent.end[n] = child.end[4 * n + 3];
+      bool any = false;
+      for (size_t c = 4 * n; c < 4 * n + 4; ++c)
+      {
+        if (child.first[c] == child.end[c])
+        {
+          continue;
+        }
+        parent.minX[n] = any ? std::min(parent.minX[n], child.minX[c]) : child.minX[c];
+        parent.minY[n] = any ? std::min(parent.minY[n], child.minY[c]) : child.minY[c];
+        parent.minZ[n] = any ? std::min(parent.minZ[n], child.minZ[c]) : child.minZ[c];
+        parent.maxX[n] = any ? std::max(parent.maxX[n], child.maxX[c]) : child.maxX[c];
+        parent.maxY[n] = any ? std::max(parent.maxY[n], child.maxY[c]) : child.maxY[c];
+        parent.maxZ[n] = any ? std::max(parent.maxZ[n], child.maxZ[c]) : child.maxZ[c];
+        any = true;
+      }
+    }
+  }
+}
+
+void CullGrid::addRange(std::vector<CullRange> &o_ranges, uint32_t _first, uint32_t _end)
+{
+  if (_first == _end)
+  {
+    return;
+  }
+  if (!o_ranges.empty() && o_ranges.back().first + o_ranges.back().count == _first)
+  {
+    o_ranges.back().count += _end - _first;
+  }
+  else
+  {
+    o_ranges.push_back({_first, _end - _first});
+  }
+}
+
+void CullGrid::cull(const Frustum &_frustum, std::vector<CullRange> &o_ranges)
+{
+  o_ranges.clear();
+  m_nodesTested = 0;
+  if (m_levels.empty())
+  {
+    return;
+  }
+  if (m_levels.size() == 1)
+  {
+    const Level &root = m_levels[0];
+    ++m_nodesTested;
+    if (_frustum.boxVisible(ngl::Vec3(root.minX[0], root.minY[0], root.minZ[0]), ngl::Vec3(root.maxX[0], root.maxY[0], root.maxZ[0])))
+    {
+      addRange(o_ranges, root.first[0], root.end[0]);
+    }
+    return;
+  }
+  cullChildren(_frustum, 1, 0, o_ranges);
+}
+
+void CullGrid::cullChildren(const Frustum &_frustum, size_t _level, size_t _parent, std::vector<CullRange> &o_ranges)
+{
+  const Level &l = m_levels[_level];
+  size_t base = 4 * _parent;
+  m_nodesTested += 4;
+  // per plane the corner furthest along the normal (p) decides outside and the nearest (n) fully inside, the
+  // plane signs are the same for all four lanes so the corner is picked by array rather than per lane
+  Float4 minP(std::numeric_limits<float>::max());
+  Float4 minN(std::numeric_limits<float>::max());
+  for (size_t p = 0; p < 6; ++p)
+  {
+    const auto &plane = _frustum.plane(p);
+    Float4 lowX = Float4::load(&l.minX[base]), highX = Float4::load(&l.maxX[base]);
+    Float4 lowY = Float4::load(&l.minY[base]), highY = Float4::load(&l.maxY[base]);
+    Float4 lowZ = Float4::load(&l.minZ[base]), highZ = Float4::load(&l.maxZ[base]);
+    Float4 furthest = (plane[0] >= 0.0f ? highX : lowX) * plane[0] + (plane[1] >= 0.0f ? highY : lowY) * plane[1] +
+                      (plane[2] >= 0.0f ? highZ : lowZ) * plane[2] + Float4(plane[3]);
+    Float4 nearest = (plane[0] >= 0.0f ? lowX : highX) * plane[0] + (plane[1] >= 0.0f ? lowY : highY) * plane[1] +
+                     (plane[2] >= 0.0f ? lowZ : highZ) * plane[2] + Float4(plane[3]);
+    minP = Float4::min(minP, furthest);
+    minN = Float4::min(minN, nearest);
+  }
+  float p[4];
+  float n[4];
+  minP.store(p);
+  minN.store(n);
+  bool leaf = _level + 1 == m_levels.size();
+  for (size_t c = 0; c < 4; ++c)
+  {
+    size_t node = base + c;
+    if (l.first[node] == l.end[node] || p[c] < 0.0f)
+    {
+      continue;
+    }
+    if (leaf || n[c] >= 0.0f)
+    {
+      addRange(o_ranges, l.first[node], l.end[node]);
+    }
+    else
+    {
+      cullChildren(_frustum, _level + 1, node, o_ranges);
+    }
+  }
+}
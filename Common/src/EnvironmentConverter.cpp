@@ -0,0 +1,231 @@
+#include "EnvironmentConverter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr float PI = 3.14159265358979f;
+
+  int wrapIndex(int _i, int _size)
+  {
+    int r = _i % _size;
+    return r < 0 ? r + _size : r;
+  }
+
+  // Catmull-Rom weights for the four taps around a sample with fractional position _t
+  void cubicWeights(float _t, float o_w[4])
+  {
+    float t2 = _t * _t;
+    float t3 = t2 * _t;
+    o_w[0] = 0.5f * (-t3 + 2.0f * t2 - _t);
+    o_w[1] = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+    o_w[2] = 0.5f * (-3.0f * t3 + 4.0f * t2 + _t);
+    o_w[3] = 0.5f * (t3 - t2);
+  }
+
+  // filtered read of a w x h RGBA float grid at texel space position _x,_y (texel centres on .5), x either
+  // wraps (panoramas) or clamps, y always clamps
+  Float4 sampleGrid(const float *_data, int _w, int _h, float _x, float _y, bool _wrapX, Resample _filter)
+  {
+    float fx = _x - 0.5f;
+    float fy = _y - 0.5f;
+    float flx = std::floor(fx);
+    float fly = std::floor(fy);
+    float tx = fx - flx;
+    float ty = fy - fly;
+    int ix = int(flx);
+    int iy = int(fly);
+    auto column = [&](int _i) { return _wrapX ? wrapIndex(_i, _w) : std::clamp(_i, 0, _w - 1); };
+    auto row = [&](int _i) { return std::clamp(_i, 0, _h - 1); };
+    auto at = [&](int _cx, int _ry) { return Float4::load(_data + (size_t(_ry) * size_t(_w) + size_t(_cx)) * 4); };
+    if (_filter == Resample::Bilinear)
+    {
+      int x0 = column(ix);
+      int x1 = column(ix + 1);
+      int y0 = row(iy);
+      int y1 = row(iy + 1);
+      return Float4::lerp(Float4::lerp(at(x0, y0), at(x1, y0), tx), Float4::lerp(at(x0, y1), at(x1, y1), tx), ty);
+    }
+    float wx[4];
+    float wy[4];
+    cubicWeights(tx, wx);
+    cubicWeights(ty, wy);
+    int xs[4] = {column(ix - 1), column(ix), column(ix + 1), column(ix + 2)};
+    Float4 sum;
+    for (int j = 0; j < 4; ++j)
+    {
+      int y = row(iy - 1 + j);
+      Float4 line = at(xs[0], y) * wx[0] + at(xs[1], y) * wx[1] + at(xs[2], y) * wx[2] + at(xs[3], y) * wx[3];
+      sum += line * wy[j];
+    }
+    // Catmull-Rom overshoots at hard edges, negative radiance makes no sense
+    return Float4::max(sum, Float4(0.0f));
+  }
+
+  // fill every texel of a w x h image from a direction lookup, rows in parallel
+  template <typename Mapping, typename Lookup>
+  void resample(float *o_data, int _w, int _h, Mapping _mapping, Lookup _lookup)
+  {
+    ThreadPool::instance().parallelFor(size_t(_h), [&](size_t _begin, size_t _end)
+    {
+      for (size_t y = _begin; y < _end; ++y)
+      {
+        for (int x = 0; x < _w; ++x)
+        {
+          float dir[3];
+          _mapping((float(x) + 0.5f) / float(_w), (float(y) + 0.5f) / float(_h), dir);
+          _lookup(dir).store(o_data + (y * size_t(_w) + size_t(x)) * 4);
+        }
+      }
+    });
+  }
+} // end anon namespace
+
+void EnvironmentConverter::equirectDirection(float _u, float _v, float o_dir[3])
+{
+  float phi = (_u - 0.5f) * 2.0f * PI;
+  float theta = _v * PI;
+  float sinTheta = std::sin(theta);
+  o_dir[0] = sinTheta * std::sin(phi);
+  o_dir[1] = std::cos(theta);
+  o_dir[2] = -sinTheta * std::cos(phi);
+}
+
+void EnvironmentConverter::equirectCoordinates(const float _dir[3], float &o_u, float &o_v)
+{
+  o_u = 0.5f + std::atan2(_dir[0], -_dir[2]) / (2.0f * PI);
+  o_v = std::acos(std::clamp(_dir[1], -1.0f, 1.0f)) / PI;
+}
+
+void EnvironmentConverter::octahedralDirection(float _u, float _v, float o_dir[3])
+{
+  float x = 2.0f * _u - 1.0f;
+  float y = 2.0f * _v - 1.0f;
+  float z = 1.0f - std::fabs(x) - std::fabs(y);
+  if (z < 0.0f)
+  {
+    // unfold the lower hemisphere from the corners
+    float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  float invLen = 1.0f / std::sqrt(x * x + y * y + z * z);
+  o_dir[0] = x * invLen;
+  o_dir[1] = y * invLen;
+  o_dir[2] = z * invLen;
+}
+
+void EnvironmentConverter::octahedralCoordinates(const float _dir[3], float &o_u, float &o_v)
+{
+  float invL1 = 1.0f / (std::fabs(_dir[0]) + std::fabs(_dir[1]) + std::fabs(_dir[2]));
+  float x = _dir[0] * invL1;
+  float y = _dir[1] * invL1;
+  if (_dir[2] < 0.0f)
+  {
+    float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  o_u = 0.5f * x + 0.5f;
+  o_v = 0.5f * y + 0.5f;
+}
+
+Float4 EnvironmentConverter::sampleEquirect(const FloatImage &_equirect, const float _dir[3], Resample _filter)
+{
+  float u, v;
+  equirectCoordinates(_dir, u, v);
+  return sampleGrid(_equirect.data(), _equirect.width(), _equirect.height(), u * float(_equirect.width()),
+                    v * float(_equirect.height()), true, _filter);
+}
+
+Float4 EnvironmentConverter::sampleCube(const CubeImage &_cube, const float _dir[3], Resample _filter)
+{
+  int face;
+  float s, t;
+  CubeImage::faceCoordinates(_dir, face, s, t);
+  int size = _cube.size();
+  return sampleGrid(_cube.face(face), size, size, s * float(size), t * float(size), false, _filter);
+}
+
+CubeImage EnvironmentConverter::equirectToCube(const FloatImage &_equirect, int _faceSize, Resample _filter)
+{
+  CubeImage cube(_faceSize);
+  for (int f = 0; f < 6; ++f)
+  {
+    resample(cube.face(f), _faceSize, _faceSize,
+             [f](float _s, float _t, float *o_dir) { CubeImage::direction(f, _s, _t, o_dir); },
+             [&](const float *_dir) { return sampleEquirect(_equirect, _dir, _filter); });
+  }
+  return cube;
+}
+
+FloatImage EnvironmentConverter::cubeToEquirect(const CubeImage &_cube, int _width, Resample _filter)
+{
+  FloatImage out(_width, std::max(1, _width / 2));
+  resample(out.data(), out.width(), out.height(), equirectDirection,
+           [&](const float *_dir) { return sampleCube(_cube, _dir, _filter); });
+  return out;
+}
+
+FloatImage EnvironmentConverter::cubeToOctahedral(const CubeImage &_cube, int _size, Resample _filter)
+{
+  FloatImage out(_size, _size);
+  resample(out.data(), _size, _size, octahedralDirection,
+           [&](const float *_dir) { return sampleCube(_cube, _dir, _filter); });
+  return out;
+}
+
+FloatImage EnvironmentConverter::equirectToOctahedral(const FloatImage &_equirect, int _size, Resample _filter)
+{
+  FloatImage out(_size, _size);
+  resample(out.data(), _size, _size, octahedralDirection,
+           [&](const float *_dir) { return sampleEquirect(_equirect, _dir, _filter); });
+  return out;
+}
+
+FloatImage EnvironmentConverter::downsampleOctahedral(const FloatImage &_octahedral)
+{
+  int size = _octahedral.width();
+  int half = std::max(1, size / 2);
+  FloatImage out(half, half);
+  // crossing an edge of the octahedral square lands on the same edge mirrored, e.g. (-1,y) is (0,size-1-y)
+  auto fetch = [&](int _x, int _y)
+  {
+    if (_x < 0 || _x >= size)
+    {
+      _x = _x < 0 ? -_x - 1 : 2 * size - 1 - _x;
+      _y = size - 1 - _y;
+    }
+    if (_y < 0 || _y >= size)
+    {
+      _y = _y < 0 ? -_y - 1 : 2 * size - 1 - _y;
+      _x = size - 1 - _x;
+    }
+    return Float4::load(_octahedral.texel(std::clamp(_x, 0, size - 1), std::clamp(_y, 0, size - 1)));
+  };
+  const float tent[4] = {1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f};
+  ThreadPool::instance().parallelFor(size_t(half), [&](size_t _begin, size_t _end)
+  {
+    for (size_t y = _begin; y < _end; ++y)
+    {
+      for (int x = 0; x < half; ++x)
+      {
+        Float4 sum;
+        for (int j = 0; j < 4; ++j)
+        {
+          Float4 line;
+          for (int i = 0; i < 4; ++i)
+          {
+            line += fetch(2 * x - 1 + i, 2 * int(y) - 1 + j) * tent[i];
+          }
+          sum += line * tent[j];
+        }
+        sum.store(out.texel(x, int(y)));
+      }
+    }
+  });
+  return out;
+}
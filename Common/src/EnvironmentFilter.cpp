@@ -0,0 +1,129 @@
+#include "EnvironmentFilter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr float PI = 3.14159265358979f;
+
+  struct LobeSample
+  {
+    // direction in the tangent frame of N (z up)
+    float x, y, z;
+    float weight;
+    float lod;
+  };
+
+  float radicalInverse(uint32_t _bits)
+  {
+    _bits = (_bits << 16u) | (_bits >> 16u);
+    _bits = ((_bits & 0x55555555u) << 1u) | ((_bits & 0xAAAAAAAAu) >> 1u);
+    _bits = ((_bits & 0x33333333u) << 2u) | ((_bits & 0xCCCCCCCCu) >> 2u);
+    _bits = ((_bits & 0x0F0F0F0Fu) << 4u) | ((_bits & 0xF0F0F0F0u) >> 4u);
+    _bits = ((_bits & 0x00FF00FFu) << 8u) | ((_bits & 0xFF00FF00u) >> 8u);
+    return float(_bits) * 2.3283064365386963e-10f;
+  }
+
+  // with N = V the sample set only depends on the roughness, so it is built once per level and rotated
+  // into each texel's frame rather than regenerated per texel
+  std::vector<LobeSample> buildLobe(float _roughness, unsigned int _samples, int _sourceSize)
+  {
+    std::vector<LobeSample> lobe;
+    lobe.reserve(_samples);
+    float a = _roughness * _roughness;
+    float a2 = a * a;
+    float texelSolidAngle = 4.0f * PI / (6.0f * float(_sourceSize) * float(_sourceSize));
+    for (unsigned int i = 0; i < _samples; ++i)
+    {
+      float u = float(i) / float(_samples);
+      float v = radicalInverse(i);
+      float phi = 2.0f * PI * u;
+      float cosTheta = std::sqrt((1.0f - v) / (1.0f + (a2 - 1.0f) * v));
+      float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+      float hx = sinTheta * std::cos(phi);
+      float hy = sinTheta * std::sin(phi);
+      float hz = cosTheta;
+      // reflect V = (0,0,1) about H
+      LobeSample s;
+      s.x = 2.0f * hz * hx;
+      s.y = 2.0f * hz * hy;
+      s.z = 2.0f * hz * hz - 1.0f;
+      if (s.z <= 0.0f)
+      {
+        continue;
+      }
+      // pdf of L is D * NdotH / (4 VdotH) which is D / 4 when N = V
+      float d = hz * hz * (a2 - 1.0f) + 1.0f;
+      float D = a2 / (PI * d * d);
+      float pdf = D * 0.25f;
+      float sampleSolidAngle = 1.0f / (float(_samples) * pdf + 1e-6f);
+      s.lod = std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f);
+      s.weight = s.z;
+      lobe.push_back(s);
+    }
+    return lobe;
+  }
+} // end anon namespace
+
+float EnvironmentFilter::levelRoughness(int _level, int _levels)
+{
+  return _levels > 1 ? float(_level) / float(_levels - 1) : 0.0f;
+}
+
+CubeChain EnvironmentFilter::prefilterGGX(const CubeImage &_source, int _levels, unsigned int _samples)
+{
+  CubeChain result;
+  if (_source.empty() || _levels < 1)
+  {
+    return result;
+  }
+  CubeChain sourceChain = buildCubeChain(_source);
+  result.push_back(_source);
+  for (int level = 1; level < _levels; ++level)
+  {
+    int size = std::max(1, _source.size() >> level);
+    CubeImage out(size);
+    std::vector<LobeSample> lobe = buildLobe(levelRoughness(level, _levels), _samples, _source.size());
+    ThreadPool::instance().parallelFor(size_t(6 * size), [&](size_t _begin, size_t _end)
+    {
+      for (size_t row = _begin; row < _end; ++row)
+      {
+        int face = int(row) / size;
+        int y = int(row) % size;
+        for (int x = 0; x < size; ++x)
+        {
+          float n[3];
+          CubeImage::direction(face, (float(x) + 0.5f) / float(size), (float(y) + 0.5f) / float(size), n);
+          // tangent frame around N
+          float up[3] = {0.0f, 0.0f, 1.0f};
+          if (std::fabs(n[2]) > 0.999f)
+          {
+            up[0] = 1.0f;
+            up[2] = 0.0f;
+          }
+          float t[3] = {up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0]};
+          float invLen = 1.0f / std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+          t[0] *= invLen;
+          t[1] *= invLen;
+          t[2] *= invLen;
+          float b[3] = {n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0]};
+
+          Float4 sum;
+          float weight = 0.0f;
+          for (auto &s : lobe)
+          {
+            float l[3] = {t[0] * s.x + b[0] * s.y + n[0] * s.z,
+                          t[1] * s.x + b[1] * s.y + n[1] * s.z,
+                          t[2] * s.x + b[2] * s.y + n[2] * s.z};
+            sum += sampleCubeChain(sourceChain, l, s.lod) * s.weight;
+            weight += s.weight;
+          }
+          (sum * (weight > 0.0f ? 1.0f / weight : 0.0f)).store(out.texel(face, x, y));
+        }
+      }
+    });
+    result.push_back(std::move(out));
+  }
+  return result;
+}
@@ -0,0 +1,54 @@
+#include "FloatImage.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+FloatImage::FloatImage(int _width, int _height)
+  : m_width(_width), m_height(_height), m_data(size_t(_width) * size_t(_height) * 4, 0.0f)
+{
+}
+
+FloatImage FloatImage::fromBytes(const unsigned char *_pixels, int _width, int _height, int _channels, bool _srgb)
+{
+  FloatImage out(_width, _height);
+  decodeTexels(_pixels, size_t(_width) * size_t(_height), _channels, _srgb, out.data());
+  return out;
+}
+
+void FloatImage::toBytes(unsigned char *o_pixels, bool _srgb) const
+{
+  encodeTexels(data(), size_t(m_width) * size_t(m_height), _srgb, o_pixels);
+}
+
+void FloatImage::decodeTexels(const unsigned char *_src, size_t _count, int _channels, bool _srgb, float *o_dst)
+{
+  std::array<float, 256> lut;
+  for (int i = 0; i < 256; ++i)
+  {
+    float v = float(i) / 255.0f;
+    lut[size_t(i)] = _srgb ? std::pow(v, 2.2f) : v;
+  }
+  for (size_t i = 0; i < _count; ++i, _src += _channels, o_dst += 4)
+  {
+    o_dst[0] = lut[_src[0]];
+    o_dst[1] = _channels >= 3 ? lut[_src[1]] : o_dst[0];
+    o_dst[2] = _channels >= 3 ? lut[_src[2]] : o_dst[0];
+    o_dst[3] = _channels == 4 ? float(_src[3]) / 255.0f : 1.0f;
+  }
+}
+
+void FloatImage::encodeTexels(const float *_src, size_t _count, bool _srgb, unsigned char *o_dst)
+{
+  for (size_t i = 0; i < _count; ++i, _src += 4, o_dst += 4)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      float v = std::clamp(_src[c], 0.0f, 1.0f);
+      if (_srgb && c < 3)
+      {
+        v = std::pow(v, 1.0f / 2.2f);
+      }
+      o_dst[c] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+  }
+}
@@ -0,0 +1,395 @@
+#include "FrameProfiler.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+  double elapsedMs(std::chrono::steady_clock::time_point _start, std::chrono::steady_clock::time_point _end)
+  {
+    return std::chrono::duration<double, std::milli>(_end - _start).count();
+  }
+
+  // -1 marks a pass that wasn't run or timed, the column is left empty
+  std::string csvValue(const std::vector<double> &_values, size_t _index)
+  {
+    return _index < _values.size() && _values[_index] >= 0.0 ? fmt::format("{:.4f}", _values[_index]) : std::string();
+  }
+} // end anon namespace
+
+void RollingStats::add(double _value)
+{
+  if (m_values.size() < WINDOW)
+  {
+    m_values.push_back(_value);
+  }
+  else
+  {
+    m_values[m_next] = _value;
+  }
+  m_next = (m_next + 1) % WINDOW;
+  ++m_count;
+  m_total += _value;
+}
+
+RollingStats::Summary RollingStats::summary() const
+{
+  Summary result;
+  if (m_values.empty())
+  {
+    return result;
+  }
+  std::vector<double> sorted(m_values);
+  result.min = *std::min_element(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (double value : sorted)
+  {
+    sum += value;
+  }
+  result.avg = sum / double(sorted.size());
+  // nearest rank, with fewer than 100 values this is the maximum
+  size_t rank = (sorted.size() * 99 + 99) / 100 - 1;
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  result.p99 = sorted[rank];
+  return result;
+}
+
+void RollingStats::reset()
+{
+  m_values.clear();
+  m_next = 0;
+  m_count = 0;
+  m_total = 0.0;
+}
+
+FrameProfiler::~FrameProfiler()
+{
+  if (m_recording)
+  {
+    stopRecording();
+  }
+  for (auto &pass : m_passes)
+  {
+    for (auto &slot : pass.slots)
+    {
+      for (auto &query : slot.queries)
+      {
+        glDeleteQueries(1, &query.id);
+      }
+    }
+  }
+}
+
+void FrameProfiler::beginFrame()
+{
+  if (!m_inFlight.empty() && !m_inFlight.back().ended)
+  {
+    endFrame();
+  }
+  auto now = std::chrono::steady_clock::now();
+  collect();
+  FrameRecord record;
+  record.index = ++m_frame;
+  record.passCpu.assign(m_passes.size(), -1.0);
+  record.passGpu.assign(m_passes.size(), -1.0);
+  if (m_hasFrame)
+  {
+    record.frameTime = elapsedMs(m_frameStart, now);
+    m_frameTime.add(record.frameTime);
+  }
+  m_inFlight.push_back(std::move(record));
+  m_frameStart = now;
+  m_hasFrame = true;
+}
+
+void FrameProfiler::endFrame()
+{
+  if (m_inFlight.empty() || m_inFlight.back().ended)
+  {
+    return;
+  }
+  endPass();
+  auto &record = m_inFlight.back();
+  record.cpuTime = elapsedMs(m_frameStart, std::chrono::steady_clock::now());
+  record.ended = true;
+  m_cpuTime.add(record.cpuTime);
+  retire();
+}
+
+void FrameProfiler::beginPass(const std::string &_name)
+{
+  if (m_inFlight.empty() || m_inFlight.back().ended)
+  {
+    std::cerr << "FrameProfiler::beginPass " << _name << " outside beginFrame / endFrame\n";
+    return;
+  }
+  endPass();
+  size_t index = passIndex(_name);
+  if (index == m_passes.size())
+  {
+    m_passes.emplace_back();
+    m_passes.back().name = _name;
+  }
+  auto &record = m_inFlight.back();
+  QuerySlot &slot = m_passes[index].slots[m_frame % FRAMES];
+  if (slot.frame != m_frame)
+  {
+    slot.frame = m_frame;
+    slot.used = 0;
+  }
+  // each run of the pass this frame has its own query, created the first time a frame needs that many
+  if (slot.used == slot.queries.size())
+  {
+    slot.queries.emplace_back();
+    glGenQueries(1, &slot.queries.back().id);
+  }
+  Query &query = slot.queries[slot.used++];
+  // the query from two frames back, a result still in flight is not waited on, this run goes untimed instead
+  if (query.pending)
+  {
+    collect();
+  }
+  if (!query.pending)
+  {
+    glBeginQuery(GL_TIME_ELAPSED, query.id);
+    query.pending = true;
+    query.frame = m_frame;
+    m_activeQuery = &query;
+    ++record.pending;
+  }
+  else
+  {
+    record.complete = false;
+  }
+  m_activePass = int(index);
+  m_passStart = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::endPass()
+{
+  if (m_activePass < 0)
+  {
+    return;
+  }
+  if (m_activeQuery != nullptr)
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_activeQuery = nullptr;
+  }
+  Pass &pass = m_passes[size_t(m_activePass)];
+  double time = elapsedMs(m_passStart, std::chrono::steady_clock::now());
+  pass.cpuTime.add(time);
+  auto &record = m_inFlight.back();
+  record.passCpu.resize(m_passes.size(), -1.0);
+  // a pass run more than once in a frame adds up, the GPU side does the same as its results come in
+  double &cpu = record.passCpu[size_t(m_activePass)];
+  cpu = std::max(cpu, 0.0) + time;
+  m_activePass = -1;
+}
+
+void FrameProfiler::collect()
+{
+  for (size_t p = 0; p < m_passes.size(); ++p)
+  {
+    Pass &pass = m_passes[p];
+    for (auto &slot : pass.slots)
+    {
+      for (auto &query : slot.queries)
+      {
+        // the active query can't be asked about until it has ended
+        if (!query.pending || &query == m_activeQuery)
+        {
+          continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+        {
+          continue;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &ns);
+        query.pending = false;
+        double time = double(ns) / 1.0e6;
+        pass.gpuTime.add(time);
+        // the frame may already have been given up on, the result still counts for the pass
+        auto record = std::find_if(m_inFlight.begin(), m_inFlight.end(),
+                                   [&query](const FrameRecord &_record) { return _record.index == query.frame; });
+        if (record != m_inFlight.end())
+        {
+          record->passGpu.resize(m_passes.size(), -1.0);
+          record->passGpu[p] = std::max(record->passGpu[p], 0.0) + time;
+          --record->pending;
+        }
+      }
+    }
+  }
+  retire();
+}
+
+void FrameProfiler::retire()
+{
+  // in order, so the recording stays sorted by frame. A GPU that falls far behind gets its oldest frames dropped
+  // unfinished rather than growing the queue
+  while (!m_inFlight.empty() && m_inFlight.front().ended &&
+         (m_inFlight.front().pending == 0 || m_inFlight.size() > FRAMES * 4))
+  {
+    FrameRecord &record = m_inFlight.front();
+    if (record.pending != 0)
+    {
+      record.complete = false;
+    }
+    double gpu = 0.0;
+    bool timed = false;
+    for (double time : record.passGpu)
+    {
+      if (time >= 0.0)
+      {
+        gpu += time;
+        timed = true;
+      }
+    }
+    if (timed && record.complete)
+    {
+      m_gpuTime.add(gpu);
+    }
+    if (m_recording)
+    {
+      m_records.push_back(std::move(record));
+    }
+    m_inFlight.pop_front();
+  }
+}
+
+size_t FrameProfiler::passIndex(const std::string &_name) const
+{
+  auto found = std::find_if(m_passes.begin(), m_passes.end(), [&_name](const Pass &_pass) { return _pass.name == _name; });
+  return size_t(found - m_passes.begin());
+}
+
+double FrameProfiler::fps() const
+{
+  double avg = m_frameTime.summary().avg;
+  return avg > 0.0 ? 1000.0 / avg : 0.0;
+}
+
+void FrameProfiler::reset()
+{
+  m_frameTime.reset();
+  m_cpuTime.reset();
+  m_gpuTime.reset();
+  for (auto &pass : m_passes)
+  {
+    pass.cpuTime.reset();
+    pass.gpuTime.reset();
+  }
+}
+
+int FrameProfiler::draw(ngl::Text &_text, int _x, int _y) const
+{
+  auto frame = m_frameTime.summary();
+  auto cpu = m_cpuTime.summary();
+  auto gpu = m_gpuTime.summary();
+  _text.renderText(_x, _y, fmt::format("{:.1f} fps, frame min {:.2f} avg {:.2f} p99 {:.2f} ms", fps(), frame.min, frame.avg, frame.p99));
+  _y -= 20;
+  _text.renderText(_x, _y, fmt::format("CPU min {:.2f} avg {:.2f} p99 {:.2f} ms, GPU min {:.2f} avg {:.2f} p99 {:.2f} ms", cpu.min,
+                                       cpu.avg, cpu.p99, gpu.min, gpu.avg, gpu.p99));
+  _y -= 20;
+  for (const auto &pass : m_passes)
+  {
+    auto passCpu = pass.cpuTime.summary();
+    auto passGpu = pass.gpuTime.summary();
+    _text.renderText(_x, _y, fmt::format("  {} CPU avg {:.3f} p99 {:.3f} ms, GPU min {:.3f} avg {:.3f} p99 {:.3f} ms", pass.name,
+                                         passCpu.avg, passCpu.p99, passGpu.min, passGpu.avg, passGpu.p99));
+    _y -= 20;
+  }
+  _text.renderText(_x, _y, m_recording ? fmt::format("recording {} frames to {} (P to stop)", m_records.size(), m_recordPath)
+                                       : std::string("P to record per frame CSV"));
+  return _y - 20;
+}
+
+std::string FrameProfiler::summary() const
+{
+  auto frame = m_frameTime.summary();
+  return fmt::format("{:.0f} fps, frame {:.2f} ms p99 {:.2f}, CPU {:.2f} ms, GPU {:.2f} ms{}", fps(), frame.avg, frame.p99,
+                     m_cpuTime.summary().avg, m_gpuTime.summary().avg, m_recording ? ", recording" : "");
+}
+
+bool FrameProfiler::summaryDue()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now - m_summaryTime < std::chrono::seconds(1))
+  {
+    return false;
+  }
+  m_summaryTime = now;
+  return true;
+}
+
+void FrameProfiler::startRecording(const std::string &_path)
+{
+  m_records.clear();
+  m_recordPath = _path;
+  m_recording = true;
+}
+
+bool FrameProfiler::stopRecording()
+{
+  if (!m_recording)
+  {
+    return false;
+  }
+  m_recording = false;
+  bool written = writeCsv();
+  if (written)
+  {
+    std::cout << "wrote " << m_records.size() << " frames to " << m_recordPath << "\n";
+  }
+  m_records.clear();
+  return written;
+}
+
+void FrameProfiler::toggleRecording(const std::string &_path)
+{
+  if (m_recording)
+  {
+    stopRecording();
+  }
+  else
+  {
+    startRecording(_path);
+  }
+}
+
+bool FrameProfiler::writeCsv() const
+{
+  std::ofstream file(m_recordPath);
+  if (!file)
+  {
+    std::cerr << "FrameProfiler can't write " << m_recordPath << "\n";
+    return false;
+  }
+  file << "frame,frame_ms,cpu_ms,gpu_ms";
+  for (const auto &pass : m_passes)
+  {
+    file << ',' << pass.name << "_cpu_ms," << pass.name << "_gpu_ms";
+  }
+  file << '\n';
+  for (const auto &record : m_records)
+  {
+    double gpu = 0.0;
+    for (double time : record.passGpu)
+    {
+      gpu += std::max(time, 0.0);
+    }
+    file << fmt::format("{},{:.4f},{:.4f},{}", record.index, record.frameTime, record.cpuTime,
+                        record.complete ? fmt::format("{:.4f}", gpu) : std::string());
+    for (size_t p = 0; p < m_passes.size(); ++p)
+    {
+      file << ',' << csvValue(record.passCpu, p) << ',' << csvValue(record.passGpu, p);
+    }
+    file << '\n';
+  }
+  return bool(file);
+}
@@ -0,0 +1,152 @@
+#include "FrameUniforms.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  size_t alignUp(size_t _value, size_t _alignment)
+  {
+    return (_value + _alignment - 1) / _alignment * _alignment;
+  }
+} // end anon namespace
+
+FrameUniforms::~FrameUniforms()
+{
+  for (auto &fence : m_fences)
+  {
+    glDeleteSync(fence);
+  }
+  glDeleteBuffers(1, &m_buffer);
+}
+
+void FrameUniforms::bindBlocks(GLuint _program)
+{
+  GLuint frame = glGetUniformBlockIndex(_program, "FrameData");
+  if (frame != GL_INVALID_INDEX)
+  {
+    glUniformBlockBinding(_program, frame, FRAME_BINDING);
+  }
+  GLuint object = glGetUniformBlockIndex(_program, "ObjectData");
+  if (object != GL_INVALID_INDEX)
+  {
+    glUniformBlockBinding(_program, object, OBJECT_BINDING);
+  }
+}
+
+void FrameUniforms::beginFrame(const ngl::Mat4 &_view, const ngl::Mat4 &_project)
+{
+  m_frame.view = _view;
+  m_frame.projection = _project;
+  m_frame.viewProjection = _project * _view;
+  // the view is rigid so the eye is -R^T t
+  for (size_t i = 0; i < 3; ++i)
+  {
+    m_frame.eye[i] = -(_view.m_m[i][0] * _view.m_m[3][0] + _view.m_m[i][1] * _view.m_m[3][1] + _view.m_m[i][2] * _view.m_m[3][2]);
+  }
+  m_frame.eye[3] = 1.0f;
+  m_objects.clear();
+}
+
+size_t FrameUniforms::addObject(const ngl::Mat4 &_model)
+{
+  ObjectData object;
+  object.model = _model;
+  object.MVP = m_frame.viewProjection * _model;
+  object.normalMatrix = {{{{1.0f, 0.0f, 0.0f, 0.0f}}, {{0.0f, 1.0f, 0.0f, 0.0f}}, {{0.0f, 0.0f, 1.0f, 0.0f}}}};
+  m_objects.push_back(object);
+  return m_objects.size() - 1;
+}
+
+size_t FrameUniforms::addObject(const ngl::Mat4 &_model, const ngl::Mat3 &_normalMatrix)
+{
+  size_t slot = addObject(_model);
+  auto &normal = m_objects[slot].normalMatrix;
+  for (size_t c = 0; c < 3; ++c)
+  {
+    normal[c] = {{_normalMatrix.m_m[c][0], _normalMatrix.m_m[c][1], _normalMatrix.m_m[c][2], 0.0f}};
+  }
+  return slot;
+}
+
+void FrameUniforms::reserve(size_t _objects)
+{
+  if (m_buffer != 0 && m_segmentSize >= m_frameStride + _objects * m_objectStride)
+  {
+    return;
+  }
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  m_frameStride = alignUp(sizeof(FrameData), size_t(alignment));
+  m_objectStride = alignUp(sizeof(ObjectData), size_t(alignment));
+  // grow in powers of two so a scene that keeps adding objects doesn't reallocate every frame
+  size_t capacity = 64;
+  while (capacity < _objects)
+  {
+    capacity *= 2;
+  }
+  m_segmentSize = alignUp(m_frameStride + capacity * m_objectStride, size_t(alignment));
+  for (auto &fence : m_fences)
+  {
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (m_buffer == 0)
+  {
+    glGenBuffers(1, &m_buffer);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(m_segmentSize * FRAMES), nullptr, GL_STREAM_DRAW);
+  m_segment = 0;
+  m_uploaded = false;
+}
+
+void FrameUniforms::upload()
+{
+  reserve(m_objects.size());
+  // a second upload in the same frame (e.g. a capture pass) fences the segment it leaves behind
+  if (m_buffer != 0 && m_fences[m_segment] == nullptr && m_uploaded)
+  {
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_uploaded = true;
+  m_segment = (m_segment + 1) % FRAMES;
+  // wait for the GPU to finish the frame that last used this segment, normally long done
+  GLsync &fence = m_fences[m_segment];
+  if (fence != nullptr)
+  {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  size_t base = m_segment * m_segmentSize;
+  size_t bytes = m_frameStride + m_objects.size() * m_objectStride;
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  auto *dst = static_cast<unsigned char *>(glMapBufferRange(GL_UNIFORM_BUFFER, GLintptr(base), GLsizeiptr(bytes),
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+  if (dst != nullptr)
+  {
+    std::memcpy(dst, &m_frame, sizeof(FrameData));
+    for (size_t i = 0; i < m_objects.size(); ++i)
+    {
+      std::memcpy(dst + m_frameStride + i * m_objectStride, &m_objects[i], sizeof(ObjectData));
+    }
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, m_buffer, GLintptr(base), GLsizeiptr(sizeof(FrameData)));
+}
+
+void FrameUniforms::bindObject(size_t _slot)
+{
+  GLintptr offset = GLintptr(m_segment * m_segmentSize + m_frameStride + _slot * m_objectStride);
+  glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, m_buffer, offset, GLsizeiptr(sizeof(ObjectData)));
+}
+
+void FrameUniforms::endFrame()
+{
+  if (m_uploaded && m_fences[m_segment] == nullptr)
+  {
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_uploaded = false;
+}
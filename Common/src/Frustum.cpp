@@ -0,0 +1,53 @@
+#include "Frustum.h"
+#include <cmath>
+
+Frustum::Frustum(const ngl::Mat4 &_viewProject)
+{
+  // m_m is column major, row r of the matrix is m_m[0..3][r]
+  const auto &m = _viewProject.m_m;
+  for (size_t p = 0; p < 6; ++p)
+  {
+    size_t row = p / 2;
+    float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+    for (size_t c = 0; c < 4; ++c)
+    {
+      m_planes[p][c] = m[c][3] + sign * m[c][row];
+    }
+    float length = std::sqrt(m_planes[p][0] * m_planes[p][0] + m_planes[p][1] * m_planes[p][1] + m_planes[p][2] * m_planes[p][2]);
+    if (length > 0.0f)
+    {
+      for (auto &v : m_planes[p])
+      {
+        v /= length;
+      }
+    }
+  }
+}
+
+bool Frustum::sphereVisible(const ngl::Vec3 &_centre, float _radius) const
+{
+  for (const auto &plane : m_planes)
+  {
+    if (plane[0] * _centre.m_x + plane[1] * _centre.m_y + plane[2] * _centre.m_z + plane[3] < -_radius)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::boxVisible(const ngl::Vec3 &_min, const ngl::Vec3 &_max) const
+{
+  for (const auto &plane : m_planes)
+  {
+    // the corner furthest along the plane normal
+    float x = plane[0] >= 0.0f ? _max.m_x : _min.m_x;
+    float y = plane[1] >= 0.0f ? _max.m_y : _min.m_y;
+    float z = plane[2] >= 0.0f ? _max.m_z : _min.m_z;
+    if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
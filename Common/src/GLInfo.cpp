@@ -0,0 +1,26 @@
+#include "GLInfo.h"
+#include <cstring>
+
+bool GLInfo::hasVersion(int _major, int _minor)
+{
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  return major > _major || (major == _major && minor >= _minor);
+}
+
+bool GLInfo::hasExtension(const char *_name)
+{
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i)
+  {
+    auto ext = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    if (ext != nullptr && std::strcmp(ext, _name) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,191 @@
+#include "HDRImage.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+  bool hasExtension(const std::string &_fname, const char *_ext)
+  {
+    size_t len = std::strlen(_ext);
+    if (_fname.size() < len)
+    {
+      return false;
+    }
+    for (size_t i = 0; i < len; ++i)
+    {
+      char c = _fname[_fname.size() - len + i];
+      if (c >= 'A' && c <= 'Z')
+      {
+        c = char(c - 'A' + 'a');
+      }
+      if (c != _ext[i])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // new style RLE, each channel of the scanline is run length encoded separately
+  bool readRLEScanline(const unsigned char *&_p, const unsigned char *_end, int _width, unsigned char *o_rgbe)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      int x = 0;
+      while (x < _width)
+      {
+        if (_p >= _end)
+        {
+          return false;
+        }
+        int count = *_p++;
+        if (count > 128)
+        {
+          count -= 128;
+          if (x + count > _width || _p >= _end)
+          {
+            return false;
+          }
+          unsigned char value = *_p++;
+          for (int i = 0; i < count; ++i)
+          {
+            o_rgbe[(x++) * 4 + c] = value;
+          }
+        }
+        else
+        {
+          if (count == 0 || x + count > _width || _p + count > _end)
+          {
+            return false;
+          }
+          for (int i = 0; i < count; ++i)
+          {
+            o_rgbe[(x++) * 4 + c] = *_p++;
+          }
+        }
+      }
+    }
+    return true;
+  }
+} // end anon namespace
+
+bool HDRImage::isHDR(const std::string &_fname)
+{
+  return hasExtension(_fname, ".hdr") || hasExtension(_fname, ".exr");
+}
+
+bool HDRImage::load(const std::string &_fname, FloatImage &o_image)
+{
+  if (hasExtension(_fname, ".exr"))
+  {
+    std::cerr << "HDRImage: OpenEXR is not supported, convert " << _fname << " to .hdr\n";
+    return false;
+  }
+  std::ifstream file(_fname, std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "HDRImage: unable to open " << _fname << '\n';
+    return false;
+  }
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  const unsigned char *p = data.data();
+  const unsigned char *end = p + data.size();
+  auto readLine = [&]()
+  {
+    std::string line;
+    while (p < end && *p != '\n')
+    {
+      line += char(*p++);
+    }
+    if (p < end)
+    {
+      ++p;
+    }
+    return line;
+  };
+
+  std::string line = readLine();
+  if (line != "#?RADIANCE" && line != "#?RGBE")
+  {
+    std::cerr << "HDRImage: " << _fname << " is not a Radiance file\n";
+    return false;
+  }
+  // header ends with a blank line, a missing FORMAT means RGBE so only an explicit other format (XYZE) is refused
+  bool rgbe = true;
+  while (p < end && !(line = readLine()).empty())
+  {
+    if (line.compare(0, 7, "FORMAT=") == 0)
+    {
+      rgbe = line == "FORMAT=32-bit_rle_rgbe";
+    }
+  }
+  // the resolution string gives the scanline axis then the axis along a scanline, each with its direction. +Y is
+  // up and +X right, so the usual -Y h +X w is scanlines top to bottom each running left to right
+  char sign[2];
+  char axis[2];
+  int count[2];
+  line = readLine();
+  if (!rgbe || std::sscanf(line.c_str(), " %c%c %d %c%c %d", &sign[0], &axis[0], &count[0], &sign[1], &axis[1], &count[1]) != 6 ||
+      (sign[0] != '-' && sign[0] != '+') || (sign[1] != '-' && sign[1] != '+') || (axis[0] != 'X' && axis[0] != 'Y') ||
+      (axis[1] != 'X' && axis[1] != 'Y') || axis[0] == axis[1] || count[0] <= 0 || count[1] <= 0)
+  {
+    std::cerr << "HDRImage: unsupported header in " << _fname << '\n';
+    return false;
+  }
+  bool rowMajor = axis[0] == 'Y';
+  int width = rowMajor ? count[1] : count[0];
+  int height = rowMajor ? count[0] : count[1];
+  int length = count[1];
+  // where each scanline and each texel along it lands in the top to bottom, left to right image
+  auto position = [&](int _index, int _size, char _sign, char _axis)
+  {
+    bool forward = _axis == 'X' ? _sign == '+' : _sign == '-';
+    return forward ? _index : _size - 1 - _index;
+  };
+
+  o_image = FloatImage(width, height);
+  std::vector<unsigned char> scanline(size_t(length) * 4);
+  for (int s = 0; s < count[0]; ++s)
+  {
+    bool rle = length >= 8 && length < 32768 && end - p >= 4 && p[0] == 2 && p[1] == 2 && (p[2] & 0x80) == 0 &&
+               ((p[2] << 8) | p[3]) == length;
+    if (rle)
+    {
+      p += 4;
+      if (!readRLEScanline(p, end, length, scanline.data()))
+      {
+        std::cerr << "HDRImage: corrupt scanline " << s << " in " << _fname << '\n';
+        return false;
+      }
+    }
+    else
+    {
+      // flat (old style RLE is not written by anything current)
+      if (end - p < length * 4)
+      {
+        std::cerr << "HDRImage: " << _fname << " is truncated\n";
+        return false;
+      }
+      std::memcpy(scanline.data(), p, scanline.size());
+      p += scanline.size();
+    }
+    int scan = position(s, count[0], sign[0], axis[0]);
+    for (int i = 0; i < length; ++i)
+    {
+      int along = position(i, length, sign[1], axis[1]);
+      float *dst = rowMajor ? o_image.texel(along, scan) : o_image.texel(scan, along);
+      const unsigned char *e = &scanline[size_t(i) * 4];
+      float scale = e[3] != 0 ? std::ldexp(1.0f, int(e[3]) - (128 + 8)) : 0.0f;
+      dst[0] = float(e[0]) * scale;
+      dst[1] = float(e[1]) * scale;
+      dst[2] = float(e[2]) * scale;
+      dst[3] = 1.0f;
+    }
+  }
+  return true;
+}
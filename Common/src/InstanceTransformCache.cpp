@@ -0,0 +1,168 @@
+#include "InstanceTransformCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <new>
+
+void InstanceTransformCache::AlignedDelete::operator()(ngl::Mat4 *_p) const
+{
+  ::operator delete(_p, std::align_val_t(ALIGNMENT));
+}
+
+InstanceTransformCache::~InstanceTransformCache()
+{
+  for (auto &chunk : m_chunks)
+  {
+    glDeleteBuffers(1, &chunk.buffer);
+  }
+}
+
+void InstanceTransformCache::reset(size_t _count, Generator _generator)
+{
+  reset(_count, [_generator](size_t _begin, size_t _end, ngl::Mat4 *o_matrices)
+  {
+    for (size_t i = _begin; i < _end; ++i)
+    {
+      o_matrices[i - _begin] = _generator(i);
+    }
+  });
+}
+
+void InstanceTransformCache::reset(size_t _count, RangeGenerator _generator)
+{
+  m_count = _count;
+  // chunks are only ever added, shrinking keeps the spare ones for the next time the count grows
+  while (m_chunks.size() < numChunks())
+  {
+    Chunk chunk;
+    // Mat4 is trivially copyable, the generator overwrites every entry before it is read
+    chunk.matrices.reset(static_cast<ngl::Mat4 *>(::operator new(CHUNK_SIZE * sizeof(ngl::Mat4),
+                                                                 std::align_val_t(ALIGNMENT))));
+    std::uninitialized_default_construct_n(chunk.matrices.get(), CHUNK_SIZE);
+    m_chunks.push_back(std::move(chunk));
+  }
+  m_generator = std::move(_generator);
+  markAllDirty();
+}
+
+void InstanceTransformCache::markDirty(size_t _index)
+{
+  if (_index < m_count && m_dirty[_index] == 0)
+  {
+    m_dirty[_index] = 1;
+    ++m_numDirty;
+  }
+}
+
+void InstanceTransformCache::markDirty(size_t _begin, size_t _end)
+{
+  for (size_t i = _begin; i < std::min(_end, m_count); ++i)
+  {
+    markDirty(i);
+  }
+}
+
+void InstanceTransformCache::markAllDirty()
+{
+  m_dirty.assign(m_count, 1);
+  m_numDirty = m_count;
+}
+
+size_t InstanceTransformCache::update()
+{
+  if (m_numDirty == 0)
+  {
+    return 0;
+  }
+  const uint8_t *dirty = m_dirty.data();
+  ThreadPool::instance().parallelFor(m_count, [&](size_t _begin, size_t _end)
+  {
+    // runs of dirty entries within the range go to the generator together, split where a chunk ends
+    size_t i = _begin;
+    while (i < _end)
+    {
+      if (dirty[i] == 0)
+      {
+        ++i;
+        continue;
+      }
+      size_t limit = std::min(_end, (i / CHUNK_SIZE + 1) * CHUNK_SIZE);
+      size_t end = i;
+      while (end < limit && dirty[end] != 0)
+      {
+        ++end;
+      }
+      m_generator(i, end, m_chunks[i / CHUNK_SIZE].matrices.get() + i % CHUNK_SIZE);
+      i = end;
+    }
+  }, 1024);
+  return m_numDirty;
+}
+
+size_t InstanceTransformCache::upload()
+{
+  bool bound = false;
+  for (size_t c = 0; c < numChunks(); ++c)
+  {
+    Chunk &chunk = m_chunks[c];
+    if (chunk.buffer == 0)
+    {
+      // every chunk buffer is allocated at full size once, so a growing count never reallocates the earlier ones
+      glGenBuffers(1, &chunk.buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, chunk.buffer);
+      glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(CHUNK_SIZE * sizeof(ngl::Mat4)), nullptr, GL_DYNAMIC_DRAW);
+      bound = true;
+    }
+  }
+  // a static field costs nothing past this point, no binds and no pass over the dirty flags
+  if (m_numDirty == 0)
+  {
+    if (bound)
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    return 0;
+  }
+  size_t bytes = 0;
+  size_t remaining = m_numDirty;
+  for (size_t c = 0; c < numChunks() && remaining != 0; ++c)
+  {
+    Chunk &chunk = m_chunks[c];
+    uint8_t *dirty = m_dirty.data() + c * CHUNK_SIZE;
+    size_t count = chunkCount(c);
+    bool chunkBound = false;
+    // one glBufferSubData per run of consecutive dirty entries, the chunk is only bound once it has one
+    size_t i = 0;
+    while (i < count && remaining != 0)
+    {
+      if (dirty[i] == 0)
+      {
+        ++i;
+        continue;
+      }
+      size_t end = i;
+      while (end < count && dirty[end] != 0)
+      {
+        ++end;
+      }
+      if (!chunkBound)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.buffer);
+        chunkBound = true;
+        bound = true;
+      }
+      size_t runBytes = (end - i) * sizeof(ngl::Mat4);
+      glBufferSubData(GL_ARRAY_BUFFER, GLintptr(i * sizeof(ngl::Mat4)), GLsizeiptr(runBytes), chunk.matrices.get() + i);
+      bytes += runBytes;
+      // only the uploaded run is cleared, the rest of the flags are already 0
+      std::fill(dirty + i, dirty + end, uint8_t(0));
+      remaining -= end - i;
+      i = end;
+    }
+  }
+  if (bound)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  m_numDirty = 0;
+  return bytes;
+}
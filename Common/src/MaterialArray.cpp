@@ -0,0 +1,53 @@
+#include "MaterialArray.h"
+#include <iostream>
+
+MaterialArray::~MaterialArray()
+{
+  glDeleteTextures(1, &m_id);
+}
+
+void MaterialArray::create(GLsizei _width, GLsizei _height, GLsizei _capacity, const SamplerState &_sampler)
+{
+  glDeleteTextures(1, &m_id);
+  m_layers.clear();
+  m_width = _width;
+  m_height = _height;
+  m_capacity = _capacity;
+  m_id = TextureStorage::create(GL_TEXTURE_2D_ARRAY, TextureStorage::fullMipLevels(_width, _height), GL_RGBA8, _width,
+                                _height, _capacity, _sampler);
+}
+
+int MaterialArray::add(const std::string &_name, const void *_pixels, GLenum _format, GLsizei _width, GLsizei _height)
+{
+  auto existing = m_layers.find(_name);
+  if (existing != m_layers.end())
+  {
+    return existing->second;
+  }
+  if (_width != m_width || _height != m_height)
+  {
+    std::cerr << "MaterialArray " << _name << " is " << _width << "x" << _height << ", the array is " << m_width << "x"
+              << m_height << "\n";
+    return -1;
+  }
+  if (GLsizei(m_layers.size()) == m_capacity)
+  {
+    std::cerr << "MaterialArray is full, " << _name << " was not added\n";
+    return -1;
+  }
+  int layer = int(m_layers.size());
+  TextureStorage::upload(GL_TEXTURE_2D_ARRAY, m_id, 0, layer, _width, _height, 1, _format, GL_UNSIGNED_BYTE, _pixels);
+  m_layers.emplace(_name, layer);
+  return layer;
+}
+
+void MaterialArray::generateMipmaps()
+{
+  TextureStorage::generateMipmaps(GL_TEXTURE_2D_ARRAY, m_id);
+}
+
+int MaterialArray::layer(const std::string &_name) const
+{
+  auto found = m_layers.find(_name);
+  return found != m_layers.end() ? found->second : -1;
+}
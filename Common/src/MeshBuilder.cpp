@@ -0,0 +1,205 @@
+#include "MeshBuilder.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+  size_t componentSize(AttributeFormat _format)
+  {
+    return _format == AttributeFormat::Float ? sizeof(float) : sizeof(uint16_t);
+  }
+
+  // IEEE half with round to nearest even, overflow goes to infinity and tiny values to subnormals / zero
+  uint16_t toHalf(float _value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &_value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t biased = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+    if (biased == 0xffu)
+    {
+      return uint16_t(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+    }
+    int exponent = int(biased) - 127 + 15;
+    if (exponent >= 31)
+    {
+      return uint16_t(sign | 0x7c00u);
+    }
+    if (exponent <= 0)
+    {
+      if (exponent < -10)
+      {
+        return uint16_t(sign);
+      }
+      mantissa |= 0x800000u;
+      uint32_t shift = uint32_t(14 - exponent);
+      uint32_t half = mantissa >> shift;
+      uint32_t rest = mantissa & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (half & 1u) != 0))
+      {
+        ++half;
+      }
+      return uint16_t(sign | half);
+    }
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fffu;
+    // a carry out of the mantissa correctly bumps the exponent
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u) != 0))
+    {
+      ++half;
+    }
+    return uint16_t(sign | half);
+  }
+
+  int16_t toNormalizedShort(float _value)
+  {
+    return int16_t(std::lround(std::min(1.0f, std::max(-1.0f, _value)) * 32767.0f));
+  }
+} // end anon namespace
+
+VertexLayout::VertexLayout(std::initializer_list<VertexAttribute> _attributes) : m_attributes(_attributes)
+{
+  for (const auto &attribute : m_attributes)
+  {
+    m_offsets.push_back(m_stride);
+    // every attribute starts 4 byte aligned, some drivers fall back to a slow path otherwise
+    m_stride += (size_t(attribute.components) * componentSize(attribute.format) + 3) / 4 * 4;
+    m_numComponents += size_t(attribute.components);
+  }
+}
+
+void VertexLayout::apply() const
+{
+  for (size_t i = 0; i < m_attributes.size(); ++i)
+  {
+    const auto &attribute = m_attributes[i];
+    GLenum type = GL_FLOAT;
+    if (attribute.format == AttributeFormat::HalfFloat)
+    {
+      type = GL_HALF_FLOAT;
+    }
+    else if (attribute.format == AttributeFormat::NormalizedShort)
+    {
+      type = GL_SHORT;
+    }
+    glVertexAttribPointer(attribute.location, attribute.components, type,
+                          attribute.format == AttributeFormat::NormalizedShort ? GL_TRUE : GL_FALSE, GLsizei(m_stride),
+                          reinterpret_cast<const void *>(m_offsets[i]));
+    glEnableVertexAttribArray(attribute.location);
+  }
+}
+
+void Mesh::attach() const
+{
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  layout.apply();
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // the element buffer binding is part of the VAO state
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+void Mesh::release()
+{
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vertexBuffer);
+  glDeleteBuffers(1, &indexBuffer);
+  vao = vertexBuffer = indexBuffer = 0;
+}
+
+MeshBuilder::MeshBuilder(const VertexLayout &_layout) : m_layout(_layout)
+{
+}
+
+uint32_t MeshBuilder::addVertex(const float *_values)
+{
+  // pack first so vertices that only differ below the storage precision share an index
+  size_t stride = m_layout.stride();
+  std::vector<unsigned char> packed(stride, 0);
+  const auto &attributes = m_layout.attributes();
+  for (size_t a = 0; a < attributes.size(); ++a)
+  {
+    unsigned char *dst = packed.data() + m_layout.offset(a);
+    for (GLint c = 0; c < attributes[a].components; ++c)
+    {
+      float value = *_values++;
+      switch (attributes[a].format)
+      {
+      case AttributeFormat::Float:
+        std::memcpy(dst + c * sizeof(float), &value, sizeof(float));
+        break;
+      case AttributeFormat::HalfFloat:
+      {
+        uint16_t half = toHalf(value);
+        std::memcpy(dst + c * sizeof(uint16_t), &half, sizeof(uint16_t));
+        break;
+      }
+      case AttributeFormat::NormalizedShort:
+      {
+        int16_t normalized = toNormalizedShort(value);
+        std::memcpy(dst + c * sizeof(int16_t), &normalized, sizeof(int16_t));
+        break;
+      }
+      }
+    }
+  }
+  auto &matches = m_lookup[fnv1a64(packed.data(), stride)];
+  for (uint32_t index : matches)
+  {
+    if (std::memcmp(m_vertices.data() + index * stride, packed.data(), stride) == 0)
+    {
+      m_indices.push_back(index);
+      return index;
+    }
+  }
+  uint32_t index = uint32_t(m_numVertices++);
+  m_vertices.insert(m_vertices.end(), packed.begin(), packed.end());
+  matches.push_back(index);
+  m_indices.push_back(index);
+  return index;
+}
+
+uint32_t MeshBuilder::addVertex(std::initializer_list<float> _values)
+{
+  if (_values.size() != m_layout.numComponents())
+  {
+    std::cerr << "MeshBuilder::addVertex expected " << m_layout.numComponents() << " values, got " << _values.size() << "\n";
+    return 0;
+  }
+  return addVertex(_values.begin());
+}
+
+Mesh MeshBuilder::upload(GLenum _usage) const
+{
+  Mesh mesh;
+  mesh.layout = m_layout;
+  mesh.numVertices = m_numVertices;
+  mesh.numIndices = GLsizei(m_indices.size());
+  glGenVertexArrays(1, &mesh.vao);
+  glBindVertexArray(mesh.vao);
+  glGenBuffers(1, &mesh.vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_vertices.size()), m_vertices.data(), _usage);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glGenBuffers(1, &mesh.indexBuffer);
+  mesh.attach();
+  if (m_numVertices <= 65536)
+  {
+    std::vector<uint16_t> indices(m_indices.begin(), m_indices.end());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(indices.size() * sizeof(uint16_t)), indices.data(), _usage);
+    mesh.indexType = GL_UNSIGNED_SHORT;
+  }
+  else
+  {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(m_indices.size() * sizeof(uint32_t)), m_indices.data(), _usage);
+    mesh.indexType = GL_UNSIGNED_INT;
+  }
+  // unbind the VAO first so the element buffer stays attached to it
+  glBindVertexArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  return mesh;
+}
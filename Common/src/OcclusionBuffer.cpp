@@ -0,0 +1,229 @@
+#include "OcclusionBuffer.h"
+#include "Float4.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // clip w below this is treated as crossing the near plane
+  constexpr float MIN_W = 1e-4f;
+  // triangles reaching further off screen than this (in pixels) are skipped, the edge functions lose too much
+  // precision to stay conservative
+  constexpr float GUARD_BAND = 16384.0f;
+
+  // the 12 front facing (counter clockwise seen from outside) triangles of a box, corner index bits are x, y, z
+  const size_t BOX_TRIANGLES[12][3] = {
+    {0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5}, {0, 1, 5}, {0, 5, 4},
+    {2, 6, 7}, {2, 7, 3}, {0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6}
+  };
+
+  // clip space x, y, z, w of the 8 box corners, four corners per Float4
+  void transformCorners(const ngl::Mat4 &_mvp, const ngl::Vec3 &_min, const ngl::Vec3 &_max, float o_clip[4][8])
+  {
+    Float4 x(_min.m_x, _max.m_x, _min.m_x, _max.m_x);
+    Float4 y(_min.m_y, _min.m_y, _max.m_y, _max.m_y);
+    for (size_t half = 0; half < 2; ++half)
+    {
+      Float4 z(half == 0 ? _min.m_z : _max.m_z);
+      for (size_t row = 0; row < 4; ++row)
+      {
+        Float4 clip = x * _mvp.m_m[0][row] + y * _mvp.m_m[1][row] + z * _mvp.m_m[2][row] + Float4(_mvp.m_m[3][row]);
+        clip.store(&o_clip[row][4 * half]);
+      }
+    }
+  }
+} // end anon namespace
+
+OcclusionBuffer::OcclusionBuffer(size_t _width, size_t _height) : m_width(_width), m_height(_height)
+{
+  size_t width = _width;
+  size_t height = _height;
+  m_levels.emplace_back(width * height, 1.0f);
+  while (width > 1 || height > 1)
+  {
+    width = std::max<size_t>(1, width / 2);
+    height = std::max<size_t>(1, height / 2);
+    m_levels.emplace_back(width * height, 1.0f);
+  }
+}
+
+void OcclusionBuffer::clear()
+{
+  std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+  m_numTriangles = 0;
+}
+
+void OcclusionBuffer::rasterizeBox(const ngl::Mat4 &_mvp, const ngl::Vec3 &_min, const ngl::Vec3 &_max)
+{
+  float clip[4][8];
+  transformCorners(_mvp, _min, _max, clip);
+  // screen x, y and NDC z of each corner in front of the near plane
+  float screen[8][3];
+  bool front[8];
+  for (size_t i = 0; i < 8; ++i)
+  {
+    // between the eye and the near plane w is still positive but z < -w, the depth would land in front of -1
+    front[i] = clip[3][i] > MIN_W && clip[2][i] >= -clip[3][i];
+    if (front[i])
+    {
+      float invW = 1.0f / clip[3][i];
+      screen[i][0] = (clip[0][i] * invW * 0.5f + 0.5f) * float(m_width);
+      screen[i][1] = (clip[1][i] * invW * 0.5f + 0.5f) * float(m_height);
+      screen[i][2] = clip[2][i] * invW;
+      front[i] = std::fabs(screen[i][0]) < GUARD_BAND && std::fabs(screen[i][1]) < GUARD_BAND;
+    }
+  }
+  for (const auto &triangle : BOX_TRIANGLES)
+  {
+    if (front[triangle[0]] && front[triangle[1]] && front[triangle[2]])
+    {
+      rasterizeTriangle(screen[triangle[0]], screen[triangle[1]], screen[triangle[2]]);
+    }
+  }
+}
+
+void OcclusionBuffer::rasterizeTriangle(const float *_a, const float *_b, const float *_c)
+{
+  float area = (_b[0] - _a[0]) * (_c[1] - _a[1]) - (_c[0] - _a[0]) * (_b[1] - _a[1]);
+  // back facing or degenerate, the front faces of a closed occluder cover the same pixels nearer
+  if (area <= 0.0f)
+  {
+    return;
+  }
+  int minX = std::max(0, int(std::floor(std::min({_a[0], _b[0], _c[0]}))));
+  int maxX = std::min(int(m_width) - 1, int(std::floor(std::max({_a[0], _b[0], _c[0]}))));
+  int minY = std::max(0, int(std::floor(std::min({_a[1], _b[1], _c[1]}))));
+  int maxY = std::min(int(m_height) - 1, int(std::floor(std::max({_a[1], _b[1], _c[1]}))));
+  if (minX > maxX || minY > maxY)
+  {
+    return;
+  }
+  ++m_numTriangles;
+
+  // edge functions positive inside, each measured from its own start vertex to keep the magnitudes small. Moving
+  // them in by half the pixel footprint means a pixel centre only passes when the whole pixel is inside
+  const float *edges[3][2] = {{_a, _b}, {_b, _c}, {_c, _a}};
+  float edgeX[3];
+  float edgeY[3];
+  float edgeBias[3];
+  for (size_t e = 0; e < 3; ++e)
+  {
+    edgeX[e] = edges[e][0][1] - edges[e][1][1];
+    edgeY[e] = edges[e][1][0] - edges[e][0][0];
+    edgeBias[e] = 0.5f * (std::fabs(edgeX[e]) + std::fabs(edgeY[e]));
+  }
+  // depth plane, taken at the furthest corner of each pixel
+  float dzdx = ((_b[2] - _a[2]) * (_c[1] - _a[1]) - (_c[2] - _a[2]) * (_b[1] - _a[1])) / area;
+  float dzdy = ((_c[2] - _a[2]) * (_b[0] - _a[0]) - (_b[2] - _a[2]) * (_c[0] - _a[0])) / area;
+  float zBias = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+  // spans of four pixels, the buffer width is a multiple of four so the last span never runs off the row
+  int startX = minX & ~3;
+  Float4 pixelX = Float4(0.5f, 1.5f, 2.5f, 3.5f) + Float4(float(startX));
+  Float4 step[3] = {Float4(4.0f * edgeX[0]), Float4(4.0f * edgeX[1]), Float4(4.0f * edgeX[2])};
+  Float4 zStep(4.0f * dzdx);
+  float *depth = m_levels[0].data();
+  for (int y = minY; y <= maxY; ++y)
+  {
+    float pixelY = float(y) + 0.5f;
+    Float4 edge[3];
+    for (size_t e = 0; e < 3; ++e)
+    {
+      edge[e] = (pixelX - Float4(edges[e][0][0])) * edgeX[e] +
+                Float4((pixelY - edges[e][0][1]) * edgeY[e] - edgeBias[e]);
+    }
+    Float4 z = (pixelX - Float4(_a[0])) * dzdx + Float4(_a[2] + (pixelY - _a[1]) * dzdy + zBias);
+    float *row = depth + size_t(y) * m_width;
+    for (int x = startX; x <= maxX; x += 4)
+    {
+      Float4 inside = Float4::min(edge[0], Float4::min(edge[1], edge[2]));
+      Float4 current = Float4::load(row + x);
+      Float4::select(inside, Float4::min(current, z), current).store(row + x);
+      edge[0] += step[0];
+      edge[1] += step[1];
+      edge[2] += step[2];
+      z += zStep;
+    }
+  }
+}
+
+void OcclusionBuffer::buildHiZ()
+{
+  size_t width = m_width;
+  size_t height = m_height;
+  for (size_t l = 1; l < m_levels.size(); ++l)
+  {
+    const std::vector<float> &child = m_levels[l - 1];
+    std::vector<float> &parent = m_levels[l];
+    size_t parentWidth = std::max<size_t>(1, width / 2);
+    size_t parentHeight = std::max<size_t>(1, height / 2);
+    for (size_t y = 0; y < parentHeight; ++y)
+    {
+      size_t y0 = std::min(2 * y, height - 1);
+      size_t y1 = std::min(2 * y + 1, height - 1);
+      for (size_t x = 0; x < parentWidth; ++x)
+      {
+        size_t x0 = std::min(2 * x, width - 1);
+        size_t x1 = std::min(2 * x + 1, width - 1);
+        parent[y * parentWidth + x] = std::max(std::max(child[y0 * width + x0], child[y0 * width + x1]),
+                                               std::max(child[y1 * width + x0], child[y1 * width + x1]));
+      }
+    }
+    width = parentWidth;
+    height = parentHeight;
+  }
+}
+
+bool OcclusionBuffer::boxOccluded(const ngl::Mat4 &_mvp, const ngl::Vec3 &_min, const ngl::Vec3 &_max) const
+{
+  float clip[4][8];
+  transformCorners(_mvp, _min, _max, clip);
+  float minX = 1e30f;
+  float minY = 1e30f;
+  float maxX = -1e30f;
+  float maxY = -1e30f;
+  float nearest = 1e30f;
+  for (size_t i = 0; i < 8; ++i)
+  {
+    if (clip[3][i] <= MIN_W)
+    {
+      return false;
+    }
+    float invW = 1.0f / clip[3][i];
+    minX = std::min(minX, clip[0][i] * invW);
+    maxX = std::max(maxX, clip[0][i] * invW);
+    minY = std::min(minY, clip[1][i] * invW);
+    maxY = std::max(maxY, clip[1][i] * invW);
+    nearest = std::min(nearest, clip[2][i] * invW);
+  }
+  if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+  {
+    return false;
+  }
+  // pixels touched by the bounds, then up the pyramid until they fit in 2x2 texels
+  auto toPixel = [](float _ndc, size_t _size)
+  {
+    return std::min(int(_size) - 1, std::max(0, int(std::floor((_ndc * 0.5f + 0.5f) * float(_size)))));
+  };
+  int x0 = toPixel(minX, m_width);
+  int x1 = toPixel(maxX, m_width);
+  int y0 = toPixel(minY, m_height);
+  int y1 = toPixel(maxY, m_height);
+  size_t level = 0;
+  while ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)
+  {
+    ++level;
+  }
+  size_t width = std::max<size_t>(1, m_width >> level);
+  size_t height = std::max<size_t>(1, m_height >> level);
+  const std::vector<float> &hiZ = m_levels[level];
+  float furthest = -1e30f;
+  for (size_t y = std::min(size_t(y0 >> level), height - 1); y <= std::min(size_t(y1 >> level), height - 1); ++y)
+  {
+    for (size_t x = std::min(size_t(x0 >> level), width - 1); x <= std::min(size_t(x1 >> level), width - 1); ++x)
+    {
+      furthest = std::max(furthest, hiZ[y * width + x]);
+    }
+  }
+  return nearest > furthest;
+}
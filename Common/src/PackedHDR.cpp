@@ -0,0 +1,289 @@
+#include "PackedHDR.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#define PACKEDHDR_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PACKEDHDR_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+  // RGB9E5 constants from EXT_texture_shared_exponent, N mantissa bits, B exponent bias
+  constexpr int RGB9E5_N = 9;
+  constexpr int RGB9E5_B = 15;
+  constexpr float RGB9E5_MAX = 65408.0f;
+  // largest finite unsigned 11 and 10 bit floats
+  constexpr float UF11_MAX = 65024.0f;
+  constexpr float UF10_MAX = 64512.0f;
+  // smallest normal value, exponent -14 for both small float formats
+  constexpr float UF_MIN_NORMAL = 6.103515625e-05f;
+
+  uint32_t floatBits(float _f)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &_f, sizeof(bits));
+    return bits;
+  }
+
+  float bitsFloat(uint32_t _bits)
+  {
+    float f;
+    std::memcpy(&f, &_bits, sizeof(f));
+    return f;
+  }
+
+  // round to nearest unsigned small float with _mantissa bits (6 for 11 bit, 5 for 10 bit)
+  uint32_t toUFloat(float _f, int _mantissa, float _max)
+  {
+    // also catches NaN
+    if (!(_f > 0.0f))
+    {
+      return 0;
+    }
+    _f = std::min(_f, _max);
+    if (_f < UF_MIN_NORMAL)
+    {
+      return uint32_t(_f * float(1 << (14 + _mantissa)) + 0.5f);
+    }
+    // rebias the exponent from 127 to 15 and round the dropped mantissa bits, a carry moves to the exponent
+    uint32_t bits = floatBits(_f) - (112u << 23);
+    return (bits + (1u << (22 - _mantissa))) >> (23 - _mantissa);
+  }
+
+  float fromUFloat(uint32_t _v, int _mantissa)
+  {
+    uint32_t exponent = _v >> _mantissa;
+    uint32_t mantissa = _v & ((1u << _mantissa) - 1);
+    if (exponent == 0)
+    {
+      return std::ldexp(float(mantissa), -14 - _mantissa);
+    }
+    return std::ldexp(1.0f + float(mantissa) / float(1 << _mantissa), int(exponent) - 15);
+  }
+
+#if defined(PACKEDHDR_SSE)
+  // integer max for SSE2 which has no _mm_max_epi32
+  __m128i maxEpi32(__m128i _a, __m128i _b)
+  {
+    __m128i gt = _mm_cmpgt_epi32(_a, _b);
+    return _mm_or_si128(_mm_and_si128(gt, _a), _mm_andnot_si128(gt, _b));
+  }
+
+  // 2^_e for integer exponents in the normal float range
+  __m128 exp2i(__m128i _e)
+  {
+    return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_e, _mm_set1_epi32(127)), 23));
+  }
+
+  void packRGB9E5x4(__m128 _r, __m128 _g, __m128 _b, uint32_t *o_packed)
+  {
+    // max with zero first also flushes NaN to 0
+    __m128 zero = _mm_setzero_ps();
+    __m128 limit = _mm_set1_ps(RGB9E5_MAX);
+    _r = _mm_min_ps(_mm_max_ps(_r, zero), limit);
+    _g = _mm_min_ps(_mm_max_ps(_g, zero), limit);
+    _b = _mm_min_ps(_mm_max_ps(_b, zero), limit);
+    __m128 maxrgb = _mm_max_ps(_r, _mm_max_ps(_g, _b));
+    // floor(log2(max)) straight from the exponent bits, clamped to -B-1
+    __m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(_mm_castps_si128(maxrgb), 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(127));
+    __m128i shared = _mm_add_epi32(maxEpi32(e, _mm_set1_epi32(-RGB9E5_B - 1)), _mm_set1_epi32(1 + RGB9E5_B));
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 scale = exp2i(_mm_sub_epi32(_mm_set1_epi32(RGB9E5_B + RGB9E5_N), shared));
+    __m128i maxs = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxrgb, scale), half));
+    // rounding up to 2^N needs the next exponent
+    __m128i overflow = _mm_cmpeq_epi32(maxs, _mm_set1_epi32(1 << RGB9E5_N));
+    shared = _mm_sub_epi32(shared, overflow);
+    scale = _mm_or_ps(_mm_andnot_ps(_mm_castsi128_ps(overflow), scale),
+                      _mm_and_ps(_mm_castsi128_ps(overflow), _mm_mul_ps(scale, half)));
+    __m128i rs = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_r, scale), half));
+    __m128i gs = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_g, scale), half));
+    __m128i bs = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_b, scale), half));
+    __m128i packed = _mm_or_si128(_mm_or_si128(rs, _mm_slli_epi32(gs, 9)),
+                                  _mm_or_si128(_mm_slli_epi32(bs, 18), _mm_slli_epi32(shared, 27)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(o_packed), packed);
+  }
+
+  __m128i toUFloatx4(__m128 _v, int _mantissa, float _max)
+  {
+    _v = _mm_min_ps(_mm_max_ps(_v, _mm_setzero_ps()), _mm_set1_ps(_max));
+    __m128i denormal = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_v, _mm_set1_ps(float(1 << (14 + _mantissa)))), _mm_set1_ps(0.5f)));
+    __m128i bits = _mm_sub_epi32(_mm_castps_si128(_v), _mm_set1_epi32(112 << 23));
+    __m128i normal = _mm_srli_epi32(_mm_add_epi32(bits, _mm_set1_epi32(1 << (22 - _mantissa))), 23 - _mantissa);
+    __m128i small = _mm_castps_si128(_mm_cmplt_ps(_v, _mm_set1_ps(UF_MIN_NORMAL)));
+    return _mm_or_si128(_mm_and_si128(small, denormal), _mm_andnot_si128(small, normal));
+  }
+
+  void packR11G11B10Fx4(__m128 _r, __m128 _g, __m128 _b, uint32_t *o_packed)
+  {
+    __m128i packed = _mm_or_si128(_mm_or_si128(toUFloatx4(_r, 6, UF11_MAX), _mm_slli_epi32(toUFloatx4(_g, 6, UF11_MAX), 11)),
+                                  _mm_slli_epi32(toUFloatx4(_b, 5, UF10_MAX), 22));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(o_packed), packed);
+  }
+#elif defined(PACKEDHDR_NEON)
+  // clamp to [0, _max], NEON's max keeps a NaN so the compare does the flush to 0 the SSE max gives for free
+  float32x4_t clampx4(float32x4_t _v, float _max)
+  {
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    return vminq_f32(vbslq_f32(vcgtq_f32(_v, zero), _v, zero), vdupq_n_f32(_max));
+  }
+
+  float32x4_t exp2i(int32x4_t _e)
+  {
+    return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(_e, vdupq_n_s32(127)), 23));
+  }
+
+  void packRGB9E5x4(float32x4_t _r, float32x4_t _g, float32x4_t _b, uint32_t *o_packed)
+  {
+    _r = clampx4(_r, RGB9E5_MAX);
+    _g = clampx4(_g, RGB9E5_MAX);
+    _b = clampx4(_b, RGB9E5_MAX);
+    float32x4_t maxrgb = vmaxq_f32(_r, vmaxq_f32(_g, _b));
+    int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(vreinterpretq_u32_f32(maxrgb), 23), vdupq_n_u32(0xff))),
+                            vdupq_n_s32(127));
+    int32x4_t shared = vaddq_s32(vmaxq_s32(e, vdupq_n_s32(-RGB9E5_B - 1)), vdupq_n_s32(1 + RGB9E5_B));
+    float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t scale = exp2i(vsubq_s32(vdupq_n_s32(RGB9E5_B + RGB9E5_N), shared));
+    int32x4_t maxs = vcvtq_s32_f32(vaddq_f32(vmulq_f32(maxrgb, scale), half));
+    uint32x4_t overflow = vceqq_s32(maxs, vdupq_n_s32(1 << RGB9E5_N));
+    shared = vsubq_s32(shared, vreinterpretq_s32_u32(overflow));
+    scale = vbslq_f32(overflow, vmulq_f32(scale, half), scale);
+    uint32x4_t rs = vcvtq_u32_f32(vaddq_f32(vmulq_f32(_r, scale), half));
+    uint32x4_t gs = vcvtq_u32_f32(vaddq_f32(vmulq_f32(_g, scale), half));
+    uint32x4_t bs = vcvtq_u32_f32(vaddq_f32(vmulq_f32(_b, scale), half));
+    uint32x4_t packed = vorrq_u32(vorrq_u32(rs, vshlq_n_u32(gs, 9)),
+                                  vorrq_u32(vshlq_n_u32(bs, 18), vshlq_n_u32(vreinterpretq_u32_s32(shared), 27)));
+    vst1q_u32(o_packed, packed);
+  }
+
+  uint32x4_t toUFloatx4(float32x4_t _v, int _mantissa, float _max)
+  {
+    _v = clampx4(_v, _max);
+    uint32x4_t denormal = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(_v, float(1 << (14 + _mantissa))), vdupq_n_f32(0.5f)));
+    uint32x4_t bits = vsubq_u32(vreinterpretq_u32_f32(_v), vdupq_n_u32(112u << 23));
+    // the shift isn't a constant, a negative vshlq count shifts right
+    uint32x4_t normal = vshlq_u32(vaddq_u32(bits, vdupq_n_u32(1u << (22 - _mantissa))), vdupq_n_s32(_mantissa - 23));
+    uint32x4_t small = vcltq_f32(_v, vdupq_n_f32(UF_MIN_NORMAL));
+    return vbslq_u32(small, denormal, normal);
+  }
+
+  void packR11G11B10Fx4(float32x4_t _r, float32x4_t _g, float32x4_t _b, uint32_t *o_packed)
+  {
+    uint32x4_t packed = vorrq_u32(vorrq_u32(toUFloatx4(_r, 6, UF11_MAX), vshlq_n_u32(toUFloatx4(_g, 6, UF11_MAX), 11)),
+                                  vshlq_n_u32(toUFloatx4(_b, 5, UF10_MAX), 22));
+    vst1q_u32(o_packed, packed);
+  }
+#endif
+} // end anon namespace
+
+GLenum PackedHDR::internalFormat(PackedFormat _format)
+{
+  return _format == PackedFormat::RGB9E5 ? GL_RGB9_E5 : GL_R11F_G11F_B10F;
+}
+
+GLenum PackedHDR::pixelType(PackedFormat _format)
+{
+  return _format == PackedFormat::RGB9E5 ? GL_UNSIGNED_INT_5_9_9_9_REV : GL_UNSIGNED_INT_10F_11F_11F_REV;
+}
+
+const char *PackedHDR::name(PackedFormat _format)
+{
+  return _format == PackedFormat::RGB9E5 ? "RGB9E5" : "R11G11B10F";
+}
+
+uint32_t PackedHDR::packRGB9E5(float _r, float _g, float _b)
+{
+  // the NaN safe clamp from the extension spec
+  auto clampChannel = [](float _c) { return _c > 0.0f ? std::min(_c, RGB9E5_MAX) : 0.0f; };
+  _r = clampChannel(_r);
+  _g = clampChannel(_g);
+  _b = clampChannel(_b);
+  float maxrgb = std::max(_r, std::max(_g, _b));
+  int e = int((floatBits(maxrgb) >> 23) & 0xff) - 127;
+  int shared = std::max(e, -RGB9E5_B - 1) + 1 + RGB9E5_B;
+  float scale = bitsFloat(uint32_t(RGB9E5_B + RGB9E5_N - shared + 127) << 23);
+  if (uint32_t(maxrgb * scale + 0.5f) == (1u << RGB9E5_N))
+  {
+    ++shared;
+    scale *= 0.5f;
+  }
+  uint32_t rs = uint32_t(_r * scale + 0.5f);
+  uint32_t gs = uint32_t(_g * scale + 0.5f);
+  uint32_t bs = uint32_t(_b * scale + 0.5f);
+  return rs | (gs << 9) | (bs << 18) | (uint32_t(shared) << 27);
+}
+
+uint32_t PackedHDR::packR11G11B10F(float _r, float _g, float _b)
+{
+  return toUFloat(_r, 6, UF11_MAX) | (toUFloat(_g, 6, UF11_MAX) << 11) | (toUFloat(_b, 5, UF10_MAX) << 22);
+}
+
+void PackedHDR::unpack(uint32_t _packed, PackedFormat _format, float o_rgb[3])
+{
+  if (_format == PackedFormat::RGB9E5)
+  {
+    float scale = std::ldexp(1.0f, int(_packed >> 27) - RGB9E5_B - RGB9E5_N);
+    o_rgb[0] = float(_packed & 0x1ff) * scale;
+    o_rgb[1] = float((_packed >> 9) & 0x1ff) * scale;
+    o_rgb[2] = float((_packed >> 18) & 0x1ff) * scale;
+  }
+  else
+  {
+    o_rgb[0] = fromUFloat(_packed & 0x7ff, 6);
+    o_rgb[1] = fromUFloat((_packed >> 11) & 0x7ff, 6);
+    o_rgb[2] = fromUFloat(_packed >> 22, 5);
+  }
+}
+
+void PackedHDR::pack(const float *_rgba, size_t _count, PackedFormat _format, uint32_t *o_packed)
+{
+  // groups of 1024 texels per job keeps the scheduling overhead negligible
+  constexpr size_t grain = 1024;
+  ThreadPool::instance().parallelFor((_count + grain - 1) / grain, [&](size_t _begin, size_t _end)
+  {
+    size_t i = _begin * grain;
+    size_t end = std::min(_end * grain, _count);
+#if defined(PACKEDHDR_SSE)
+    for (; i + 4 <= end; i += 4)
+    {
+      // four RGBA texels in, transposed to RRRR GGGG BBBB AAAA
+      __m128 t0 = _mm_loadu_ps(_rgba + i * 4);
+      __m128 t1 = _mm_loadu_ps(_rgba + i * 4 + 4);
+      __m128 t2 = _mm_loadu_ps(_rgba + i * 4 + 8);
+      __m128 t3 = _mm_loadu_ps(_rgba + i * 4 + 12);
+      _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+      if (_format == PackedFormat::RGB9E5)
+      {
+        packRGB9E5x4(t0, t1, t2, o_packed + i);
+      }
+      else
+      {
+        packR11G11B10Fx4(t0, t1, t2, o_packed + i);
+      }
+    }
+#elif defined(PACKEDHDR_NEON)
+    for (; i + 4 <= end; i += 4)
+    {
+      // the structure load splits four RGBA texels straight into RRRR GGGG BBBB AAAA
+      float32x4x4_t t = vld4q_f32(_rgba + i * 4);
+      if (_format == PackedFormat::RGB9E5)
+      {
+        packRGB9E5x4(t.val[0], t.val[1], t.val[2], o_packed + i);
+      }
+      else
+      {
+        packR11G11B10Fx4(t.val[0], t.val[1], t.val[2], o_packed + i);
+      }
+    }
+#endif
+    for (; i < end; ++i)
+    {
+      const float *t = _rgba + i * 4;
+      o_packed[i] = _format == PackedFormat::RGB9E5 ? packRGB9E5(t[0], t[1], t[2]) : packR11G11B10F(t[0], t[1], t[2]);
+    }
+  });
+}
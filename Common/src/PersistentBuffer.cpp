@@ -0,0 +1,127 @@
+#include "PersistentBuffer.h"
+#include "GLInfo.h"
+#include <chrono>
+#include <iostream>
+
+PersistentBuffer::~PersistentBuffer()
+{
+  release();
+}
+
+void PersistentBuffer::release()
+{
+  for (auto &fence : m_fences)
+  {
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (m_mapped != nullptr)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_mapped = nullptr;
+  }
+  glDeleteBuffers(1, &m_buffer);
+  m_buffer = 0;
+}
+
+bool PersistentBuffer::reserve(size_t _bytes)
+{
+  if (m_buffer != 0 && m_regionSize >= _bytes)
+  {
+    return false;
+  }
+  // immutable storage can't grow, so both paths start again with a new buffer
+  release();
+  // keep region offsets aligned for any attribute or SSBO / UBO binding
+  m_regionSize = (_bytes + 255) / 256 * 256;
+  m_region = 0;
+  m_written = false;
+  m_persistent = GLInfo::hasVersion(4, 4) || GLInfo::hasExtension("GL_ARB_buffer_storage");
+  glGenBuffers(1, &m_buffer);
+  // the copy target so the caller's GL_ARRAY_BUFFER binding is left alone
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  GLsizeiptr size = GLsizeiptr(m_regionSize * FRAMES);
+  if (m_persistent)
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    m_mapped = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    if (m_mapped == nullptr)
+    {
+      // immutable storage can't be respecified, start again with a plain buffer and map it per frame instead
+      std::cerr << "PersistentBuffer could not map " << size << " bytes persistently, mapping per frame\n";
+      m_persistent = false;
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      glDeleteBuffers(1, &m_buffer);
+      glGenBuffers(1, &m_buffer);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    }
+  }
+  if (!m_persistent)
+  {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return true;
+}
+
+void *PersistentBuffer::beginWrite()
+{
+  if (m_buffer == 0)
+  {
+    return nullptr;
+  }
+  // a second write in the same frame fences the region it leaves behind
+  if (m_written && m_fences[m_region] == nullptr)
+  {
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_written = true;
+  m_region = (m_region + 1) % FRAMES;
+  m_lastWaitTime = 0.0;
+  GLsync &fence = m_fences[m_region];
+  if (fence != nullptr)
+  {
+    // a zero timeout poll first, only a real block is counted
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+      ++m_numWaits;
+      auto start = std::chrono::steady_clock::now();
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+      m_lastWaitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (m_persistent)
+  {
+    return m_mapped != nullptr ? m_mapped + offset() : nullptr;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  void *region = glMapBufferRange(GL_COPY_WRITE_BUFFER, GLintptr(offset()), GLsizeiptr(m_regionSize),
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return region;
+}
+
+void PersistentBuffer::endWrite()
+{
+  if (!m_persistent && m_buffer != 0)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+}
+
+void PersistentBuffer::fence()
+{
+  if (m_written && m_fences[m_region] == nullptr)
+  {
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_written = false;
+}
@@ -0,0 +1,92 @@
+#include "SphericalHarmonics.h"
+#include "ThreadPool.h"
+#include <vector>
+
+std::array<float, 9> SphericalHarmonics::basis(const float _dir[3])
+{
+  float x = _dir[0];
+  float y = _dir[1];
+  float z = _dir[2];
+  return {{0.282095f,
+           0.488603f * y,
+           0.488603f * z,
+           0.488603f * x,
+           1.092548f * x * y,
+           1.092548f * y * z,
+           0.315392f * (3.0f * z * z - 1.0f),
+           1.092548f * x * z,
+           0.546274f * (x * x - y * y)}};
+}
+
+SHCoefficients SphericalHarmonics::project(const CubeImage &_env)
+{
+  int size = _env.size();
+  size_t rows = size_t(6 * size);
+  // one partial sum per row, reduced serially afterwards
+  std::vector<std::array<Float4, 9>> partial(rows);
+  ThreadPool::instance().parallelFor(rows, [&](size_t _begin, size_t _end)
+  {
+    for (size_t row = _begin; row < _end; ++row)
+    {
+      int face = int(row) / size;
+      int y = int(row) % size;
+      std::array<Float4, 9> sum;
+      for (int x = 0; x < size; ++x)
+      {
+        float dir[3];
+        CubeImage::direction(face, (float(x) + 0.5f) / float(size), (float(y) + 0.5f) / float(size), dir);
+        Float4 radiance = Float4::load(_env.texel(face, x, y)) * CubeImage::texelSolidAngle(x, y, size);
+        auto b = basis(dir);
+        for (size_t i = 0; i < 9; ++i)
+        {
+          sum[i] += radiance * b[i];
+        }
+      }
+      partial[row] = sum;
+    }
+  });
+  std::array<Float4, 9> total;
+  for (auto &p : partial)
+  {
+    for (size_t i = 0; i < 9; ++i)
+    {
+      total[i] += p[i];
+    }
+  }
+  SHCoefficients sh;
+  for (size_t i = 0; i < 9; ++i)
+  {
+    total[i].store(sh.c[i].data());
+    sh.c[i][3] = 0.0f;
+  }
+  return sh;
+}
+
+SHCoefficients SphericalHarmonics::irradiance(const SHCoefficients &_radiance)
+{
+  // cosine lobe band factors pi, 2pi/3, pi/4 with the lambert 1/pi folded in
+  const float band[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+  SHCoefficients out;
+  for (size_t i = 0; i < 9; ++i)
+  {
+    for (size_t c = 0; c < 3; ++c)
+    {
+      out.c[i][c] = _radiance.c[i][c] * band[i];
+    }
+  }
+  return out;
+}
+
+std::array<float, 3> SphericalHarmonics::evaluate(const SHCoefficients &_sh, const float _dir[3])
+{
+  auto b = basis(_dir);
+  std::array<float, 3> rgb{};
+  for (size_t i = 0; i < 9; ++i)
+  {
+    for (size_t c = 0; c < 3; ++c)
+    {
+      rgb[c] += _sh.c[i][c] * b[i];
+    }
+  }
+  return rgb;
+}
@@ -0,0 +1,166 @@
+#include "StaticBatch.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+StaticBatch::~StaticBatch()
+{
+  release();
+}
+
+void StaticBatch::release()
+{
+  m_mesh.release();
+  m_chunks.clear();
+  m_numInstances = 0;
+  m_vertexBytes = 0;
+  m_indexBytes = 0;
+}
+
+bool StaticBatch::bake(const MeshBuilder &_mesh, size_t _count, const MatrixSource &_matrix, size_t _chunkInstances)
+{
+  const VertexLayout &layout = _mesh.layout();
+  const auto &attributes = layout.attributes();
+  if (attributes.empty() || attributes[0].components != 3 || attributes[0].format != AttributeFormat::Float)
+  {
+    std::cerr << "StaticBatch needs a 3 float position as the first attribute\n";
+    return false;
+  }
+  if (_count == 0 || _mesh.numVertices() == 0)
+  {
+    std::cerr << "StaticBatch has nothing to bake\n";
+    return false;
+  }
+  release();
+  size_t stride = layout.stride();
+  size_t position = layout.offset(0);
+  size_t meshVertices = _mesh.numVertices();
+  const unsigned char *source = _mesh.vertices().data();
+  if (_chunkInstances == 0)
+  {
+    _chunkInstances = std::max(size_t(1), size_t(65536) / meshVertices);
+  }
+  _chunkInstances = std::min(_chunkInstances, _count);
+
+  // every copy is the source vertices with the positions run through its matrix, x' = sum_c m[c][0] * p_c
+  std::vector<unsigned char> vertices(_count * meshVertices * stride);
+  ThreadPool::instance().parallelFor(_count, [&](size_t _begin, size_t _end)
+  {
+    for (size_t i = _begin; i < _end; ++i)
+    {
+      const ngl::Mat4 &m = _matrix(i);
+      unsigned char *copy = vertices.data() + i * meshVertices * stride;
+      std::memcpy(copy, source, meshVertices * stride);
+      for (size_t v = 0; v < meshVertices; ++v)
+      {
+        float p[3];
+        std::memcpy(p, copy + v * stride + position, sizeof(p));
+        float q[3];
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+          q[axis] = m.m_m[0][axis] * p[0] + m.m_m[1][axis] * p[1] + m.m_m[2][axis] * p[2] + m.m_m[3][axis];
+        }
+        std::memcpy(copy + v * stride + position, q, sizeof(q));
+      }
+    }
+  }, 1024);
+
+  // bounds of each chunk from the baked positions
+  m_chunks.resize((_count + _chunkInstances - 1) / _chunkInstances);
+  ThreadPool::instance().parallelFor(m_chunks.size(), [&](size_t _begin, size_t _end)
+  {
+    for (size_t c = _begin; c < _end; ++c)
+    {
+      Chunk &chunk = m_chunks[c];
+      chunk.first = c * _chunkInstances;
+      chunk.count = std::min(_chunkInstances, _count - chunk.first);
+      chunk.baseVertex = GLint(chunk.first * meshVertices);
+      float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+      float hi[3] = {-lo[0], -lo[1], -lo[2]};
+      const unsigned char *base = vertices.data() + chunk.first * meshVertices * stride + position;
+      for (size_t v = 0; v < chunk.count * meshVertices; ++v)
+      {
+        float p[3];
+        std::memcpy(p, base + v * stride, sizeof(p));
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+          lo[axis] = std::min(lo[axis], p[axis]);
+          hi[axis] = std::max(hi[axis], p[axis]);
+        }
+      }
+      chunk.min = ngl::Vec3(lo[0], lo[1], lo[2]);
+      chunk.max = ngl::Vec3(hi[0], hi[1], hi[2]);
+    }
+  }, 1);
+
+  // one index pattern for a full chunk, shorter chunks draw a prefix of it and every chunk moves it with its
+  // base vertex
+  const auto &indices = _mesh.indices();
+  m_meshIndices = indices.size();
+  size_t chunkVertices = _chunkInstances * meshVertices;
+  std::vector<uint32_t> pattern(_chunkInstances * m_meshIndices);
+  for (size_t i = 0; i < _chunkInstances; ++i)
+  {
+    for (size_t j = 0; j < m_meshIndices; ++j)
+    {
+      pattern[i * m_meshIndices + j] = uint32_t(i * meshVertices + indices[j]);
+    }
+  }
+
+  m_mesh.layout = layout;
+  m_mesh.numVertices = _count * meshVertices;
+  m_mesh.numIndices = GLsizei(pattern.size());
+  glGenVertexArrays(1, &m_mesh.vao);
+  glBindVertexArray(m_mesh.vao);
+  glGenBuffers(1, &m_mesh.vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_mesh.vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertices.size()), vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glGenBuffers(1, &m_mesh.indexBuffer);
+  m_mesh.attach();
+  if (chunkVertices <= 65536)
+  {
+    std::vector<uint16_t> shortPattern(pattern.begin(), pattern.end());
+    m_indexBytes = shortPattern.size() * sizeof(uint16_t);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(m_indexBytes), shortPattern.data(), GL_STATIC_DRAW);
+    m_mesh.indexType = GL_UNSIGNED_SHORT;
+  }
+  else
+  {
+    m_indexBytes = pattern.size() * sizeof(uint32_t);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(m_indexBytes), pattern.data(), GL_STATIC_DRAW);
+    m_mesh.indexType = GL_UNSIGNED_INT;
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  m_numInstances = _count;
+  m_vertexBytes = vertices.size();
+  return true;
+}
+
+size_t StaticBatch::draw(const Frustum *_frustum)
+{
+  m_chunksDrawn = 0;
+  if (m_mesh.vao == 0)
+  {
+    return 0;
+  }
+  glBindVertexArray(m_mesh.vao);
+  size_t drawn = 0;
+  for (const auto &chunk : m_chunks)
+  {
+    if (_frustum != nullptr && !_frustum->boxVisible(chunk.min, chunk.max))
+    {
+      continue;
+    }
+    glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(chunk.count * m_meshIndices), m_mesh.indexType, nullptr,
+                             chunk.baseVertex);
+    drawn += chunk.count;
+    ++m_chunksDrawn;
+  }
+  glBindVertexArray(0);
+  return drawn;
+}
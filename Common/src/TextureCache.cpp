@@ -0,0 +1,93 @@
+#include "TextureCache.h"
+#include "Hash.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fmt/format.h>
+
+namespace
+{
+  struct CacheHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint64_t hash;
+  };
+  constexpr char CACHE_MAGIC[4] = {'N', 'G', 'L', 'C'};
+  constexpr uint32_t CACHE_VERSION = 1;
+
+  std::filesystem::path cachePath(uint64_t _key)
+  {
+    return std::filesystem::path(TextureCache::directory()) / fmt::format("{:016x}.bin", _key);
+  }
+} // end anon namespace
+
+std::string TextureCache::directory()
+{
+  if (auto dir = std::getenv("TEXTURE_CACHE_DIR"))
+  {
+    return dir;
+  }
+  return ".texturecache";
+}
+
+bool TextureCache::load(uint64_t _key, std::vector<unsigned char> &o_data)
+{
+  std::ifstream in(cachePath(_key), std::ios::binary);
+  if (!in)
+  {
+    return false;
+  }
+  CacheHeader header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != CACHE_VERSION || header.key != _key)
+  {
+    return false;
+  }
+  o_data.resize(header.size);
+  if (!in.read(reinterpret_cast<char *>(o_data.data()), static_cast<std::streamsize>(header.size)) ||
+      fnv1a64(o_data.data(), o_data.size()) != header.hash)
+  {
+    std::cerr << "TextureCache: ignoring corrupt entry " << cachePath(_key) << '\n';
+    o_data.clear();
+    return false;
+  }
+  return true;
+}
+
+bool TextureCache::store(uint64_t _key, const void *_data, size_t _size)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(directory(), ec);
+  // write to a temporary then rename so a crash never leaves a half written entry behind
+  auto path = cachePath(_key);
+  auto temp = path;
+  temp += ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      std::cerr << "TextureCache: unable to write " << temp << '\n';
+      return false;
+    }
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = _key;
+    header.size = _size;
+    header.hash = fnv1a64(_data, _size);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(static_cast<const char *>(_data), static_cast<std::streamsize>(_size));
+    if (!out)
+    {
+      return false;
+    }
+  }
+  std::filesystem::rename(temp, path, ec);
+  return !ec;
+}
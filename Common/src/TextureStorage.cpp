@@ -0,0 +1,302 @@
+#include "TextureStorage.h"
+#include "GLInfo.h"
+#include <ngl/Image.h>
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+  // the context is created once per demo so the answers can be kept
+  bool s_dsa = false;
+  bool s_storage = false;
+  bool s_queried = false;
+
+  void queryCaps()
+  {
+    if (!s_queried)
+    {
+      s_dsa = GLInfo::hasVersion(4, 5) || GLInfo::hasExtension("GL_ARB_direct_state_access");
+      s_storage = GLInfo::hasVersion(4, 2) || GLInfo::hasExtension("GL_ARB_texture_storage");
+      s_queried = true;
+    }
+  }
+
+  bool isLayered(GLenum _target)
+  {
+    return _target == GL_TEXTURE_3D || _target == GL_TEXTURE_2D_ARRAY;
+  }
+
+  // the bind to edit calls address cube faces by their own target
+  GLenum faceTarget(GLenum _target, GLint _layer)
+  {
+    return _target == GL_TEXTURE_CUBE_MAP ? GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + _layer) : _target;
+  }
+
+  // a client format / type glTexImage accepts for _internalFormat. No data is read, but integer formats need an
+  // _INTEGER format and depth / depth stencil formats their own, anything else takes GL_RGBA
+  void transferFormat(GLenum _internalFormat, GLenum &o_format, GLenum &o_type)
+  {
+    switch (_internalFormat)
+    {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+      o_format = GL_DEPTH_COMPONENT;
+      o_type = GL_FLOAT;
+      break;
+    case GL_DEPTH24_STENCIL8:
+      o_format = GL_DEPTH_STENCIL;
+      o_type = GL_UNSIGNED_INT_24_8;
+      break;
+    case GL_DEPTH32F_STENCIL8:
+      o_format = GL_DEPTH_STENCIL;
+      o_type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+      break;
+    case GL_R8UI: case GL_R16UI: case GL_R32UI:
+    case GL_RG8UI: case GL_RG16UI: case GL_RG32UI:
+    case GL_RGB8UI: case GL_RGB16UI: case GL_RGB32UI:
+    case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI: case GL_RGB10_A2UI:
+      o_format = GL_RGBA_INTEGER;
+      o_type = GL_UNSIGNED_INT;
+      break;
+    case GL_R8I: case GL_R16I: case GL_R32I:
+    case GL_RG8I: case GL_RG16I: case GL_RG32I:
+    case GL_RGB8I: case GL_RGB16I: case GL_RGB32I:
+    case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:
+      o_format = GL_RGBA_INTEGER;
+      o_type = GL_INT;
+      break;
+    default:
+      o_format = GL_RGBA;
+      o_type = GL_UNSIGNED_BYTE;
+      break;
+    }
+  }
+
+  // without glTexStorage every level is allocated once here with a null pointer, and clamping MAX_LEVEL keeps it
+  // complete
+  void allocateMutable(GLenum _target, GLsizei _levels, GLenum _internalFormat, GLsizei _width, GLsizei _height, GLsizei _depth)
+  {
+    GLenum format;
+    GLenum type;
+    transferFormat(_internalFormat, format, type);
+    glTexParameteri(_target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(_target, GL_TEXTURE_MAX_LEVEL, _levels - 1);
+    for (GLsizei l = 0; l < _levels; ++l)
+    {
+      GLsizei w = std::max(1, _width >> l);
+      GLsizei h = std::max(1, _height >> l);
+      GLsizei d = _target == GL_TEXTURE_3D ? std::max(1, _depth >> l) : _depth;
+      if (isLayered(_target))
+      {
+        glTexImage3D(_target, l, GLint(_internalFormat), w, h, d, 0, format, type, nullptr);
+      }
+      else
+      {
+        int faces = _target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        for (int f = 0; f < faces; ++f)
+        {
+          glTexImage2D(faceTarget(_target, f), l, GLint(_internalFormat), w, h, 0, format, type, nullptr);
+        }
+      }
+    }
+  }
+} // end anon namespace
+
+bool TextureStorage::hasDirectStateAccess()
+{
+  queryCaps();
+  return s_dsa;
+}
+
+bool TextureStorage::hasImmutableStorage()
+{
+  queryCaps();
+  return s_storage;
+}
+
+GLsizei TextureStorage::fullMipLevels(GLsizei _width, GLsizei _height, GLsizei _depth)
+{
+  GLsizei size = std::max({_width, _height, _depth});
+  GLsizei levels = 1;
+  while (size > 1)
+  {
+    size >>= 1;
+    ++levels;
+  }
+  return levels;
+}
+
+GLuint TextureStorage::create(GLenum _target, GLsizei _levels, GLenum _internalFormat, GLsizei _width, GLsizei _height,
+                              GLsizei _depth, const SamplerState &_sampler)
+{
+  queryCaps();
+  GLuint id = 0;
+  if (s_dsa)
+  {
+    glCreateTextures(_target, 1, &id);
+    if (isLayered(_target))
+    {
+      glTextureStorage3D(id, _levels, _internalFormat, _width, _height, _depth);
+    }
+    else
+    {
+      glTextureStorage2D(id, _levels, _internalFormat, _width, _height);
+    }
+  }
+  else
+  {
+    glGenTextures(1, &id);
+    glBindTexture(_target, id);
+    if (s_storage && isLayered(_target))
+    {
+      glTexStorage3D(_target, _levels, _internalFormat, _width, _height, _depth);
+    }
+    else if (s_storage)
+    {
+      glTexStorage2D(_target, _levels, _internalFormat, _width, _height);
+    }
+    else
+    {
+      allocateMutable(_target, _levels, _internalFormat, _width, _height, _depth);
+    }
+  }
+  setParameter(_target, id, GL_TEXTURE_MIN_FILTER, GLint(_sampler.minFilter));
+  setParameter(_target, id, GL_TEXTURE_MAG_FILTER, GLint(_sampler.magFilter));
+  setParameter(_target, id, GL_TEXTURE_WRAP_S, GLint(_sampler.wrap));
+  setParameter(_target, id, GL_TEXTURE_WRAP_T, GLint(_sampler.wrap));
+  // only the 3D and cube targets have an R coordinate
+  if (_target == GL_TEXTURE_3D || _target == GL_TEXTURE_CUBE_MAP)
+  {
+    setParameter(_target, id, GL_TEXTURE_WRAP_R, GLint(_sampler.wrap));
+  }
+  return id;
+}
+
+void TextureStorage::upload(GLenum _target, GLuint _id, GLint _level, GLint _layer, GLsizei _width, GLsizei _height,
+                            GLsizei _depth, GLenum _format, GLenum _type, const void *_pixels)
+{
+  queryCaps();
+  // rows of RGB data are not always 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (s_dsa)
+  {
+    if (_target == GL_TEXTURE_CUBE_MAP)
+    {
+      // DSA treats a cube map as six layers
+      glTextureSubImage3D(_id, _level, 0, 0, _layer, _width, _height, 1, _format, _type, _pixels);
+    }
+    else if (isLayered(_target))
+    {
+      glTextureSubImage3D(_id, _level, 0, 0, _layer, _width, _height, _depth, _format, _type, _pixels);
+    }
+    else
+    {
+      glTextureSubImage2D(_id, _level, 0, 0, _width, _height, _format, _type, _pixels);
+    }
+  }
+  else
+  {
+    glBindTexture(_target, _id);
+    if (isLayered(_target))
+    {
+      glTexSubImage3D(_target, _level, 0, 0, _layer, _width, _height, _depth, _format, _type, _pixels);
+    }
+    else
+    {
+      glTexSubImage2D(faceTarget(_target, _layer), _level, 0, 0, _width, _height, _format, _type, _pixels);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureStorage::uploadCompressed(GLenum _target, GLuint _id, GLint _level, GLint _layer, GLsizei _width, GLsizei _height,
+                                      GLsizei _depth, GLenum _internalFormat, GLsizei _size, const void *_data)
+{
+  queryCaps();
+  if (s_dsa)
+  {
+    if (_target == GL_TEXTURE_CUBE_MAP)
+    {
+      glCompressedTextureSubImage3D(_id, _level, 0, 0, _layer, _width, _height, 1, _internalFormat, _size, _data);
+    }
+    else if (isLayered(_target))
+    {
+      glCompressedTextureSubImage3D(_id, _level, 0, 0, _layer, _width, _height, _depth, _internalFormat, _size, _data);
+    }
+    else
+    {
+      glCompressedTextureSubImage2D(_id, _level, 0, 0, _width, _height, _internalFormat, _size, _data);
+    }
+  }
+  else
+  {
+    glBindTexture(_target, _id);
+    if (isLayered(_target))
+    {
+      glCompressedTexSubImage3D(_target, _level, 0, 0, _layer, _width, _height, _depth, _internalFormat, _size, _data);
+    }
+    else
+    {
+      glCompressedTexSubImage2D(faceTarget(_target, _layer), _level, 0, 0, _width, _height, _internalFormat, _size, _data);
+    }
+  }
+}
+
+GLuint TextureStorage::createFromFile(const std::string &_fname, const SamplerState &_sampler)
+{
+  ngl::Image image;
+  if (!image.load(_fname))
+  {
+    std::cerr << "TextureStorage: unable to load " << _fname << '\n';
+    return 0;
+  }
+  GLsizei width = GLsizei(image.width());
+  GLsizei height = GLsizei(image.height());
+  GLuint id = create(GL_TEXTURE_2D, fullMipLevels(width, height), GL_RGBA8, width, height, 1, _sampler);
+  upload(GL_TEXTURE_2D, id, 0, 0, width, height, 1, image.format(), GL_UNSIGNED_BYTE, image.getPixels());
+  generateMipmaps(GL_TEXTURE_2D, id);
+  return id;
+}
+
+void TextureStorage::generateMipmaps(GLenum _target, GLuint _id)
+{
+  queryCaps();
+  if (s_dsa)
+  {
+    glGenerateTextureMipmap(_id);
+  }
+  else
+  {
+    glBindTexture(_target, _id);
+    glGenerateMipmap(_target);
+  }
+}
+
+void TextureStorage::setParameter(GLenum _target, GLuint _id, GLenum _name, GLint _value)
+{
+  queryCaps();
+  if (s_dsa)
+  {
+    glTextureParameteri(_id, _name, _value);
+  }
+  else
+  {
+    glBindTexture(_target, _id);
+    glTexParameteri(_target, _name, _value);
+  }
+}
+
+void TextureStorage::setParameter(GLenum _target, GLuint _id, GLenum _name, GLfloat _value)
+{
+  queryCaps();
+  if (s_dsa)
+  {
+    glTextureParameterf(_id, _name, _value);
+  }
+  else
+  {
+    glBindTexture(_target, _id);
+    glTexParameterf(_target, _name, _value);
+  }
+}
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+  // set for the workers and for the caller while it helps out, nested calls then run inline
+  thread_local bool t_inPool = false;
+}
+
+ThreadPool &ThreadPool::instance()
+{
+  static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int _threads)
+{
+  for (unsigned int i = 1; i < _threads; ++i)
+  {
+    m_workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_wake.notify_all();
+  for (auto &t : m_workers)
+  {
+    t.join();
+  }
+}
+
+void ThreadPool::runChunks()
+{
+  size_t begin;
+  while ((begin = m_next.fetch_add(m_grain)) < m_count)
+  {
+    (*m_job)(begin, std::min(begin + m_grain, m_count));
+  }
+}
+
+void ThreadPool::workerLoop()
+{
+  t_inPool = true;
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_wake.wait(lock, [&]
+                { return m_quit || m_generation != seen; });
+    if (m_quit)
+    {
+      return;
+    }
+    seen = m_generation;
+    lock.unlock();
+    runChunks();
+    lock.lock();
+    if (--m_active == 0)
+    {
+      m_done.notify_one();
+    }
+  }
+}
+
+void ThreadPool::parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_func, size_t _grain)
+{
+  if (_count == 0)
+  {
+    return;
+  }
+  _grain = std::max<size_t>(1, _grain);
+  if (m_workers.empty() || t_inPool || _count <= _grain)
+  {
+    _func(0, _count);
+    return;
+  }
+  std::lock_guard<std::mutex> submit(m_submit);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &_func;
+    m_count = _count;
+    m_grain = _grain;
+    m_next = 0;
+    m_active = m_workers.size();
+    ++m_generation;
+  }
+  m_wake.notify_all();
+  t_inPool = true;
+  runChunks();
+  t_inPool = false;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this]
+              { return m_active == 0; });
+  m_job = nullptr;
+}
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file EnvConvert.cpp
+/// @brief command line front end to EnvironmentConverter, converts equirectangular panoramas to cube faces and
+/// back and writes octahedral maps. Runs headless, only QImage is used for reading / writing images.
+/// usage EnvConvert [--cubic] [--size n] --to cube|equirect|octahedral input output
+/// cube maps are given as a file name containing {face} which is replaced by px nx py ny pz nz (GL face order)
+/// e.g. EnvConvert --to cube --size 512 panorama.png sky_{face}.png
+//----------------------------------------------------------------------------------------------------------------------
+#include "EnvironmentConverter.h"
+#include <QImage>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const std::array<const char *, 6> s_faceNames = {{"px", "nx", "py", "ny", "pz", "nz"}};
+
+static std::string faceFile(const std::string &_pattern, size_t _face)
+{
+  std::string name = _pattern;
+  name.replace(name.find("{face}"), 6, s_faceNames[_face]);
+  return name;
+}
+
+// 8 bit images are treated as gamma 2.2 and converted to linear for resampling
+static bool loadImage(const std::string &_fname, FloatImage &o_image)
+{
+  QImage image;
+  if (!image.load(QString::fromStdString(_fname)))
+  {
+    std::cerr << "EnvConvert: unable to load " << _fname << '\n';
+    return false;
+  }
+  image = image.convertToFormat(QImage::Format_RGBA8888);
+  o_image = FloatImage(image.width(), image.height());
+  for (int y = 0; y < image.height(); ++y)
+  {
+    FloatImage::decodeTexels(image.constScanLine(y), size_t(image.width()), 4, true, o_image.texel(0, y));
+  }
+  return true;
+}
+
+static bool saveImage(const std::string &_fname, const float *_texels, int _width, int _height)
+{
+  QImage image(_width, _height, QImage::Format_RGBA8888);
+  for (int y = 0; y < _height; ++y)
+  {
+    FloatImage::encodeTexels(_texels + size_t(y) * size_t(_width) * 4, size_t(_width), true, image.scanLine(y));
+  }
+  if (!image.save(QString::fromStdString(_fname)))
+  {
+    std::cerr << "EnvConvert: unable to write " << _fname << '\n';
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  Resample filter = Resample::Bilinear;
+  int size = 0;
+  std::string to;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--cubic") == 0)
+    {
+      filter = Resample::Cubic;
+    }
+    else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+    {
+      size = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--to") == 0 && i + 1 < argc)
+    {
+      to = argv[++i];
+    }
+    else
+    {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() != 2 || (to != "cube" && to != "equirect" && to != "octahedral"))
+  {
+    std::cerr << "usage EnvConvert [--cubic] [--size n] --to cube|equirect|octahedral input output\n"
+              << "cube maps are named with {face} which is replaced by px nx py ny pz nz\n";
+    return EXIT_FAILURE;
+  }
+  const std::string &input = args[0];
+  const std::string &output = args[1];
+  bool cubeIn = input.find("{face}") != std::string::npos;
+  if (to == "cube" && output.find("{face}") == std::string::npos)
+  {
+    std::cerr << "EnvConvert: cube output needs {face} in the file name\n";
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  FloatImage panorama;
+  CubeImage cube;
+  if (cubeIn)
+  {
+    std::array<FloatImage, 6> faces;
+    for (size_t f = 0; f < faces.size(); ++f)
+    {
+      if (!loadImage(faceFile(input, f), faces[f]))
+      {
+        return EXIT_FAILURE;
+      }
+      if (faces[f].width() != faces[f].height() || faces[f].width() != faces[0].width())
+      {
+        std::cerr << "EnvConvert: cube faces must be square and the same size\n";
+        return EXIT_FAILURE;
+      }
+    }
+    cube = CubeImage(faces[0].width());
+    for (int f = 0; f < 6; ++f)
+    {
+      std::copy(faces[size_t(f)].data(), faces[size_t(f)].data() + size_t(cube.size()) * size_t(cube.size()) * 4, cube.face(f));
+    }
+  }
+  else
+  {
+    if (!loadImage(input, panorama))
+    {
+      return EXIT_FAILURE;
+    }
+    if (panorama.width() != 2 * panorama.height())
+    {
+      std::cerr << "EnvConvert: " << input << " is not a 2:1 equirectangular panorama\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  bool ok = true;
+  if (to == "cube")
+  {
+    if (cubeIn)
+    {
+      std::cerr << "EnvConvert: input is already a cube map\n";
+      return EXIT_FAILURE;
+    }
+    // a quarter of the panorama width keeps roughly the same texel density at the equator
+    cube = EnvironmentConverter::equirectToCube(panorama, size > 0 ? size : panorama.width() / 4, filter);
+    for (size_t f = 0; f < 6 && ok; ++f)
+    {
+      ok = saveImage(faceFile(output, f), cube.face(int(f)), cube.size(), cube.size());
+    }
+  }
+  else if (to == "equirect")
+  {
+    if (!cubeIn)
+    {
+      std::cerr << "EnvConvert: input is already a panorama\n";
+      return EXIT_FAILURE;
+    }
+    FloatImage out = EnvironmentConverter::cubeToEquirect(cube, size > 0 ? size : cube.size() * 4, filter);
+    ok = saveImage(output, out.data(), out.width(), out.height());
+  }
+  else
+  {
+    FloatImage out = cubeIn ? EnvironmentConverter::cubeToOctahedral(cube, size > 0 ? size : cube.size() * 2, filter)
+                            : EnvironmentConverter::equirectToOctahedral(panorama, size > 0 ? size : panorama.height(), filter);
+    ok = saveImage(output, out.data(), out.width(), out.height());
+  }
+  auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (ok)
+  {
+    std::cout << "EnvConvert: wrote " << output << " in " << ms << " ms\n";
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PackAssets.cpp
+/// @brief build time tool that packs the demo asset directories into a single archive (see AssetArchiveFormat.h)
+/// usage PackAssets [--hash] output.assets dir [dir ...]
+/// entries are named by the last component of each directory plus the path inside it, e.g. shaders/TextureVert.glsl
+//----------------------------------------------------------------------------------------------------------------------
+#include "AssetArchiveFormat.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct PackEntry
+{
+  std::string name;
+  fs::path path;
+  std::vector<char> data;
+  ArchiveEntry entry;
+};
+
+static uint64_t alignUp(uint64_t _value, uint64_t _alignment)
+{
+  return (_value + _alignment - 1) & ~(_alignment - 1);
+}
+
+int main(int argc, char **argv)
+{
+  bool hash = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--hash") == 0)
+    {
+      hash = true;
+    }
+    else
+    {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() < 2)
+  {
+    std::cerr << "usage PackAssets [--hash] output.assets dir [dir ...]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<PackEntry> entries;
+  for (size_t i = 1; i < args.size(); ++i)
+  {
+    fs::path root(args[i]);
+    if (!fs::is_directory(root))
+    {
+      std::cerr << "PackAssets: " << root << " is not a directory\n";
+      return EXIT_FAILURE;
+    }
+    // strip any trailing separator so filename() gives us the directory name
+    auto prefix = root.lexically_normal();
+    if (prefix.filename().empty())
+    {
+      prefix = prefix.parent_path();
+    }
+    prefix = prefix.filename();
+    for (auto &file : fs::recursive_directory_iterator(root))
+    {
+      if (!file.is_regular_file())
+      {
+        continue;
+      }
+      PackEntry e;
+      e.path = file.path();
+      e.name = (prefix / fs::relative(file.path(), root)).generic_string();
+      entries.push_back(std::move(e));
+    }
+  }
+  // the reader binary searches the toc
+  std::sort(std::begin(entries), std::end(entries), [](const PackEntry &_a, const PackEntry &_b)
+            { return _a.name < _b.name; });
+
+  ArchiveHeader header;
+  std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+  header.version = ARCHIVE_VERSION;
+  header.entryCount = static_cast<uint32_t>(entries.size());
+  header.flags = hash ? ARCHIVE_HAS_HASHES : 0;
+  header.namesOffset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry);
+
+  std::string names;
+  for (auto &e : entries)
+  {
+    e.entry.nameOffset = static_cast<uint32_t>(names.size());
+    e.entry.nameLength = static_cast<uint32_t>(e.name.size());
+    names += e.name;
+  }
+  header.namesSize = names.size();
+
+  uint64_t offset = alignUp(header.namesOffset + header.namesSize, ARCHIVE_ALIGNMENT);
+  for (auto &e : entries)
+  {
+    std::ifstream in(e.path, std::ios::binary);
+    e.data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    e.entry.offset = offset;
+    e.entry.size = e.data.size();
+    e.entry.hash = hash ? fnv1a64(e.data.data(), e.data.size()) : 0;
+    offset = alignUp(offset + e.entry.size, ARCHIVE_ALIGNMENT);
+  }
+
+  std::ofstream out(args[0], std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cerr << "PackAssets: unable to write " << args[0] << '\n';
+    return EXIT_FAILURE;
+  }
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (auto &e : entries)
+  {
+    out.write(reinterpret_cast<const char *>(&e.entry), sizeof(ArchiveEntry));
+  }
+  out.write(names.data(), static_cast<std::streamsize>(names.size()));
+  const char padding[ARCHIVE_ALIGNMENT] = {};
+  for (auto &e : entries)
+  {
+    auto pos = static_cast<uint64_t>(out.tellp());
+    out.write(padding, static_cast<std::streamsize>(e.entry.offset - pos));
+    out.write(e.data.data(), static_cast<std::streamsize>(e.data.size()));
+  }
+  std::cout << "PackAssets: wrote " << entries.size() << " entries to " << args[0] << '\n';
+  return out.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformBench.cpp
+/// @brief times per instance MVP computation three ways: the scalar ngl::Transformation loop the demos used
+/// (reset / setRotation / setPosition / getMatrix then VP * M), BatchTransform on one thread and BatchTransform
+/// across the ThreadPool. Also reports the largest difference from the scalar results.
+/// usage TransformBench [--count n] [--passes n]
+//----------------------------------------------------------------------------------------------------------------------
+#include "BatchTransform.h"
+#include "ThreadPool.h"
+#include <ngl/Transformation.h>
+#include <ngl/Util.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// best of _passes in ms, the first run also warms the caches and the pool
+static double timeBest(int _passes, const std::function<void()> &_func)
+{
+  double best = 1e30;
+  for (int i = 0; i < _passes; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    _func();
+    best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+// relative to the size of each element so large translations don't dominate
+static float maxDifference(const std::vector<ngl::Mat4> &_a, const std::vector<ngl::Mat4> &_b)
+{
+  float result = 0.0f;
+  for (size_t i = 0; i < _a.size(); ++i)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      for (int r = 0; r < 4; ++r)
+      {
+        float a = _a[i].m_m[c][r];
+        result = std::max(result, std::fabs(a - _b[i].m_m[c][r]) / std::max(1.0f, std::fabs(a)));
+      }
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  size_t count = 19044;
+  int passes = 20;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+    {
+      count = size_t(std::atol(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+    {
+      passes = std::max(1, std::atoi(argv[++i]));
+    }
+    else
+    {
+      std::cerr << "usage TransformBench [--count n] [--passes n]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  TransformArrays instances;
+  instances.resize(count);
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+  std::uniform_real_distribution<float> angle(-360.0f, 360.0f);
+  for (size_t i = 0; i < count; ++i)
+  {
+    instances.px[i] = position(generator);
+    instances.py[i] = position(generator);
+    instances.pz[i] = position(generator);
+    instances.rx[i] = angle(generator);
+    instances.ry[i] = angle(generator);
+    instances.rz[i] = angle(generator);
+  }
+  ngl::Mat4 viewProject = ngl::perspective(45.0f, 1.25f, 0.05f, 350.0f) *
+                          ngl::lookAt(ngl::Vec3(0.0f, 2.0f, 4.0f), ngl::Vec3(0.0f, 0.0f, 0.0f), ngl::Vec3(0.0f, 1.0f, 0.0f));
+
+  std::vector<ngl::Mat4> scalar(count);
+  std::vector<ngl::Mat4> batched(count);
+  std::vector<ngl::Mat4> parallel(count);
+  double scalarTime = timeBest(passes, [&]()
+  {
+    ngl::Transformation transform;
+    for (size_t i = 0; i < count; ++i)
+    {
+      transform.reset();
+      transform.setRotation(instances.rx[i], instances.ry[i], instances.rz[i]);
+      transform.setPosition(instances.px[i], instances.py[i], instances.pz[i]);
+      scalar[i] = viewProject * transform.getMatrix();
+    }
+  });
+  double batchedTime = timeBest(passes, [&]() { BatchTransform::mvps(instances, 0, count, viewProject, batched.data()); });
+  double parallelTime = timeBest(passes, [&]() { BatchTransform::mvps(instances, viewProject, parallel.data()); });
+
+  std::cout << count << " instances, best of " << passes << " passes\n"
+            << "  ngl::Transformation     " << scalarTime << " ms\n"
+            << "  BatchTransform          " << batchedTime << " ms (" << scalarTime / batchedTime << "x)\n"
+            << "  BatchTransform x" << ThreadPool::instance().numThreads() << " threads " << parallelTime << " ms ("
+            << scalarTime / parallelTime << "x";
+  if (count < BatchTransform::PARALLEL_MIN)
+  {
+    std::cout << ", below PARALLEL_MIN so single threaded";
+  }
+  std::cout << ")\n"
+            << "  max difference from scalar " << maxDifference(scalar, batched) << " (batched) "
+            << maxDifference(scalar, parallel) << " (parallel)\n";
+  return EXIT_SUCCESS;
+}
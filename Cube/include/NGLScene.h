@@ -3,8 +3,23 @@
 #include <ngl/Transformation.h>
 #include <ngl/Text.h>
 #include <QOpenGLWindow>
-#include <QTime>
+#include "FrameProfiler.h"
+#include "FrameUniforms.h"
+#include "BatchTransform.h"
+#include "CullGrid.h"
+#include "InstanceTransformCache.h"
+#include "MaterialArray.h"
+#include "MeshBuilder.h"
+#include "OcclusionBuffer.h"
+#include "PersistentBuffer.h"
+#include "StaticBatch.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <memory>
+#include <string>
+#include <vector>
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @file NGLScene.h
@@ -19,14 +34,34 @@
 /// put in this file
 //----------------------------------------------------------------------------------------------------------------------
 
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the field layout and stress test options, set from the command line in main.cpp
+//----------------------------------------------------------------------------------------------------------------------
+struct FieldSettings
+{
+  // cubes along each side of the square field
+  size_t size = 138;
+  float spacing = 0.5f;
+  // spin every cube each frame so the whole instance cache is rebuilt and uploaded
+  bool animate = false;
+  // time every draw mode at counts from 10k up to scaleMax, print the table (and write reportFile) then quit
+  bool scale = false;
+  size_t scaleMax = 10000000;
+  std::string reportFile;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief side of the smallest square field holding at least _count cubes
+  //----------------------------------------------------------------------------------------------------------------------
+  static size_t sideFor(size_t _count) {return std::max(size_t(1), size_t(std::ceil(std::sqrt(double(_count)))));}
+};
+
 class NGLScene : public QOpenGLWindow
 {
   public:
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief ctor for our NGL drawing class
-    /// @param [in] parent the parent window to the class
+    /// @param [in] _settings the field size, spacing and stress test options
     //----------------------------------------------------------------------------------------------------------------------
-    NGLScene();
+    NGLScene(const FieldSettings &_settings = FieldSettings());
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief dtor must close down ngl and release OpenGL resources
     //----------------------------------------------------------------------------------------------------------------------
@@ -95,17 +130,13 @@ private:
     ngl::Mat4 m_view;
     ngl::Mat4 m_project;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief transformation stack for the gl transformations etc
-    //----------------------------------------------------------------------------------------------------------------------
-    ngl::Transformation m_transform;
-    //----------------------------------------------------------------------------------------------------------------------
     /// @brief the model position for mouse movement
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Vec3 m_modelPos;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to load transform matrices to the shader
+    /// @brief camera and per cube matrices, uploaded once a frame
     //----------------------------------------------------------------------------------------------------------------------
-    void loadMatricesToShader();
+    FrameUniforms m_uniforms;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
@@ -140,13 +171,155 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     void createCube( GLfloat _scale );
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief timer event used for the fps counter
+    /// @brief timer event used to redraw continuously
     //----------------------------------------------------------------------------------------------------------------------
     void timerEvent(QTimerEvent *) override;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief ID for the cube VAO
+    /// @brief the indexed, interleaved cube and its VAO (m_cube.vao), other VAOs share its buffers
     //----------------------------------------------------------------------------------------------------------------------
     GLuint m_vaoID;
+    Mesh m_cube;
+    // the cube's CPU side vertices and indices, the source of the baked field
+    std::unique_ptr<MeshBuilder> m_cubeSource;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per instance model matrices, attributes 2-5 of m_vaoID with a divisor of 1. They only depend on
+    /// the grid index so they are computed once, the wave (A) dirties two rows a frame
+    //----------------------------------------------------------------------------------------------------------------------
+    InstanceTransformCache m_instances;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief position / rotation of every cube as structure of arrays for BatchTransform, sorted into m_cullGrid
+    /// cell order so m_fieldSlot maps a grid index (row major, rows along z) to its slot
+    //----------------------------------------------------------------------------------------------------------------------
+    TransformArrays m_field;
+    std::vector<size_t> m_fieldSlot;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief material layer of each slot and the same in a static VBO per chunk of m_instances, the per instance
+    /// attribute 6 next to the matrices. The streamed and GPU compacted paths copy the layers of their survivors
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<float> m_fieldLayer;
+    std::vector<GLuint> m_layerBuffers;
+    size_t m_materialsUsed = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief (re)build the field at m_fieldSize x m_fieldSize, the grid, the cache and the culled buffers
+    //----------------------------------------------------------------------------------------------------------------------
+    void createInstances();
+    FieldSettings m_settings;
+    size_t m_fieldSize;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief turn every cube a little (--animate), dirtying the whole cache
+    //----------------------------------------------------------------------------------------------------------------------
+    void spinField();
+    void liftRow(size_t _row, bool _lift);
+    bool m_wave = false;
+    size_t m_waveRow = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief matrices recomputed and bytes uploaded by the instanced path in the last frame, for the overlay
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_lastRecomputed = 0;
+    size_t m_lastUploadBytes = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a draw per cube, one glDrawElementsInstanced per chunk, CPU grid culled with one instanced draw per
+    /// visible range, CPU grid and occlusion culled, compute culled with one glMultiDrawElementsIndirect (GL 4.3
+    /// only) or baked into a static VBO, I cycles
+    //----------------------------------------------------------------------------------------------------------------------
+    enum class DrawMode {PerCube, Instanced, CPUCulled, Occluded, GPUCulled, Baked};
+    static constexpr size_t NUM_DRAW_MODES = 6;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false for modes this context or field size can't use
+    //----------------------------------------------------------------------------------------------------------------------
+    bool modeAvailable(DrawMode _mode) const;
+    DrawMode m_drawMode = DrawMode::Instanced;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the ways of drawing the field, all return the number of cubes drawn
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t drawPerCube();
+    size_t drawInstanced();
+    size_t drawGridCulled();
+    size_t drawOccluded();
+    size_t drawCulled();
+    size_t drawBaked();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief advance the wave and bring the instance VBOs up to date, for the instanced paths
+    //----------------------------------------------------------------------------------------------------------------------
+    void updateInstances();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief point attributes 2-5 of the bound VAO at a buffer of mat4s, one per instance, starting at instance
+    /// _first, and attribute 6 at the float layers in _layers starting at float _firstLayer. The cache is split into
+    /// chunks so the instanced paths call this once per chunk
+    //----------------------------------------------------------------------------------------------------------------------
+    void setInstanceAttributes(GLuint _buffer, GLuint _layers, size_t _first = 0, size_t _firstLayer = 0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief static quadtree over the field, its bounds allow for the wave lift. The ranges surviving the last cull,
+    /// how long the cull took and whether they can be drawn with a base instance (GL 4.2) or need the attributes
+    /// moved per range
+    //----------------------------------------------------------------------------------------------------------------------
+    CullGrid m_cullGrid;
+    std::vector<CullRange> m_cullRanges;
+    double m_cullTime = 0.0;
+    bool m_baseInstance = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief software Hi-Z occlusion after the grid cull. The nearest cubes are rasterised as occluders, the rest
+    /// are tested against the pyramid and the survivors' matrices and layers are written straight into the next
+    /// region of m_occludedStream for one draw
+    //----------------------------------------------------------------------------------------------------------------------
+    void createOcclusion();
+    OcclusionBuffer m_occlusion;
+    std::vector<uint32_t> m_candidates;
+    PersistentBuffer m_occludedStream;
+    // instances a region of the stream holds and survivors left out because it was full
+    size_t m_streamCapacity = 0;
+    size_t m_streamOverflow = 0;
+    GLuint m_occludedVAO = 0;
+    size_t m_numOccluders = 0;
+    size_t m_occludedCount = 0;
+    double m_occlusionTime = 0.0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief every cube pre-transformed into one static VBO, rebaked only when the field changes. Spatial chunks of
+    /// 3640 cubes (16 bit indices) are culled on their bounds, or B switches to one chunk for a single draw
+    //----------------------------------------------------------------------------------------------------------------------
+    StaticBatch m_baked;
+    bool m_bakeStale = true;
+    bool m_bakeChunked = true;
+    double m_bakeTime = 0.0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief GPU memory each mode draws the field from, instance matrices and culled buffers or the baked VBO
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t modeBytes(DrawMode _mode) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a VAO for the cube reading its instance matrices from _instances and layers from _layers, 0 leaves
+    /// them to be set per draw
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint createInstanceVAO(GLuint _instances, GLuint _layers);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compute culling, the visible matrices are compacted into m_visibleBuffer, their layers into
+    /// m_visibleLayers, and counted in the indirect command. m_cullVAO reads its instances from the visible buffers
+    //----------------------------------------------------------------------------------------------------------------------
+    void createCulling();
+    bool m_canCull = false;
+    GLuint m_cullVAO = 0;
+    GLuint m_visibleBuffer = 0;
+    GLuint m_visibleLayers = 0;
+    size_t m_visibleCapacity = 0;
+    GLuint m_commandBuffer = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief grow the occlusion stream and the GPU visible buffer for the instance count. Both only hold survivors
+    /// so they are capped rather than sized for millions of cubes
+    //----------------------------------------------------------------------------------------------------------------------
+    void resizeCullBuffers();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the visible count is copied into a small ring and read back once its fence has passed so the
+    /// overlay never stalls the pipeline
+    //----------------------------------------------------------------------------------------------------------------------
+    void readVisibleCount();
+    std::array<GLuint, 3> m_countBuffers = {{0, 0, 0}};
+    std::array<GLsync, 3> m_countFences = {{nullptr, nullptr, nullptr}};
+    size_t m_countFrame = 0;
+    size_t m_visibleCount = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief model matrix of the cube at grid index _index (row major, rows along z) through ngl::Transformation
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Mat4 cubeMatrix(size_t _index);
+    ngl::Transformation m_transform;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief load the texture and store the id in m_textureName
     //----------------------------------------------------------------------------------------------------------------------
@@ -156,6 +329,26 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     GLuint m_textureName;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief BC1 and BC7 block compressed versions of the crate texture, 0 if the context can't sample them
+    //----------------------------------------------------------------------------------------------------------------------
+    std::array<GLuint, 2> m_compressedNames = {{0, 0}};
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief tinted crates as the layers of one texture array, M switches the instanced paths to them. They stay
+    /// one texture bind and one draw however many materials there are
+    //----------------------------------------------------------------------------------------------------------------------
+    MaterialArray m_materials;
+    bool m_useMaterials = false;
+    bool usesMaterials() const;
+    const char *instanceShader() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief which texture to draw with, 0 uncompressed RGBA8, 1 BC1, 2 BC7
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_textureMode = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief GPU size in bytes of each of the texture modes for the overlay
+    //----------------------------------------------------------------------------------------------------------------------
+    std::array<size_t, 3> m_textureBytes = {{0, 0, 0}};
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief our font / text
     //----------------------------------------------------------------------------------------------------------------------
     std::unique_ptr<ngl::Text> m_text;
@@ -164,21 +357,38 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     GLenum m_polyMode;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief flag for the fps timer
+    /// @brief id of the timer that redraws continuously
     //----------------------------------------------------------------------------------------------------------------------
-    int m_fpsTimer;
+    int m_redrawTimer;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief the fps to draw
+    /// @brief frame, CPU and GPU times with the "field" pass covering everything the cubes cost to submit and draw,
+    /// the "overlay" pass the text. P records them to CubeProfile.csv
     //----------------------------------------------------------------------------------------------------------------------
-    int m_fps;
+    FrameProfiler m_profiler;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief frame counter
+    /// @brief the --scale sweep. Each count is drawn in every mode it can use, a few frames to settle then up to
+    /// SCALE_FRAMES frames or SCALE_SECONDS are averaged into one result
     //----------------------------------------------------------------------------------------------------------------------
-    int m_frames;
+    struct ScaleResult
+    {
+      size_t instances;
+      DrawMode mode;
+      double fps;
+      double cpuTime;
+      double gpuTime;
+      size_t bytes;
+    };
+    void recordScaleFrame();
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief timer used for FPS counting
+    /// @brief the first mode from _mode on the current count can be drawn in, NUM_DRAW_MODES if none
     //----------------------------------------------------------------------------------------------------------------------
-    QTime m_timer;
+    size_t nextScaleMode(size_t _mode) const;
+    void writeScaleReport() const;
+    std::vector<size_t> m_scaleCounts;
+    size_t m_scaleCount = 0;
+    size_t m_scaleFrame = 0;
+    std::chrono::steady_clock::time_point m_scaleStart;
+    std::vector<ScaleResult> m_scaleResults;
 
 };
 
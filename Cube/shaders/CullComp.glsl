@@ -0,0 +1,71 @@
+#version 430 core
+// one invocation per cube, survivors of the frustum test are appended to the visible buffer and counted in the
+// indirect command so the draw only ever sees what is on screen
+layout(local_size_x = 64) in;
+
+struct DrawElementsIndirectCommand
+{
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+// the model matrices from one chunk of the InstanceTransformCache, dispatched once per chunk
+layout(std430, binding = 0) readonly buffer Instances
+{
+  mat4 models[];
+};
+layout(std430, binding = 1) writeonly buffer Visible
+{
+  mat4 visible[];
+};
+layout(std430, binding = 2) buffer Command
+{
+  DrawElementsIndirectCommand command;
+};
+// the material layer of each instance in the chunk, copied alongside its matrix
+layout(std430, binding = 3) readonly buffer Layers
+{
+  float layers[];
+};
+layout(std430, binding = 4) writeonly buffer VisibleLayers
+{
+  float visibleLayers[];
+};
+// left, right, bottom, top, near, far in model space, inside is positive
+uniform vec4 planes[6];
+// bounding sphere of the cube before the model transform
+uniform float radius;
+// instances in the chunk bound to Instances, and how many matrices Visible can hold
+uniform uint numInstances;
+uniform uint capacity;
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= numInstances)
+  {
+    return;
+  }
+  mat4 model = models[i];
+  vec3 centre = model[3].xyz;
+  // the cubes may be scaled so grow the sphere by the largest axis
+  float scale = sqrt(max(dot(model[0].xyz, model[0].xyz), max(dot(model[1].xyz, model[1].xyz), dot(model[2].xyz, model[2].xyz))));
+  for (int p = 0; p < 6; ++p)
+  {
+    if (dot(planes[p].xyz, centre) + planes[p].w < -radius * scale)
+    {
+      return;
+    }
+  }
+  uint slot = atomicAdd(command.instanceCount, 1u);
+  if (slot >= capacity)
+  {
+    // full, give the slot back so the draw count stays at capacity
+    atomicAdd(command.instanceCount, 0xffffffffu);
+    return;
+  }
+  visible[slot] = model;
+  visibleLayers[slot] = layers[i];
+}
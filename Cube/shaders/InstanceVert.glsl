@@ -0,0 +1,29 @@
+#version 330 core
+
+// camera from the FrameUniforms ring buffer (binding 0)
+layout(std140) uniform FrameData
+{
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec4 eye;
+};
+// first attribute the vertex values from our VAO
+layout (location=0) in vec3 inVert;
+// second attribute the UV values from our VAO
+layout (location=1)in vec2 inUV;
+// per instance model matrix, one column per attribute (2-5) with a divisor of 1
+layout (location=2) in mat4 inModel;
+// per instance material layer from the buffer alongside the matrices, also a divisor of 1
+layout (location=6) in float inLayer;
+// we use this to pass the UV values to the frag shader
+out vec2 vertUV;
+// the texture array layer for MaterialFrag.glsl, TextureFrag.glsl ignores it
+flat out float vertLayer;
+
+void main()
+{
+gl_Position = viewProjection*inModel*vec4(inVert, 1.0);
+vertLayer = inLayer;
+vertUV=inUV;
+}
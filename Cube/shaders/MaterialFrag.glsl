@@ -0,0 +1,13 @@
+#version 330 core
+// every material is a layer of one texture array so the whole field shares this binding
+uniform sampler2DArray tex;
+// the vertex UV
+in vec2 vertUV;
+// the instance's layer from InstanceVert.glsl
+flat in float vertLayer;
+// the final fragment colour
+layout (location =0) out vec4 outColour;
+void main ()
+{
+ outColour = texture(tex, vec3(vertUV, vertLayer));
+}
@@ -1,10 +1,21 @@
 #include <QMouseEvent>
 #include <QGuiApplication>
 #include "NGLScene.h"
+#include "Assets.h"
+#include "BlockCompressor.h"
+#include "Frustum.h"
+#include "GLInfo.h"
+#include "MeshBuilder.h"
+#include "TextureStorage.h"
+#include "ThreadPool.h"
 #include <ngl/Transformation.h>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <iostream>
@@ -17,8 +28,48 @@ const static float INCREMENT = 0.01f;
 /// @brief the increment for the wheel zoom
 //----------------------------------------------------------------------------------------------------------------------
 const static float ZOOM = 0.1f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief bounding sphere of the cube (createCube(0.2f) so half extents of 0.2) and the cull shader group size
+//----------------------------------------------------------------------------------------------------------------------
+const static float CUBE_RADIUS = 0.2f * 1.7320508f;
+const static GLuint CULL_GROUP_SIZE = 64;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the wave lifts a row by this much, the CPU cull grid is built once so its bounds include it
+//----------------------------------------------------------------------------------------------------------------------
+const static float WAVE_LIFT = 0.5f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how many of the nearest cubes are rasterised into the occlusion buffer each frame
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t OCCLUDERS = 256;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the culled paths only store survivors, this many matrices (64 MB) at most whatever the field size
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t MAX_VISIBLE = 1 << 20;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the per cube path queues every matrix into the FrameUniforms buffer, bigger fields only draw this many
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t PER_CUBE_LIMIT = 65536;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief --scale frames drawn before timing starts, then the most frames / seconds averaged per result
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t SCALE_WARMUP = 5;
+const static size_t SCALE_FRAMES = 100;
+const static double SCALE_SECONDS = 2.0;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief instance counts the sweep steps through, up to FieldSettings::scaleMax
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t SCALE_COUNTS[] = {10000, 30000, 100000, 300000, 1000000, 3000000, 10000000};
+const static char *SCALE_MODE_NAMES[] = {"per cube", "instanced", "CPU culled", "occluded", "GPU culled", "baked"};
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the baked mode copies the whole cube per instance (288 bytes), it isn't offered for bigger fields
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t MAX_BAKED = 1 << 20;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief tinted copies of the crate in the material array, scattered over the field
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t NUM_MATERIALS = 48;
 
-NGLScene::NGLScene()
+NGLScene::NGLScene(const FieldSettings &_settings) : m_settings(_settings), m_fieldSize(_settings.size)
 {
   // re-size the widget to that of the parent (in this case the GLFrame passed in on construction)
   m_rotate = false;
@@ -26,17 +77,14 @@ NGLScene::NGLScene()
   m_spinXFace = 0;
   m_spinYFace = 0;
   setTitle("Simple OpenGL Texture");
-  m_fpsTimer = startTimer(0);
-  m_fps = 0;
-  m_frames = 0;
-  // m_timer.start();
+  m_redrawTimer = startTimer(0);
   m_polyMode = GL_FILL;
 }
 
 void NGLScene::loadTexture()
 {
   QImage image;
-  bool loaded = image.load("textures/crate.bmp");
+  bool loaded = Assets::loadImage("textures/crate.bmp", image);
   if (loaded == true)
   {
     int width = image.width();
@@ -57,15 +105,41 @@ void NGLScene::loadTexture()
       }
     }
 
-    glGenTextures(1, &m_textureName);
-    glBindTexture(GL_TEXTURE_2D, m_textureName);
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    // one immutable allocation for the whole chain then fill level 0 and let GL build the rest
+    m_textureName = TextureStorage::create(GL_TEXTURE_2D, TextureStorage::fullMipLevels(width, height), GL_RGBA8, width, height);
+    // SamplerState sampler{GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST};
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data.get());
+    TextureStorage::upload(GL_TEXTURE_2D, m_textureName, 0, 0, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, data.get());
 
-    glGenerateMipmap(GL_TEXTURE_2D); //  Allocate the mipmaps
-    glBindTexture(GL_TEXTURE_2D, 0);
+    TextureStorage::generateMipmaps(GL_TEXTURE_2D, m_textureName);
+    // RGBA8 plus a full mip chain is 4/3 of the base level
+    m_textureBytes[0] = width * height * 4 * 4 / 3;
+
+    // block compressed versions of the same pixels, after the first run these come straight from the texture cache
+    const BlockFormat formats[] = {BlockFormat::BC1, BlockFormat::BC7};
+    for (size_t i = 0; i < m_compressedNames.size(); ++i)
+    {
+      auto compressed = BlockCompressor::compressMipChain(data.get(), width, height, 3, formats[i], CompressionQuality::High);
+      m_compressedNames[i] = BlockCompressor::createTexture(compressed);
+      // a format the context can't sample draws with the RGBA8 texture instead, so that is the size reported
+      m_textureBytes[i + 1] = m_compressedNames[i] != 0 ? compressed.sizeInBytes() : m_textureBytes[0];
+    }
+
+    // the materials are the crate tinted round the colour wheel, all the same size so they share one array
+    m_materials.create(width, height, GLsizei(NUM_MATERIALS));
+    std::vector<unsigned char> tinted(size_t(width) * size_t(height) * 3);
+    for (size_t m = 0; m < NUM_MATERIALS; ++m)
+    {
+      float hue = 6.0f * float(m) / float(NUM_MATERIALS);
+      float tint[3] = {std::clamp(std::abs(hue - 3.0f) - 1.0f, 0.0f, 1.0f), std::clamp(2.0f - std::abs(hue - 2.0f), 0.0f, 1.0f),
+                       std::clamp(2.0f - std::abs(hue - 4.0f), 0.0f, 1.0f)};
+      for (size_t i = 0; i < tinted.size(); ++i)
+      {
+        tinted[i] = static_cast<unsigned char>(float(data[i]) * (0.4f + 0.6f * tint[i % 3]));
+      }
+      m_materials.add(fmt::format("crate{}", m), tinted.data(), GL_RGB, width, height);
+    }
+    m_materials.generateMipmaps();
   }
 }
 
@@ -95,34 +169,16 @@ void NGLScene::createCube(GLfloat _scale)
 
   };
 
-  std::cout << sizeof(vertices) / sizeof(GLfloat) << "\n";
-  // first we scale our vertices to _scale
-  for (uint i = 0; i < sizeof(vertices) / sizeof(GLfloat); ++i)
+  // each corner goes in as position + UV, the builder shares repeated corners and writes one interleaved VBO. The
+  // UVs are 0 or 1 so half floats hold them exactly, 16 bytes a vertex rather than 20
+  m_cubeSource = std::make_unique<MeshBuilder>(VertexLayout({{0, 3, AttributeFormat::Float}, {1, 2, AttributeFormat::HalfFloat}}));
+  for (size_t corner = 0; corner < sizeof(texture) / (2 * sizeof(GLfloat)); ++corner)
   {
-    vertices[i] *= _scale;
+    m_cubeSource->addVertex({vertices[3 * corner] * _scale, vertices[3 * corner + 1] * _scale, vertices[3 * corner + 2] * _scale,
+                             texture[2 * corner], texture[2 * corner + 1]});
   }
-
-  // first we create a vertex array Object
-  glGenVertexArrays(1, &m_vaoID);
-
-  // now bind this to be the currently active one
-  glBindVertexArray(m_vaoID);
-  // now we create two VBO's one for each of the objects these are only used here
-  // as they will be associated with the vertex array object
-  GLuint vboID[2];
-  glGenBuffers(2, &vboID[0]);
-  // now we will bind an array buffer to the first one and load the data for the verts
-  glBindBuffer(GL_ARRAY_BUFFER, vboID[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices) * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
-  // now we bind the vertex attribute pointer for this object in this case the
-  // vertex data
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(0);
-  // now we repeat for the UV data using the second VBO
-  glBindBuffer(GL_ARRAY_BUFFER, vboID[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(texture) * sizeof(GLfloat), texture, GL_STATIC_DRAW);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(1);
+  m_cube = m_cubeSource->upload();
+  m_vaoID = m_cube.vao;
 }
 
 NGLScene::~NGLScene()
@@ -130,6 +186,20 @@ NGLScene::~NGLScene()
   std::cout << "Shutting down NGL, removing VAO's and Shaders\n";
   // remove the texture now we are done
   glDeleteTextures(1, &m_textureName);
+  glDeleteTextures(GLsizei(m_compressedNames.size()), m_compressedNames.data());
+  m_cube.release();
+  m_baked.release();
+  glDeleteVertexArrays(1, &m_cullVAO);
+  glDeleteVertexArrays(1, &m_occludedVAO);
+  glDeleteBuffers(1, &m_visibleBuffer);
+  glDeleteBuffers(1, &m_visibleLayers);
+  glDeleteBuffers(GLsizei(m_layerBuffers.size()), m_layerBuffers.data());
+  glDeleteBuffers(1, &m_commandBuffer);
+  glDeleteBuffers(GLsizei(m_countBuffers.size()), m_countBuffers.data());
+  for (auto &fence : m_countFences)
+  {
+    glDeleteSync(fence);
+  }
 }
 
 void NGLScene::resizeGL(int _w, int _h)
@@ -144,6 +214,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("Cube.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -166,8 +238,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("SimpleVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("SimpleFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("SimpleVertex");
   ngl::ShaderLib::compileShader("SimpleFragment");
@@ -175,26 +247,63 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "SimpleFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("TextureShader"));
   ngl::ShaderLib::use("TextureShader");
   ngl::ShaderLib::setUniform("tex", 0);
+  // same fragment shader, the model matrix comes from the instance attributes
+  ngl::ShaderLib::createShaderProgram("InstanceShader");
+  ngl::ShaderLib::attachShader("InstanceVertex", ngl::ShaderType::VERTEX);
+  Assets::loadShaderSource("InstanceVertex", "shaders/InstanceVert.glsl");
+  ngl::ShaderLib::compileShader("InstanceVertex");
+  ngl::ShaderLib::attachShaderToProgram("InstanceShader", "InstanceVertex");
+  ngl::ShaderLib::attachShaderToProgram("InstanceShader", "SimpleFragment");
+  ngl::ShaderLib::linkProgramObject("InstanceShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("InstanceShader"));
+  ngl::ShaderLib::use("InstanceShader");
+  ngl::ShaderLib::setUniform("tex", 0);
+  // and again sampling the material array at the instance's layer
+  ngl::ShaderLib::createShaderProgram("MaterialShader");
+  ngl::ShaderLib::attachShader("MaterialFragment", ngl::ShaderType::FRAGMENT);
+  Assets::loadShaderSource("MaterialFragment", "shaders/MaterialFrag.glsl");
+  ngl::ShaderLib::compileShader("MaterialFragment");
+  ngl::ShaderLib::attachShaderToProgram("MaterialShader", "InstanceVertex");
+  ngl::ShaderLib::attachShaderToProgram("MaterialShader", "MaterialFragment");
+  ngl::ShaderLib::linkProgramObject("MaterialShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("MaterialShader"));
+  ngl::ShaderLib::use("MaterialShader");
+  ngl::ShaderLib::setUniform("tex", 0);
 
   createCube(0.2f);
+  createCulling();
+  createOcclusion();
+  if (m_settings.scale)
+  {
+    for (size_t count : SCALE_COUNTS)
+    {
+      if (count <= m_settings.scaleMax)
+      {
+        m_scaleCounts.push_back(count);
+      }
+    }
+    if (m_scaleCounts.empty())
+    {
+      m_scaleCounts.push_back(m_settings.scaleMax);
+    }
+    m_fieldSize = FieldSettings::sideFor(m_scaleCounts[0]);
+  }
+  createInstances();
+  if (m_settings.scale)
+  {
+    m_drawMode = DrawMode(nextScaleMode(0));
+  }
   loadTexture();
   m_text = std::make_unique<ngl::Text>("fonts/Arial.ttf", 14);
   m_text->setScreenSize(width(), height());
 }
 
-void NGLScene::loadMatricesToShader()
-{
-  ngl::Mat4 MVP = m_project * m_view *
-                  m_mouseGlobalTX *
-                  m_transform.getMatrix();
-
-  ngl::ShaderLib::setUniform("MVP", MVP);
-}
-
 void NGLScene::paintGL()
 {
+  m_profiler.beginFrame();
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_width, m_height);
@@ -208,34 +317,745 @@ void NGLScene::paintGL()
   m_mouseGlobalTX.m_m[3][1] = m_modelPos.m_y;
   m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
 
-  ngl::ShaderLib::use("TextureShader");
   // now we bind back our vertex array object and draw
   glBindVertexArray(m_vaoID); // select first VAO
 
-  int instances = 0;
-  // need to bind the active texture before drawing
-  glBindTexture(GL_TEXTURE_2D, m_textureName);
+  // need to bind the active texture before drawing, with materials the array replaces it for the whole field
+  if (usesMaterials())
+  {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_materials.id());
+  }
+  else
+  {
+    GLuint texture = m_textureMode == 0 ? m_textureName : m_compressedNames[m_textureMode - 1];
+    glBindTexture(GL_TEXTURE_2D, texture != 0 ? texture : m_textureName);
+  }
   glPolygonMode(GL_FRONT_AND_BACK, m_polyMode);
 
-  for (float z = -34; z < 35; z += 0.5)
+  // the field pass covers everything the cubes cost to submit, the overlay text is timed on its own
+  m_profiler.beginPass("field");
+  if (m_settings.animate)
+  {
+    spinField();
+  }
+  size_t instances = 0;
+  switch (m_drawMode)
+  {
+  case DrawMode::PerCube:
+    instances = drawPerCube();
+    break;
+  case DrawMode::Instanced:
+    instances = drawInstanced();
+    break;
+  case DrawMode::CPUCulled:
+    instances = drawGridCulled();
+    break;
+  case DrawMode::Occluded:
+    instances = drawOccluded();
+    break;
+  case DrawMode::GPUCulled:
+    instances = drawCulled();
+    break;
+  case DrawMode::Baked:
+    instances = drawBaked();
+    break;
+  }
+  m_uniforms.endFrame();
+  m_profiler.beginPass("overlay");
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  m_text->setColour(1.0f, 1.0f, 0.0f);
+  m_text->renderText(10, 700, fmt::format("Texture and Vertex Array Object Demo {} of {} instances", instances, m_instances.size()));
+  if (m_drawMode == DrawMode::PerCube)
+  {
+    m_text->renderText(10, 660, m_field.size() > PER_CUBE_LIMIT ? fmt::format("1 draw per cube, the first {} only (I to change)", PER_CUBE_LIMIT)
+                                                                 : std::string("1 draw per cube (I to change)"));
+  }
+  else
+  {
+    const char *drawModes[] = {"", "1 instanced draw per chunk", "CPU grid culled instanced draws", "CPU grid and Hi-Z occlusion culled",
+                               "GPU culled multi draw indirect", "baked static VBO"};
+    m_text->renderText(10, 660, fmt::format("{} (I to change), {} matrices recomputed {:.1f} KB uploaded (A wave)",
+                                            drawModes[size_t(m_drawMode)], m_lastRecomputed, m_lastUploadBytes / 1024.0f));
+  }
+  if (m_drawMode == DrawMode::CPUCulled)
+  {
+    m_text->renderText(10, 640, fmt::format("{} visible {} culled, {} ranges from {} of {} cells tested in {:.3f} ms", instances,
+                                            m_instances.size() - instances, m_cullRanges.size(), m_cullGrid.nodesTested(),
+                                            m_cullGrid.numLeaves(), m_cullTime));
+  }
+  else if (m_drawMode == DrawMode::Occluded)
+  {
+    m_text->renderText(10, 640, fmt::format("{} visible {} occluded {} outside, frustum {:.3f} ms", instances, m_occludedCount,
+                                            m_instances.size() - instances - m_occludedCount, m_cullTime));
+    m_text->renderText(10, 620, fmt::format("{} occluders {} triangles into {}x{} depth, Hi-Z tests {:.3f} ms", m_numOccluders,
+                                            m_occlusion.numTriangles(), m_occlusion.width(), m_occlusion.height(), m_occlusionTime));
+    m_text->renderText(10, 600, fmt::format("survivors streamed through a {} ring, {} waits (last {:.3f} ms), {} over the {} limit",
+                                            m_occludedStream.persistent() ? "persistent mapped" : "mapped per frame",
+                                            m_occludedStream.numWaits(), m_occludedStream.lastWaitTime(), m_streamOverflow,
+                                            m_streamCapacity));
+  }
+  else if (m_drawMode == DrawMode::GPUCulled)
+  {
+    m_text->renderText(10, 640, fmt::format("{} visible {} culled, at most {} drawn", m_visibleCount,
+                                            m_instances.size() - std::min(m_visibleCount, m_instances.size()), m_visibleCapacity));
+  }
+  else if (m_drawMode == DrawMode::Baked)
+  {
+    m_text->renderText(10, 640, fmt::format("{} of {} chunks drawn (B to change), baked in {:.1f} ms", m_baked.chunksDrawn(),
+                                            m_baked.numChunks(), m_bakeTime));
+    m_text->renderText(10, 620, fmt::format("{:.1f} MB vertices {:.1f} KB indices against {:.1f} MB of instance data",
+                                            m_baked.vertexBytes() / 1048576.0, m_baked.indexBytes() / 1024.0,
+                                            modeBytes(DrawMode::Instanced) / 1048576.0));
+  }
+  const char *textureModes[] = {"RGBA8", "BC1", "BC7"};
+  if (usesMaterials())
+  {
+    m_text->renderText(10, 680, fmt::format("{} materials in a {} layer array {} KB, one texture bind (M to change), a texture each needs {} binds and draws",
+                                            m_materialsUsed, m_materials.size(), m_materials.sizeInBytes() / 1024, m_materialsUsed));
+  }
+  else
+  {
+    // a compressed mode the context can't sample is drawn with the RGBA8 texture
+    bool fallback = m_textureMode != 0 && m_compressedNames[m_textureMode - 1] == 0;
+    std::string format = fallback ? fmt::format("RGBA8 ({} unsupported)", textureModes[m_textureMode]) : textureModes[m_textureMode];
+    m_text->renderText(10, 680, fmt::format("Texture {} {} KB (C to change, M for materials{})", format, m_textureBytes[m_textureMode] / 1024,
+                                            m_useMaterials ? ", instanced modes only" : ""));
+  }
+  if (m_settings.scale)
+  {
+    m_text->renderText(10, 580, fmt::format("scaling {} of {} counts, {} instances {}", m_scaleCount + 1, m_scaleCounts.size(),
+                                            m_instances.size(), SCALE_MODE_NAMES[size_t(m_drawMode)]));
+  }
+  m_profiler.draw(*m_text, 10, 560);
+  m_profiler.endFrame();
+  if (m_settings.scale)
+  {
+    recordScaleFrame();
+  }
+}
+
+ngl::Mat4 NGLScene::cubeMatrix(size_t _index)
+{
+  // the scalar reference, the instanced path gets the same matrices from BatchTransform
+  m_transform.reset();
+  m_transform.setRotation(m_field.rx[_index], m_field.ry[_index], m_field.rz[_index]);
+  m_transform.setPosition(m_field.px[_index], m_field.py[_index], m_field.pz[_index]);
+  return m_transform.getMatrix();
+}
+
+void NGLScene::liftRow(size_t _row, bool _lift)
+{
+  // the field is in cell order, a row is a short run in each cell it crosses
+  for (size_t i = _row * m_fieldSize; i < (_row + 1) * m_fieldSize; ++i)
+  {
+    size_t slot = m_fieldSlot[i];
+    m_field.py[slot] = _lift ? 0.49f + WAVE_LIFT : 0.49f;
+    m_instances.markDirty(slot);
+  }
+}
+
+void NGLScene::createInstances()
+{
+  // centred on the origin, the default 138 x 138 field 0.5 apart runs from -34 to 34.5
+  float start = -m_settings.spacing * (float(m_fieldSize) * 0.5f - 1.0f);
+  m_field.resize(m_fieldSize * m_fieldSize);
+  for (size_t i = 0; i < m_field.size(); ++i)
+  {
+    float x = start + m_settings.spacing * float(i % m_fieldSize);
+    float z = start + m_settings.spacing * float(i / m_fieldSize);
+    m_field.px[i] = x;
+    m_field.py[i] = 0.49f;
+    m_field.pz[i] = z;
+    m_field.rx[i] = x * 20.0f;
+    m_field.ry[i] = (x * z) * 40.0f;
+    m_field.rz[i] = z * 2.0f;
+  }
+  // sorted into cell order once, every cell and block of cells is then a contiguous range of instances
+  m_cullGrid.build(m_field, CUBE_RADIUS + WAVE_LIFT);
+  m_fieldSlot.resize(m_field.size());
+  m_fieldLayer.resize(m_field.size());
+  std::vector<bool> used(NUM_MATERIALS, false);
+  for (size_t slot = 0; slot < m_field.size(); ++slot)
+  {
+    size_t index = m_cullGrid.order()[slot];
+    m_fieldSlot[index] = slot;
+    // scattered by a hash of the grid position so neighbours rarely share a material
+    size_t layer = ((uint32_t(index) * 2654435761u) >> 16) % NUM_MATERIALS;
+    m_fieldLayer[slot] = float(layer);
+    used[layer] = true;
+  }
+  m_materialsUsed = size_t(std::count(used.begin(), used.end(), true));
+  // runs of dirty instances go through the SIMD kernel four at a time
+  m_instances.reset(m_field.size(), [this](size_t _begin, size_t _end, ngl::Mat4 *o_matrices)
+  {
+    BatchTransform::models(m_field, _begin, _end, o_matrices);
+  });
+  m_instances.update();
+  m_instances.upload();
+  // the layers never change, a static buffer per chunk of the cache so each draw points at the pair
+  glDeleteBuffers(GLsizei(m_layerBuffers.size()), m_layerBuffers.data());
+  m_layerBuffers.assign(m_instances.numChunks(), 0);
+  glGenBuffers(GLsizei(m_layerBuffers.size()), m_layerBuffers.data());
+  for (size_t chunk = 0; chunk < m_layerBuffers.size(); ++chunk)
   {
-    for (float x = -34; x < 35; x += 0.5)
+    glBindBuffer(GL_ARRAY_BUFFER, m_layerBuffers[chunk]);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_instances.chunkCount(chunk) * sizeof(float)),
+                 &m_fieldLayer[chunk * InstanceTransformCache::CHUNK_SIZE], GL_STATIC_DRAW);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_waveRow = 0;
+  m_bakeStale = true;
+  glBindVertexArray(m_vaoID);
+  setInstanceAttributes(m_instances.buffer(0), m_layerBuffers[0]);
+  glBindVertexArray(0);
+  resizeCullBuffers();
+}
+
+void NGLScene::spinField()
+{
+  ThreadPool::instance().parallelFor(m_field.size(), [this](size_t _begin, size_t _end)
+  {
+    for (size_t i = _begin; i < _end; ++i)
     {
-      m_transform.reset();
+      m_field.ry[i] += 1.0f;
+    }
+  }, 65536);
+  m_instances.markAllDirty();
+}
+
+void NGLScene::resizeCullBuffers()
+{
+  size_t capacity = std::min(m_instances.size(), MAX_VISIBLE);
+  // the occlusion VAO is pointed at the region drawn each frame, a new buffer needs nothing else. A region holds
+  // the matrices then the layers of the survivors
+  m_occludedStream.reserve(capacity * (sizeof(ngl::Mat4) + sizeof(float)));
+  m_streamCapacity = m_occludedStream.regionSize() / (sizeof(ngl::Mat4) + sizeof(float));
+  if (m_visibleBuffer != 0 && capacity > m_visibleCapacity)
+  {
+    // same buffer names so m_cullVAO still points at them
+    glBindBuffer(GL_ARRAY_BUFFER, m_visibleBuffer);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(capacity * sizeof(ngl::Mat4)), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, m_visibleLayers);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(capacity * sizeof(float)), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_visibleCapacity = capacity;
+  }
+}
+
+void NGLScene::setInstanceAttributes(GLuint _buffer, GLuint _layers, size_t _first, size_t _firstLayer)
+{
+  // a mat4 attribute takes four vec4 locations
+  glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+  for (GLuint column = 0; column < 4; ++column)
+  {
+    glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(ngl::Mat4),
+                          reinterpret_cast<const void *>(_first * sizeof(ngl::Mat4) + column * 4 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2 + column);
+    glVertexAttribDivisor(2 + column, 1);
+  }
+  // the material layer after them, a base instance offsets it along with the matrix
+  glBindBuffer(GL_ARRAY_BUFFER, _layers);
+  glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(float), reinterpret_cast<const void *>(_firstLayer * sizeof(float)));
+  glEnableVertexAttribArray(6);
+  glVertexAttribDivisor(6, 1);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void NGLScene::createCulling()
+{
+  // the CPU grid path starts each range with a base instance where it can, mac OSX has to move the attributes
+  m_baseInstance = GLInfo::hasVersion(4, 2);
+  // compute shaders and indirect draws are GL 4.3, mac OSX stops at 4.1
+  m_canCull = GLInfo::hasVersion(4, 3);
+  if (!m_canCull)
+  {
+    std::cerr << "GL 4.3 is not available, GPU culling is disabled\n";
+    return;
+  }
+  ngl::ShaderLib::createShaderProgram("CullShader");
+  ngl::ShaderLib::attachShader("CullCompute", ngl::ShaderType::COMPUTE);
+  Assets::loadShaderSource("CullCompute", "shaders/CullComp.glsl");
+  ngl::ShaderLib::compileShader("CullCompute");
+  ngl::ShaderLib::attachShaderToProgram("CullShader", "CullCompute");
+  ngl::ShaderLib::linkProgramObject("CullShader");
+
+  // sized by resizeCullBuffers once the field is built
+  glGenBuffers(1, &m_visibleBuffer);
+  glGenBuffers(1, &m_visibleLayers);
+  // DrawElementsIndirectCommand for the whole cube, the instance count is written by the cull pass
+  const GLuint command[5] = {GLuint(m_cube.numIndices), 0, 0, 0, 0};
+  glGenBuffers(1, &m_commandBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glGenBuffers(GLsizei(m_countBuffers.size()), m_countBuffers.data());
+  for (auto buffer : m_countBuffers)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  m_cullVAO = createInstanceVAO(m_visibleBuffer, m_visibleLayers);
+}
+
+void NGLScene::createOcclusion()
+{
+  // the stream is sized by resizeCullBuffers, the VAO is pointed at the region drawn each frame
+  m_occludedVAO = createInstanceVAO(0, 0);
+}
+
+GLuint NGLScene::createInstanceVAO(GLuint _instances, GLuint _layers)
+{
+  // same cube, a different instance buffer
+  GLuint vao;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  m_cube.attach();
+  if (_instances != 0)
+  {
+    setInstanceAttributes(_instances, _layers);
+  }
+  glBindVertexArray(0);
+  return vao;
+}
+
+size_t NGLScene::drawPerCube()
+{
+  ngl::ShaderLib::use("TextureShader");
+  // every matrix rebuilt from its Euler angles, queued so they all go up in one buffer write, each draw then
+  // only moves the ObjectData binding to its slot
+  m_uniforms.beginFrame(m_view, m_project);
+  for (size_t i = 0; i < std::min(m_field.size(), PER_CUBE_LIMIT); ++i)
+  {
+    m_uniforms.addObject(m_mouseGlobalTX * cubeMatrix(i));
+  }
+  m_uniforms.upload();
+  for (size_t i = 0; i < m_uniforms.numObjects(); ++i)
+  {
+    m_uniforms.bindObject(i);
+    glDrawElements(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr); // draw object
+  }
+  return m_uniforms.numObjects();
+}
+
+size_t NGLScene::drawInstanced()
+{
+  ngl::ShaderLib::use(instanceShader());
+  // the mouse transform applies to the whole field so it is folded into the view, the GPU applies it once per
+  // vertex instead of the CPU once per cube
+  m_uniforms.beginFrame(m_view * m_mouseGlobalTX, m_project);
+  m_uniforms.upload();
+  updateInstances();
+  // one draw per chunk of the cache, 153 for 10M cubes
+  for (size_t chunk = 0; chunk < m_instances.numChunks(); ++chunk)
+  {
+    setInstanceAttributes(m_instances.buffer(chunk), m_layerBuffers[chunk]);
+    glDrawElementsInstanced(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr, GLsizei(m_instances.chunkCount(chunk)));
+  }
+  return m_instances.size();
+}
+
+size_t NGLScene::drawGridCulled()
+{
+  ngl::ShaderLib::use(instanceShader());
+  ngl::Mat4 view = m_view * m_mouseGlobalTX;
+  m_uniforms.beginFrame(view, m_project);
+  m_uniforms.upload();
+  updateInstances();
+  // as with the compute path the frustum is in model space, the grid is never rebuilt
+  auto start = std::chrono::steady_clock::now();
+  m_cullGrid.cull(Frustum(m_project * view), m_cullRanges);
+  m_cullTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  size_t drawn = 0;
+  size_t boundChunk = m_instances.numChunks();
+  for (const auto &range : m_cullRanges)
+  {
+    // a range crossing a chunk boundary is drawn in two pieces, each from its own chunk's buffer
+    size_t first = range.first;
+    size_t end = size_t(range.first) + range.count;
+    while (first < end)
+    {
+      size_t chunk = first / InstanceTransformCache::CHUNK_SIZE;
+      size_t local = first % InstanceTransformCache::CHUNK_SIZE;
+      size_t count = std::min(end, (chunk + 1) * InstanceTransformCache::CHUNK_SIZE) - first;
+      if (m_baseInstance)
+      {
+        if (chunk != boundChunk)
+        {
+          setInstanceAttributes(m_instances.buffer(chunk), m_layerBuffers[chunk]);
+          boundChunk = chunk;
+        }
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr, GLsizei(count),
+                                            GLuint(local));
+      }
+      else
       {
-        m_transform.setRotation(x * 20.0f, (x * z) * 40.0f, z * 2.0f);
-        m_transform.setPosition(x, 0.49f, z);
-        loadMatricesToShader();
-        ++instances;
-        glDrawArrays(GL_TRIANGLES, 0, 36); // draw object
+        setInstanceAttributes(m_instances.buffer(chunk), m_layerBuffers[chunk], local, local);
+        glDrawElementsInstanced(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr, GLsizei(count));
       }
+      first += count;
     }
+    drawn += range.count;
   }
-  // calculate and draw FPS
-  ++m_frames;
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  m_text->setColour(1.0f, 1.0f, 0.0f);
-  m_text->renderText(10, 700, fmt::format("Texture and Vertex Array Object {} instances Demo {} fps", instances, m_fps));
+  return drawn;
+}
+
+size_t NGLScene::drawOccluded()
+{
+  ngl::ShaderLib::use(instanceShader());
+  ngl::Mat4 view = m_view * m_mouseGlobalTX;
+  ngl::Mat4 viewProject = m_project * view;
+  m_uniforms.beginFrame(view, m_project);
+  m_uniforms.upload();
+  updateInstances();
+  auto start = std::chrono::steady_clock::now();
+  Frustum frustum(viewProject);
+  m_cullGrid.cull(frustum, m_cullRanges);
+  // the grid keeps whole cells, each cube in them is tested on its own so the nearest are really on screen
+  m_candidates.clear();
+  for (const auto &range : m_cullRanges)
+  {
+    for (uint32_t slot = range.first; slot < range.first + range.count; ++slot)
+    {
+      if (frustum.sphereVisible(ngl::Vec3(m_field.px[slot], m_field.py[slot], m_field.pz[slot]), CUBE_RADIUS))
+      {
+        m_candidates.push_back(slot);
+      }
+    }
+  }
+  auto culled = std::chrono::steady_clock::now();
+  m_cullTime = std::chrono::duration<double, std::milli>(culled - start).count();
+
+  // the occluders are the visible cubes nearest the eye
+  auto viewZ = [&](uint32_t _slot)
+  {
+    return view.m_m[0][2] * m_field.px[_slot] + view.m_m[1][2] * m_field.py[_slot] + view.m_m[2][2] * m_field.pz[_slot];
+  };
+  m_numOccluders = std::min(OCCLUDERS, m_candidates.size());
+  std::nth_element(m_candidates.begin(), m_candidates.begin() + m_numOccluders, m_candidates.end(),
+                   [&](uint32_t _a, uint32_t _b) { return viewZ(_a) > viewZ(_b); });
+  m_occlusion.clear();
+  for (size_t i = 0; i < m_numOccluders; ++i)
+  {
+    m_occlusion.rasterizeBox(viewProject * m_instances.matrix(m_candidates[i]), ngl::Vec3(-0.2f, -0.2f, -0.2f),
+                             ngl::Vec3(0.2f, 0.2f, 0.2f));
+  }
+  m_occlusion.buildHiZ();
+
+  // every candidate, occluders included, is tested with the box around its bounding sphere. The survivors go
+  // straight into this frame's region of the stream, the GPU may still be drawing the previous two. A region
+  // holds at most MAX_VISIBLE, any more are counted and left out. Their layers follow the matrices in the region
+  auto *visible = static_cast<ngl::Mat4 *>(m_occludedStream.beginWrite());
+  auto *layers = visible != nullptr ? reinterpret_cast<float *>(visible + m_streamCapacity) : nullptr;
+  size_t drawn = 0;
+  m_streamOverflow = 0;
+  for (uint32_t slot : m_candidates)
+  {
+    ngl::Vec3 centre(m_field.px[slot], m_field.py[slot], m_field.pz[slot]);
+    ngl::Vec3 extent(CUBE_RADIUS, CUBE_RADIUS, CUBE_RADIUS);
+    if (visible != nullptr && !m_occlusion.boxOccluded(viewProject, centre - extent, centre + extent))
+    {
+      if (drawn < m_streamCapacity)
+      {
+        layers[drawn] = m_fieldLayer[slot];
+        visible[drawn++] = m_instances.matrix(slot);
+      }
+      else
+      {
+        ++m_streamOverflow;
+      }
+    }
+  }
+  m_occludedStream.endWrite();
+  m_occludedCount = visible != nullptr ? m_candidates.size() - drawn - m_streamOverflow : 0;
+  m_occlusionTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - culled).count();
+
+  glBindVertexArray(m_occludedVAO);
+  setInstanceAttributes(m_occludedStream.buffer(), m_occludedStream.buffer(), m_occludedStream.offset() / sizeof(ngl::Mat4),
+                        (m_occludedStream.offset() + m_streamCapacity * sizeof(ngl::Mat4)) / sizeof(float));
+  glDrawElementsInstanced(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr, GLsizei(drawn));
+  glBindVertexArray(m_vaoID);
+  m_occludedStream.fence();
+  return drawn;
+}
+
+void NGLScene::updateInstances()
+{
+  if (m_wave)
+  {
+    // the lifted row moves on, only it and the row it left change
+    liftRow(m_waveRow, false);
+    m_waveRow = (m_waveRow + 1) % m_fieldSize;
+    liftRow(m_waveRow, true);
+  }
+  m_lastRecomputed = m_instances.update();
+  m_lastUploadBytes = m_instances.upload();
+}
+
+size_t NGLScene::drawCulled()
+{
+  // same camera as the instanced path, the frustum is taken in model space so the cull works on the cached
+  // matrices as they are
+  ngl::Mat4 view = m_view * m_mouseGlobalTX;
+  m_uniforms.beginFrame(view, m_project);
+  m_uniforms.upload();
+  updateInstances();
+  readVisibleCount();
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+  const GLuint zero = 0;
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, sizeof(GLuint), sizeof(GLuint), &zero);
+  ngl::ShaderLib::use("CullShader");
+  GLuint program = ngl::ShaderLib::getProgramID("CullShader");
+  Frustum frustum(m_project * view);
+  glUniform4fv(glGetUniformLocation(program, "planes"), 6, frustum.data());
+  glUniform1f(glGetUniformLocation(program, "radius"), CUBE_RADIUS);
+  glUniform1ui(glGetUniformLocation(program, "capacity"), GLuint(m_visibleCapacity));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_visibleBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_commandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_visibleLayers);
+  GLint numInstances = glGetUniformLocation(program, "numInstances");
+  // a dispatch per chunk all appending to the one visible buffer and count
+  for (size_t chunk = 0; chunk < m_instances.numChunks(); ++chunk)
+  {
+    GLuint count = GLuint(m_instances.chunkCount(chunk));
+    glUniform1ui(numInstances, count);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instances.buffer(chunk));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_layerBuffers[chunk]);
+    glDispatchCompute((count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    if (chunk + 1 < m_instances.numChunks())
+    {
+      // the next dispatch carries on from the count this one left
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+  }
+  // the draw reads the command and the visible matrices and layers the dispatch wrote, the copy below reads the count
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  ngl::ShaderLib::use(instanceShader());
+  glBindVertexArray(m_cullVAO);
+  glMultiDrawElementsIndirect(GL_TRIANGLES, m_cube.indexType, nullptr, 1, 0);
+  glBindVertexArray(m_vaoID);
+
+  // copy the count out now, it is read a few frames later once the fence has passed
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_countBuffers[m_countFrame]);
+  glCopyBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_COPY_WRITE_BUFFER, sizeof(GLuint), 0, sizeof(GLuint));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  m_countFences[m_countFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_countFrame = (m_countFrame + 1) % m_countBuffers.size();
+  return m_visibleCount;
+}
+
+void NGLScene::recordScaleFrame()
+{
+  ++m_scaleFrame;
+  auto now = std::chrono::steady_clock::now();
+  // the first frames of a step upload the field and fill the rings, they aren't timed
+  if (m_scaleFrame <= SCALE_WARMUP)
+  {
+    if (m_scaleFrame == SCALE_WARMUP)
+    {
+      m_profiler.reset();
+      m_scaleStart = now;
+    }
+    return;
+  }
+  size_t frames = m_scaleFrame - SCALE_WARMUP;
+  double seconds = std::chrono::duration<double>(now - m_scaleStart).count();
+  if (frames < SCALE_FRAMES && seconds < SCALE_SECONDS)
+  {
+    return;
+  }
+  // the field pass only, averaged over every frame since the reset rather than the overlay's window
+  size_t field = m_profiler.passIndex("field");
+  ScaleResult result{m_instances.size(), m_drawMode, double(frames) / seconds, m_profiler.passCpuTime(field).mean(),
+                     m_profiler.passGpuTime(field).mean(), modeBytes(m_drawMode)};
+  m_scaleResults.push_back(result);
+  std::cout << fmt::format("{:>10} {:<12} {:>9.1f} fps {:>9.3f} CPU ms {:>9.3f} GPU ms {:>9.1f} MB\n", result.instances,
+                           SCALE_MODE_NAMES[size_t(result.mode)], result.fps, result.cpuTime, result.gpuTime,
+                           result.bytes / 1048576.0);
+
+  // the next mode for this count, then the next count from the first mode it can use
+  m_scaleFrame = 0;
+  size_t mode = nextScaleMode(size_t(m_drawMode) + 1);
+  if (mode == NUM_DRAW_MODES)
+  {
+    if (++m_scaleCount == m_scaleCounts.size())
+    {
+      writeScaleReport();
+      m_settings.scale = false;
+      QGuiApplication::exit(EXIT_SUCCESS);
+      return;
+    }
+    m_fieldSize = FieldSettings::sideFor(m_scaleCounts[m_scaleCount]);
+    createInstances();
+    mode = nextScaleMode(0);
+  }
+  m_drawMode = DrawMode(mode);
+}
+
+size_t NGLScene::nextScaleMode(size_t _mode) const
+{
+  for (; _mode < NUM_DRAW_MODES; ++_mode)
+  {
+    // the per cube path would only draw part of a big field, so its timing says nothing
+    if (DrawMode(_mode) == DrawMode::PerCube && m_field.size() > PER_CUBE_LIMIT)
+    {
+      continue;
+    }
+    if (modeAvailable(DrawMode(_mode)))
+    {
+      return _mode;
+    }
+  }
+  return NUM_DRAW_MODES;
+}
+
+void NGLScene::writeScaleReport() const
+{
+  std::cout << fmt::format("\n{:>10}", "instances");
+  for (const char *name : SCALE_MODE_NAMES)
+  {
+    std::cout << fmt::format(" {:>16}", name);
+  }
+  std::cout << "\n";
+  // one row per count, fps / CPU ms / GPU ms in each mode's column, - where a mode was skipped
+  size_t i = 0;
+  while (i < m_scaleResults.size())
+  {
+    size_t instances = m_scaleResults[i].instances;
+    std::array<std::string, NUM_DRAW_MODES> cells;
+    cells.fill("-");
+    for (; i < m_scaleResults.size() && m_scaleResults[i].instances == instances; ++i)
+    {
+      const auto &result = m_scaleResults[i];
+      cells[size_t(result.mode)] = fmt::format("{:.0f}/{:.1f}/{:.1f}", result.fps, result.cpuTime, result.gpuTime);
+    }
+    std::cout << fmt::format("{:>10}", instances);
+    for (const auto &cell : cells)
+    {
+      std::cout << fmt::format(" {:>16}", cell);
+    }
+    std::cout << "\n";
+  }
+  std::cout << "(fps/CPU ms/GPU ms)\n";
+  if (m_settings.reportFile.empty())
+  {
+    return;
+  }
+  std::ofstream file(m_settings.reportFile);
+  if (!file)
+  {
+    std::cerr << "could not write the scaling report to " << m_settings.reportFile << "\n";
+    return;
+  }
+  file << "instances,mode,fps,cpu_ms,gpu_ms,gpu_bytes\n";
+  for (const auto &result : m_scaleResults)
+  {
+    file << fmt::format("{},{},{:.2f},{:.4f},{:.4f},{}\n", result.instances, SCALE_MODE_NAMES[size_t(result.mode)], result.fps,
+                        result.cpuTime, result.gpuTime, result.bytes);
+  }
+  std::cout << "scaling report written to " << m_settings.reportFile << "\n";
+}
+
+size_t NGLScene::drawBaked()
+{
+  // the wave and --animate still move the field, it is only baked again when they have
+  updateInstances();
+  if (m_instances.size() > MAX_BAKED)
+  {
+    return 0;
+  }
+  if (m_bakeStale || m_lastRecomputed != 0)
+  {
+    auto start = std::chrono::steady_clock::now();
+    m_baked.bake(*m_cubeSource, m_instances.size(), [this](size_t _index) -> const ngl::Mat4 &
+    {
+      return m_instances.matrix(_index);
+    }, m_bakeChunked ? 0 : m_instances.size());
+    m_bakeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_bakeStale = false;
+  }
+  // the vertices are already in model space, the one object matrix is the mouse transform
+  ngl::ShaderLib::use("TextureShader");
+  m_uniforms.beginFrame(m_view, m_project);
+  m_uniforms.addObject(m_mouseGlobalTX);
+  m_uniforms.upload();
+  m_uniforms.bindObject(0);
+  // the field is in cell order so each chunk covers a compact patch and is culled on its bounds
+  Frustum frustum(m_project * m_view * m_mouseGlobalTX);
+  size_t drawn = m_baked.draw(m_bakeChunked ? &frustum : nullptr);
+  glBindVertexArray(m_vaoID);
+  return drawn;
+}
+
+bool NGLScene::usesMaterials() const
+{
+  // the per cube and baked paths have no per instance data to carry a layer
+  return m_useMaterials && m_drawMode != DrawMode::PerCube && m_drawMode != DrawMode::Baked;
+}
+
+const char *NGLScene::instanceShader() const
+{
+  return m_useMaterials ? "MaterialShader" : "InstanceShader";
+}
+
+bool NGLScene::modeAvailable(DrawMode _mode) const
+{
+  if (_mode == DrawMode::GPUCulled)
+  {
+    return m_canCull;
+  }
+  if (_mode == DrawMode::Baked)
+  {
+    return m_instances.size() <= MAX_BAKED;
+  }
+  return true;
+}
+
+size_t NGLScene::modeBytes(DrawMode _mode) const
+{
+  // the matrices and the static layer buffers alongside them
+  size_t matrices = m_instances.size() * (sizeof(ngl::Mat4) + sizeof(float));
+  switch (_mode)
+  {
+  case DrawMode::PerCube:
+    // the matrices go through the FrameUniforms ring, there is no per instance buffer
+    return 0;
+  case DrawMode::Instanced:
+  case DrawMode::CPUCulled:
+    return matrices;
+  case DrawMode::Occluded:
+    return matrices + m_occludedStream.regionSize() * PersistentBuffer::FRAMES;
+  case DrawMode::GPUCulled:
+    return matrices + m_visibleCapacity * (sizeof(ngl::Mat4) + sizeof(float));
+  case DrawMode::Baked:
+    return m_baked.vertexBytes() + m_baked.indexBytes();
+  }
+  return 0;
+}
+
+void NGLScene::readVisibleCount()
+{
+  // the slot this frame is about to reuse, written FRAMES frames ago
+  GLsync &fence = m_countFences[m_countFrame];
+  if (fence == nullptr)
+  {
+    return;
+  }
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+  {
+    GLuint count = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, m_countBuffers[m_countFrame]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_visibleCount = count;
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -356,6 +1176,35 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N:
     showNormal();
     break;
+  // cycle uncompressed / BC1 / BC7 textures
+  case Qt::Key_C:
+    m_textureMode = (m_textureMode + 1) % m_textureBytes.size();
+    break;
+  // one draw per cube / instanced / CPU culled / CPU occlusion culled / GPU culled / baked
+  case Qt::Key_I:
+    do
+    {
+      m_drawMode = DrawMode((size_t(m_drawMode) + 1) % NUM_DRAW_MODES);
+    } while (!modeAvailable(m_drawMode));
+    break;
+  // the crate on its own or the material array on the instanced paths
+  case Qt::Key_M:
+    m_useMaterials = !m_useMaterials;
+    break;
+  // baked field in spatial chunks or one chunk
+  case Qt::Key_B:
+    m_bakeChunked = !m_bakeChunked;
+    m_bakeStale = true;
+    break;
+  // move a lifted row through the field
+  case Qt::Key_A:
+    m_wave = !m_wave;
+    liftRow(m_waveRow, m_wave);
+    break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("CubeProfile.csv");
+    break;
   default:
     break;
   }
@@ -366,15 +1215,9 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
 
 void NGLScene::timerEvent(QTimerEvent *_event)
 {
-  // if(_event->timerId() == m_fpsTimer)
-  // 	{
-  // 		if( m_timer.elapsed() > 1000.0)
-  // 		{
-  // 			m_fps=m_frames;
-  // 			m_frames=0;
-  // 			m_timer.restart();
-  // 		}
-  // 	 }
-  // re-draw GL
-  update();
+  if (_event->timerId() == m_redrawTimer)
+  {
+    // re-draw GL
+    update();
+  }
 }
@@ -2,14 +2,70 @@
 basic OpenGL demo modified from http://qt-project.org/doc/qt-5.0/qtgui/openglwindow.html
 ****************************************************************************/
 #include <QtGui/QGuiApplication>
+#include <QCommandLineParser>
 #include <iostream>
 #include "NGLScene.h"
 
+namespace
+{
+  // a positive whole number option, anything else keeps _default
+  size_t countOption(const QCommandLineParser &_parser, const QString &_name, size_t _default)
+  {
+    if (!_parser.isSet(_name))
+    {
+      return _default;
+    }
+    bool ok = false;
+    int value = _parser.value(_name).toInt(&ok);
+    if (!ok || value <= 0)
+    {
+      std::cerr << "--" << _name.toStdString() << " needs a positive whole number, using " << _default << "\n";
+      return _default;
+    }
+    return size_t(value);
+  }
+} // end anon namespace
+
 
 
 int main(int argc, char **argv)
 {
   QGuiApplication app(argc, argv);
+  // the field size and stress test options, e.g. Cube --count 1000000 --animate or Cube --scale --report scale.csv
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Textured cube field drawn per cube, instanced, CPU / occlusion / GPU culled");
+  parser.addHelpOption();
+  parser.addOption(QCommandLineOption("size", "Cubes along each side of the field (default 138).", "cubes"));
+  parser.addOption(QCommandLineOption("count", "Total cubes, rounded up to a square field. Overrides --size.", "cubes"));
+  parser.addOption(QCommandLineOption("spacing", "Distance between cubes (default 0.5).", "units"));
+  parser.addOption(QCommandLineOption("animate", "Spin every cube each frame so every matrix is rebuilt and uploaded."));
+  parser.addOption(QCommandLineOption("scale", "Time each draw mode at 10k to --max-count cubes, print the table and quit."));
+  parser.addOption(QCommandLineOption("max-count", "Largest count --scale goes up to (default 10000000).", "cubes"));
+  parser.addOption(QCommandLineOption("report", "Also write the --scale results to this CSV file.", "file"));
+  parser.process(app);
+  FieldSettings settings;
+  settings.size = countOption(parser, "size", settings.size);
+  if (parser.isSet("count"))
+  {
+    settings.size = FieldSettings::sideFor(countOption(parser, "count", settings.size * settings.size));
+  }
+  if (parser.isSet("spacing"))
+  {
+    bool ok = false;
+    float spacing = parser.value("spacing").toFloat(&ok);
+    if (ok && spacing > 0.0f)
+    {
+      settings.spacing = spacing;
+    }
+    else
+    {
+      std::cerr << "--spacing needs a positive number, using " << settings.spacing << "\n";
+    }
+  }
+  settings.animate = parser.isSet("animate");
+  settings.scale = parser.isSet("scale");
+  settings.scaleMax = countOption(parser, "max-count", settings.scaleMax);
+  settings.reportFile = parser.value("report").toStdString();
   // create an OpenGL format specifier
   QSurfaceFormat format;
   // set the number of samples for multisampling
@@ -29,9 +85,14 @@ int main(int argc, char **argv)
   format.setProfile(QSurfaceFormat::CoreProfile);
   // now set the depth buffer to 24 bits
   format.setDepthBufferSize(24);
+  // the sweep measures how fast each path can go, not the display refresh
+  if (settings.scale)
+  {
+    format.setSwapInterval(0);
+  }
   QSurfaceFormat::setDefaultFormat(format);
   // now we are going to create our scene window
-  NGLScene window;
+  NGLScene window(settings);
    // we can now query the version to see if it worked
   std::cout<<"Profile is "<<format.majorVersion()<<" "<<format.minorVersion()<<"\n";
   // set the window size
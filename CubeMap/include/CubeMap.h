@@ -1,25 +1,184 @@
 #ifndef CUBEMAP_H_
 #define CUBEMAP_H_
 
+#include <array>
+#include <functional>
 #include <string>
+#include <vector>
 #include <ngl/Image.h>
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include "CubeImage.h"
+#include "PackedHDR.h"
+#include "SphericalHarmonics.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how levels 1 and down are made, GGX prefiltered for roughness or plain seam aware mips
+//----------------------------------------------------------------------------------------------------------------------
+enum class CubeMipFilter
+{
+  GGX,
+  Seamless
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how CubeMap::capture renders the scene, all six faces in one layered pass (a geometry shader routes
+/// each triangle with gl_Layer) or one face per call so the cost is spread over six frames
+//----------------------------------------------------------------------------------------------------------------------
+enum class CaptureMode
+{
+  Layered,
+  Amortized
+};
 
 class CubeMap
 {
 public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load six faces, .hdr faces are stored packed as _hdrFormat (4 bytes per texel) and other
+  /// formats as RGBA8, or with _compress block compressed as BC7 (BC1 without GL 4.2) where the context allows
+  //----------------------------------------------------------------------------------------------------------------------
   CubeMap(const std::string &_right, const std::string &_left,
           const std::string &_bottom, const std::string &_top,
-          const std::string &_front, const std::string &_back);
+          const std::string &_front, const std::string &_back,
+          PackedFormat _hdrFormat = PackedFormat::RGB9E5, bool _compress = false);
+
+  CubeMap(std::string *_names, CubeMipFilter _mips = CubeMipFilter::GGX);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the faces from a 2:1 equirectangular panorama
+  /// @param[in] _faceSize size of each face, 0 picks a quarter of the panorama width
+  //----------------------------------------------------------------------------------------------------------------------
+  CubeMap(const std::string &_equirect, int _faceSize);
 
-  CubeMap(std::string *_names);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief an empty renderable cube map of _size for capture, RGBA8 with a full mip chain
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit CubeMap(int _size);
 
-  ~CubeMap(){  glDeleteTextures(1,&m_id);}
-  void enable(){glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);   glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);}
+  ~CubeMap();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uniform block binding of the six face view projections for a layered capture,
+  /// layout(std140) uniform CaptureData { mat4 faceViewProjection[6]; }
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr GLuint CAPTURE_BINDING = 3;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief camera for face _face at _centre, the faces are oriented for the demo's lookup (vec3(r.x, -r.yz))
+  //----------------------------------------------------------------------------------------------------------------------
+  static ngl::Mat4 faceView(const ngl::Vec3 &_centre, int _face);
+  static ngl::Mat4 faceProjection();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief render the scene around _centre into a map made with CubeMap(int). The target is cleared to
+  /// transparent black, then _draw is called once with face -1 for Layered (CaptureData is bound and the
+  /// draw must go through a layered program) or with the face to refresh for Amortized. Mips are regenerated
+  /// after each capture.
+  //----------------------------------------------------------------------------------------------------------------------
+  void capture(const ngl::Vec3 &_centre, CaptureMode _mode,
+               const std::function<void(int _face, const ngl::Mat4 &_view, const ngl::Mat4 &_project)> &_draw);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GPU time of the last capture whose query has come back, including the mip generation
+  //----------------------------------------------------------------------------------------------------------------------
+  double captureTime() const {return m_captureTime;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uniform block binding point the SH irradiance is bound to by enable
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr GLuint IRRADIANCE_BINDING = 2;
+  void enable(){glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);   glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); if (m_irradianceBuffer != 0) glBindBufferBase(GL_UNIFORM_BUFFER, IRRADIANCE_BINDING, m_irradianceBuffer);}
   void disable(){glBindTexture(GL_TEXTURE_CUBE_MAP, 0);   glDisable(GL_TEXTURE_CUBE_MAP_SEAMLESS);}
   GLuint getTexID(){return m_id;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of mip levels, level n holds the environment filtered for roughness n / (levels-1)
+  //----------------------------------------------------------------------------------------------------------------------
+  int numLevels() const {return m_levels;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief order 2 SH of the environment convolved for lambertian diffuse (linear RGB)
+  //----------------------------------------------------------------------------------------------------------------------
+  const SHCoefficients &irradiance() const {return m_irradiance;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief texture memory for all six faces and levels
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t sizeInBytes() const {return m_bytes;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief name of the format the texels were uploaded as
+  //----------------------------------------------------------------------------------------------------------------------
+  const char *formatName() const {return m_formatName;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the texels are linear HDR (packed), false for gamma encoded 8 bit
+  //----------------------------------------------------------------------------------------------------------------------
+  bool isHDR() const {return m_hdr;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decode six faces (GL face order) in parallel and check they are square and the same size
+  /// @returns false and reports the problem if any face is unusable
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool decodeFaces(const std::array<std::string, 6> &_names, std::array<ngl::Image, 6> &o_faces);
 private :
-  GLuint m_id;
-  void createCubeMap();
+  GLuint m_id = 0;
+  int m_levels = 1;
+  size_t m_bytes = 0;
+  bool m_hdr = false;
+  bool m_compress = false;
+  const char *m_formatName = "RGBA8";
+  CubeMipFilter m_mipFilter = CubeMipFilter::GGX;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief capture targets, a layered framebuffer with a depth cube and a single face one with a depth
+  /// renderbuffer, the six face matrices and the timer query
+  //----------------------------------------------------------------------------------------------------------------------
+  int m_size = 0;
+  GLuint m_layeredFBO = 0;
+  GLuint m_faceFBO = 0;
+  GLuint m_depthCube = 0;
+  GLuint m_depthBuffer = 0;
+  GLuint m_captureBuffer = 0;
+  GLuint m_captureQuery = 0;
+  bool m_captureQueryActive = false;
+  double m_captureTime = 0.0;
+  int m_nextFace = 0;
+  PackedFormat m_hdrFormat = PackedFormat::RGB9E5;
+  SHCoefficients m_irradiance;
+  GLuint m_irradianceBuffer = 0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allocate immutable storage for all six faces and the full mip chain
+  //----------------------------------------------------------------------------------------------------------------------
+  void createCubeMap(GLsizei _size, GLsizei _levels, GLenum _internalFormat = GL_RGBA8);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decode the faces then build the texture, names are in GL face order +X -X +Y -Y +Z -Z
+  //----------------------------------------------------------------------------------------------------------------------
+  void loadFaces(const std::array<std::string, 6> &_names);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load six Radiance .hdr faces, prefilter them in float and store every level packed as m_hdrFormat
+  //----------------------------------------------------------------------------------------------------------------------
+  void loadHDRFaces(const std::array<std::string, 6> &_names);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GGX prefilter all levels of _linear and pack them, or fetch them from the TextureCache keyed on
+  /// the float faces and format
+  /// @returns packed texels for each level in turn, six faces per level
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint32_t> prefilterPacked(const CubeImage &_linear, int _levels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the texture from validated faces, _pixels are the 8 bit texels uploaded as level 0 and
+  /// _linear the same faces in linear float for the filtering
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(const std::array<const unsigned char *, 6> &_pixels, int _size, int _channels, const CubeImage &_linear);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the texture block compressed from level 0 _pixels and the RGBA8 _chain of the other levels,
+  /// the blocks are fetched from the TextureCache if these texels have been compressed before
+  /// @returns false without creating anything if the context has no block compressed format to use
+  //----------------------------------------------------------------------------------------------------------------------
+  bool buildCompressed(const std::array<const unsigned char *, 6> &_pixels, int _size, int _channels,
+                       const std::vector<unsigned char> &_chain, int _levels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GGX prefilter levels 1 to _levels-1 of the faces on the CPU, or fetch them from the TextureCache
+  /// keyed on the original 8 bit _pixels
+  /// @returns RGBA8 texels for each level in turn, six faces per level
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<unsigned char> prefilter(const std::array<const unsigned char *, 6> &_pixels, const CubeImage &_linear, int _channels, int _levels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief levels 1 to _levels-1 filtered across the face edges by CubeMipBuilder, same layout as prefilter
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<unsigned char> seamlessMips(const CubeImage &_linear, int _levels);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief project the environment to SH irradiance and upload it to a uniform buffer
+  //----------------------------------------------------------------------------------------------------------------------
+  void createIrradiance(const CubeImage &_linear);
 };
 
 
@@ -7,7 +7,12 @@
 #include <QTime>
 #include <QOpenGLWindow>
 #include "CubeMap.h"
+#include "FrameProfiler.h"
+#include "FrameUniforms.h"
+#include "OctahedralMap.h"
+#include <array>
 #include <memory>
+#include <string>
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @file NGLScene.h
@@ -27,9 +32,9 @@ class NGLScene : public QOpenGLWindow
   public:
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief ctor for our NGL drawing class
-    /// @param [in] parent the parent window to the class
+    /// @param [in] _hdrDirectory optional directory of right/left/top/bottom/front/back.hdr faces
     //----------------------------------------------------------------------------------------------------------------------
-    NGLScene();
+    NGLScene(const std::string &_hdrDirectory = std::string());
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief dtor must close down ngl and release OpenGL resources
     //----------------------------------------------------------------------------------------------------------------------
@@ -47,6 +52,10 @@ class NGLScene : public QOpenGLWindow
     /// @brief this is called everytime we resize
     //----------------------------------------------------------------------------------------------------------------------
     void resizeGL(int _w, int _h);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief animates the orbiting objects while the dynamic reflection is on
+    //----------------------------------------------------------------------------------------------------------------------
+    void timerEvent(QTimerEvent *) override;
 
 private:
     //----------------------------------------------------------------------------------------------------------------------
@@ -103,10 +112,14 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Vec3 m_modelPos;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to load transform matrices to the shader
+    /// @brief queue the sky cube and object matrices and upload them to m_uniforms
     //----------------------------------------------------------------------------------------------------------------------
     void loadMatricesToShader();
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief camera and object matrices as uniform buffers rather than named uniforms
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameUniforms m_uniforms;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
     //----------------------------------------------------------------------------------------------------------------------
@@ -149,11 +162,87 @@ private:
     std::unique_ptr <CubeMap> m_cubeMap;
     std::unique_ptr <CubeMap> m_cubeMapDebug;
     bool m_debug;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief roughness of the reflective object, 0 is a mirror
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_roughness = 0.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief light the object with the SH irradiance rather than reflecting the environment
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_diffuse = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the octahedral versions of the environments and which one is in use
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr <OctahedralMap> m_octMap;
+    std::unique_ptr <OctahedralMap> m_octMapDebug;
+    bool m_octahedral = false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frame, CPU and GPU times with the "environment" pass around the skybox and object draws and the
+    /// "overlay" pass for the text. The dynamic capture times itself so stays outside the passes. P records them to
+    /// CubeMapProfile.csv
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameProfiler m_profiler;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief environment pass GPU time and results when the current sky mode started, for the per mode average
+    //----------------------------------------------------------------------------------------------------------------------
+    double m_envTimeStart = 0.0;
+    size_t m_envTimedStart = 0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief GL_SAMPLES_PASSED over the same draws to show the overdraw, m_samples is the MSAA sample count
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_samplesQuery = 0;
+    bool m_samplesQueryActive = false;
+    double m_envSamples = 0.0;
+    int m_envFrames = 0;
+    GLint m_samples = 1;
+    double m_lastShadedPerPixel = 0.0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the sky as one triangle after the object (true) or as the old cube before it
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_fullscreenSky = true;
+    GLuint m_skyTriangleVAO = 0;
+    void drawCubeSkyBox();
+    void drawFullscreenSkyBox();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per frame uniforms the environment fragment shader needs, set on each program using it
+    //----------------------------------------------------------------------------------------------------------------------
+    void setEnvironmentUniforms(const std::string &_program, CubeMap *_cubeMap, bool _octahedral);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief live reflection of the objects orbiting the reflective one, m_captureMode 0 is off, 1 the layered
+    /// capture and 2 one face per frame
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr <CubeMap> m_dynamicMap;
+    FrameUniforms m_captureUniforms;
+    int m_captureMode = 0;
+    float m_time = 0.0f;
+    void captureDynamicMap();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief queue the orbiting objects in _uniforms and draw them with the current program, the
+    /// colours are set per object
+    //----------------------------------------------------------------------------------------------------------------------
+    void queueSatellites(FrameUniforms &_uniforms);
+    void drawSatellites(FrameUniforms &_uniforms, size_t _firstSlot);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief our font / text
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<ngl::Text> m_text;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the HDR faces packed as RGB9E5 and R11G11B10F, m_hdrMode 0 is the LDR map, 1 and 2 these. A map that
+    /// failed to load is left null and skipped
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string m_hdrDirectory;
+    std::array<std::unique_ptr <CubeMap>, 2> m_hdrMaps;
+    int m_hdrMode = 0;
+    float m_exposure = 1.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the cube map for the current debug / HDR mode
+    //----------------------------------------------------------------------------------------------------------------------
+    CubeMap *activeCubeMap();
+    void reportEnvironmentCost();
     void nextPrim();
     void previousPrim();
     void createSkyBox();
     std::unique_ptr <ngl::AbstractVAO> m_skybox;
-    ngl::Transformation m_transform;
 };
 
 
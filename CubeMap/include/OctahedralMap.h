@@ -0,0 +1,42 @@
+#ifndef OCTAHEDRALMAP_H_
+#define OCTAHEDRALMAP_H_
+
+#include <array>
+#include <string>
+#include <ngl/Types.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file OctahedralMap.h
+/// @brief an environment stored in a single 2D texture using the octahedral mapping, a drop in alternative
+/// to CubeMap with the same enable / disable interface. One texture of 2N x 2N for N x N faces is 2/3 of the
+/// memory of the six faces and needs no cube map binding, the price is a few ALU ops in the shader to turn the
+/// direction into a uv (see octEncode in TextureFrag.glsl). The mips are built on the CPU with a tent filter
+/// that wraps across the octahedral folds so the low levels have no seams.
+//----------------------------------------------------------------------------------------------------------------------
+class OctahedralMap
+{
+public :
+  OctahedralMap(const std::string &_right, const std::string &_left,
+                const std::string &_bottom, const std::string &_top,
+                const std::string &_front, const std::string &_back);
+  ~OctahedralMap(){  glDeleteTextures(1,&m_id);}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the map is bound to its own unit so it can sit alongside the samplerCube on unit 0
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr GLuint TEXTURE_UNIT = 1;
+  void enable(){glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT); glBindTexture(GL_TEXTURE_2D, m_id); glActiveTexture(GL_TEXTURE0);}
+  void disable(){glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT); glBindTexture(GL_TEXTURE_2D, 0); glActiveTexture(GL_TEXTURE0);}
+  GLuint getTexID(){return m_id;}
+  int numLevels() const {return m_levels;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief texture memory for all the levels
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t sizeInBytes() const {return m_bytes;}
+private :
+  GLuint m_id = 0;
+  int m_levels = 1;
+  size_t m_bytes = 0;
+};
+
+
+#endif
@@ -0,0 +1,41 @@
+#version 330 core
+// renders each triangle into every cube face it touches in one pass, gl_Layer picks the face
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 18) out;
+// view projection of each face (CubeMap::capture, binding 3)
+layout(std140) uniform CaptureData
+{
+  mat4 faceViewProjection[6];
+};
+in VertexData
+{
+  vec3 worldNormal;
+} vertexIn[];
+out vec3 worldNormal;
+
+void main()
+{
+	for (int face = 0; face < 6; ++face)
+	{
+		vec4 clip[3];
+		// skip the face if the whole triangle is outside one of its frustum planes
+		vec3 below = vec3(1.0);
+		vec3 above = vec3(1.0);
+		for (int i = 0; i < 3; ++i)
+		{
+			clip[i] = faceViewProjection[face] * gl_in[i].gl_Position;
+			below *= step(clip[i].xyz, -clip[i].www);
+			above *= step(clip[i].www, clip[i].xyz);
+		}
+		if (max(max(below.x, below.y), below.z) > 0.0 || max(max(above.x, above.y), above.z) > 0.0)
+			continue;
+		for (int i = 0; i < 3; ++i)
+		{
+			gl_Layer = face;
+			worldNormal = vertexIn[i].worldNormal;
+			gl_Position = clip[i];
+			EmitVertex();
+		}
+		EndPrimitive();
+	}
+}
@@ -0,0 +1,21 @@
+#version 330 core
+// layered capture, positions stay in world space and CaptureGeom.glsl projects them once per face
+// per object matrices from the FrameUniforms ring buffer (binding 1)
+layout(std140) uniform ObjectData
+{
+  mat4 model;
+  mat4 MVP;
+  mat3 normalMatrix;
+};
+layout (location = 0) in vec3 inVert;
+layout (location = 1) in vec3 inNormal;
+out VertexData
+{
+  vec3 worldNormal;
+} vertexOut;
+
+void main()
+{
+	gl_Position = model * vec4(inVert, 1.0);
+	vertexOut.worldNormal = mat3(model) * inNormal;
+}
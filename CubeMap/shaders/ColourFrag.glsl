@@ -0,0 +1,11 @@
+#version 330 core
+uniform vec4 colour;
+in vec3 worldNormal;
+layout (location = 0) out vec4 outColour;
+
+void main()
+{
+	// one key light plus ambient, alpha 1 marks the texel as covered in a capture
+	float diffuse = max(dot(normalize(worldNormal), normalize(vec3(0.5, 1.0, 0.3))), 0.0);
+	outColour = vec4(colour.rgb * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+// flat coloured objects moving around the reflective one, drawn in the main view and captured by the
+// dynamic cube map
+// per object matrices from the FrameUniforms ring buffer (binding 1)
+layout(std140) uniform ObjectData
+{
+  mat4 model;
+  mat4 MVP;
+  mat3 normalMatrix;
+};
+layout (location = 0) in vec3 inVert;
+layout (location = 1) in vec3 inNormal;
+out vec3 worldNormal;
+
+void main()
+{
+	gl_Position = MVP * vec4(inVert, 1.0);
+	worldNormal = mat3(model) * inNormal;
+}
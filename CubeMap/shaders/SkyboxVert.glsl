@@ -0,0 +1,26 @@
+#version 330 core
+// fullscreen triangle skybox, no vertex buffer just gl_VertexID 0-2
+// camera matrices from the FrameUniforms ring buffer (binding 0)
+layout(std140) uniform FrameData
+{
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec4 eye;
+};
+out vec3 vertUV;
+out vec3 diffuseDir;
+
+void main()
+{
+	// (-1,-1) (3,-1) (-1,3) covers the screen
+	vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	// z = w puts the sky exactly on the far plane so LEQUAL only passes where nothing was drawn
+	gl_Position = vec4(p, 1.0, 1.0);
+	// inverse of projection * view without the translation, so a far plane point is a direction
+	mat4 invViewProj = inverse(projection * mat4(mat3(view)));
+	vec4 world = invViewProj * vec4(p, 1.0, 1.0);
+	// w is the same at all three vertices so the divided direction still interpolates linearly
+	vertUV = world.xyz / world.w;
+	diffuseDir = vec3(0.0);
+}
@@ -1,12 +1,99 @@
 #version 330 core
 // this is a pointer to the current 2D texture object
 uniform samplerCube cubeMap;
+// the same environment as a single octahedral 2D texture (OctahedralMap), bound to unit 1
+uniform sampler2D octMap;
+uniform int octahedral;
+// reflections read the prefiltered mip for the surface roughness, level n is roughness n/maxLod
+uniform int reflectOn;
+uniform float roughness;
+uniform float maxLod;
+// diffuse lighting from the order 2 SH of the environment (already convolved with the cosine lobe)
+uniform int diffuseOn;
+layout(std140) uniform SHIrradiance
+{
+  vec4 sh[9];
+};
+// HDR environments are linear, exposed and tone mapped here, LDR faces are already gamma encoded
+uniform int hdr;
+uniform float exposure;
+// live capture of the objects around the reflective one (CubeMap::capture), premultiplied with alpha 0
+// where only the environment is visible
+uniform samplerCube dynamicMap;
+uniform int dynamicOn;
+uniform float dynamicMaxLod;
+in vec3 diffuseDir;
 // the vertex UV
 in vec3 vertUV;
 // the final fragment colour
 layout (location =0) out vec4 outColour;
+vec3 shIrradiance(vec3 n)
+{
+  return sh[0].rgb * 0.282095
+       + sh[1].rgb * 0.488603 * n.y
+       + sh[2].rgb * 0.488603 * n.z
+       + sh[3].rgb * 0.488603 * n.x
+       + sh[4].rgb * 1.092548 * n.x * n.y
+       + sh[5].rgb * 1.092548 * n.y * n.z
+       + sh[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+       + sh[7].rgb * 1.092548 * n.x * n.z
+       + sh[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// direction to octahedral uv, must match EnvironmentConverter::octahedralCoordinates
+vec2 octEncode(vec3 d)
+{
+  d /= abs(d.x) + abs(d.y) + abs(d.z);
+  vec2 p = d.xy;
+  if (d.z < 0.0)
+    p = (1.0 - abs(d.yx)) * vec2(d.x >= 0.0 ? 1.0 : -1.0, d.y >= 0.0 ? 1.0 : -1.0);
+  return p * 0.5 + 0.5;
+}
+
+vec4 environment(vec3 dir, float lod, bool explicitLod)
+{
+  if (octahedral == 1)
+  {
+    vec2 uv = octEncode(dir);
+    if (explicitLod)
+      return textureLod(octMap, uv, lod);
+    // uv jumps across the folds, drop those derivatives so the seam doesn't pick the smallest mip
+    vec2 dx = dFdx(uv);
+    vec2 dy = dFdy(uv);
+    if (dot(dx, dx) > 0.0625)
+      dx = vec2(0.0);
+    if (dot(dy, dy) > 0.0625)
+      dy = vec2(0.0);
+    return textureGrad(octMap, uv, dx, dy);
+  }
+  return explicitLod ? textureLod(cubeMap, dir, lod) : texture(cubeMap, dir);
+}
+
+vec3 toDisplay(vec3 linear)
+{
+  if (hdr == 1)
+    linear = 1.0 - exp(-linear * exposure);
+  return pow(max(linear, vec3(0.0)), vec3(1.0 / 2.2));
+}
+
 void main ()
 {
  // set the fragment colour to the current texture
- outColour = texture(cubeMap,vertUV);
+ if (reflectOn == 1 && diffuseOn == 1)
+ {
+  // the SH is linear and the LDR cube map faces are gamma 2.2
+  outColour = vec4(toDisplay(shIrradiance(normalize(diffuseDir))), 1.0);
+  return;
+ }
+ if (reflectOn == 1)
+  outColour = environment(vertUV, roughness * maxLod, true);
+ else
+  outColour = environment(vertUV, 0.0, false);
+ if (hdr == 1)
+  outColour = vec4(toDisplay(outColour.rgb), 1.0);
+ if (reflectOn == 1 && dynamicOn == 1)
+ {
+  vec4 live = textureLod(dynamicMap, vertUV, roughness * dynamicMaxLod);
+  outColour.rgb = outColour.rgb * (1.0 - live.a) + live.rgb;
+ }
 }
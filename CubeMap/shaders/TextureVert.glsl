@@ -1,10 +1,12 @@
 #version 330 core
 
-/// @brief MVP passed from app
-uniform mat4 MVP;
-uniform mat4 M;
-uniform mat3 normalMatrix;
-uniform vec3 cameraPos;
+// per object matrices from the FrameUniforms ring buffer (binding 1)
+layout(std140) uniform ObjectData
+{
+  mat4 model;
+  mat4 MVP;
+  mat3 normalMatrix;
+};
 uniform int reflectOn;
 /// @brief the vertex passed in
 layout (location = 0) in vec3 inVert;
@@ -15,13 +17,18 @@ layout (location = 2) in vec2 inUV;
 out int rOn;
 // we use this to pass the UV values to the frag shader
 out vec3 vertUV;
+// normal in the same (flipped) space as the reflection lookup for the SH irradiance
+out vec3 diffuseDir;
 
 void main()
 {
-	vec4 position = M * vec4(inVert,1.0);
+	vec4 position = model * vec4(inVert,1.0);
 	vec3 normal = normalMatrix * inNormal;
 
-	vec3 reflection = reflect(position.xyz - cameraPos, -normalize(normal));
+	// reflected about the object origin
+	vec3 reflection = reflect(position.xyz - model[3].xyz, -normalize(normal));
+	vec3 n = -normalize(normal);
+	diffuseDir = vec3(n.x, -n.yz);
 
 	// calculate the vertex position
 	gl_Position = MVP*vec4(inVert, 1.0);
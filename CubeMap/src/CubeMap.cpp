@@ -1,67 +1,573 @@
 #include "CubeMap.h"
+#include "BlockCompressor.h"
+#include "CubeMipBuilder.h"
+#include "EnvironmentConverter.h"
+#include "EnvironmentFilter.h"
+#include "HDRImage.h"
+#include "Hash.h"
+#include "SphericalHarmonics.h"
+#include "TextureCache.h"
+#include "TextureStorage.h"
+#include "ThreadPool.h"
+#include <ngl/Image.h>
+#include <ngl/Util.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
-CubeMap::CubeMap(const std::string &_right, const std::string &_left, const std::string &_bottom, const std::string &_top, const std::string &_front, const std  ::string &_back)
+
+namespace
+{
+	// bump when the filtering changes so stale cache entries are ignored
+	constexpr uint64_t PREFILTER_VERSION = 2;
+	constexpr unsigned int PREFILTER_SAMPLES = 64;
+	// separate from the 8 bit chain as the whole packed chain (level 0 included) is cached
+	constexpr uint64_t HDR_VERSION = 1;
+	// the compressed blocks are keyed on the 8 bit chain they came from, bump with the encoder or the layout
+	constexpr uint64_t COMPRESSED_VERSION = 1;
+}
+
+CubeMap::CubeMap(const std::string &_right, const std::string &_left, const std::string &_bottom, const std::string &_top, const std::string &_front, const std  ::string &_back, PackedFormat _hdrFormat, bool _compress)
+	: m_compress(_compress), m_hdrFormat(_hdrFormat)
+{
+	// GL face order is +X -X +Y -Y +Z -Z
+	loadFaces({{_right, _left, _top, _bottom, _front, _back}});
+}
+
+
+CubeMap::CubeMap(int _size)
+	: m_size(_size)
+{
+	GLsizei levels = TextureStorage::fullMipLevels(GLsizei(_size));
+	createCubeMap(GLsizei(_size), levels);
+	m_bytes = 0;
+	for (GLsizei l = 0; l < levels; ++l)
+	{
+		size_t levelSize = size_t(std::max(1, _size >> l));
+		m_bytes += levelSize * levelSize * 4 * 6;
+	}
+	// layered target, the whole depth cube is attached so gl_Layer picks the face for colour and depth
+	SamplerState depthSampler;
+	depthSampler.minFilter = GL_NEAREST;
+	depthSampler.magFilter = GL_NEAREST;
+	depthSampler.wrap = GL_CLAMP_TO_EDGE;
+	m_depthCube = TextureStorage::create(GL_TEXTURE_CUBE_MAP, 1, GL_DEPTH_COMPONENT24, _size, _size, 1, depthSampler);
+	GLint previous = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &m_layeredFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_layeredFBO);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_id, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthCube, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "CubeMap: layered capture framebuffer incomplete\n";
+	}
+	// single face target, the colour face is attached per capture
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _size, _size);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &m_faceFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_faceFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous));
+
+	glGenBuffers(1, &m_captureBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_captureBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, 6 * sizeof(ngl::Mat4), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glGenQueries(1, &m_captureQuery);
+}
+
+
+CubeMap::~CubeMap()
+{
+	glDeleteTextures(1, &m_id);
+	glDeleteBuffers(1, &m_irradianceBuffer);
+	glDeleteTextures(1, &m_depthCube);
+	glDeleteRenderbuffers(1, &m_depthBuffer);
+	glDeleteFramebuffers(1, &m_layeredFBO);
+	glDeleteFramebuffers(1, &m_faceFBO);
+	glDeleteBuffers(1, &m_captureBuffer);
+	glDeleteQueries(1, &m_captureQuery);
+}
+
+
+ngl::Mat4 CubeMap::faceView(const ngl::Vec3 &_centre, int _face)
+{
+	// the usual GL capture cameras (up is -Y for the side faces as t runs down the face), then turned 180
+	// degrees about X because the demo looks faces up with vec3(r.x, -r.y, -r.z)
+	static const float axes[6][6] = {
+		{1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f},
+		{-1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f},
+		{0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f},
+		{0.0f, -1.0f, 0.0f, 0.0f, 0.0f, -1.0f},
+		{0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f},
+		{0.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f}};
+	const float *a = axes[_face];
+	ngl::Vec3 dir(a[0], -a[1], -a[2]);
+	ngl::Vec3 up(a[3], -a[4], -a[5]);
+	return ngl::lookAt(_centre, _centre + dir, up);
+}
+
+
+ngl::Mat4 CubeMap::faceProjection()
+{
+	return ngl::perspective(90.0f, 1.0f, 0.05f, 100.0f);
+}
+
+
+void CubeMap::capture(const ngl::Vec3 &_centre, CaptureMode _mode,
+											const std::function<void(int _face, const ngl::Mat4 &_view, const ngl::Mat4 &_project)> &_draw)
+{
+	if (m_layeredFBO == 0)
+	{
+		return;
+	}
+	// time of the previous capture, read back once it is ready so the CPU never waits on it
+	if (m_captureQueryActive)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(m_captureQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(m_captureQuery, GL_QUERY_RESULT, &ns);
+			m_captureTime = double(ns) * 1e-6;
+			m_captureQueryActive = false;
+		}
+	}
+	bool timing = !m_captureQueryActive;
+	if (timing)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_captureQuery);
+	}
+	GLint previous = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLfloat clear[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+
+	ngl::Mat4 project = faceProjection();
+	int face = -1;
+	if (_mode == CaptureMode::Layered)
+	{
+		std::array<ngl::Mat4, 6> viewProjection;
+		for (int f = 0; f < 6; ++f)
+		{
+			viewProjection[size_t(f)] = project * faceView(_centre, f);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, m_captureBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(viewProjection), viewProjection.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAPTURE_BINDING, m_captureBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_layeredFBO);
+	}
+	else
+	{
+		face = m_nextFace;
+		m_nextFace = (m_nextFace + 1) % 6;
+		glBindFramebuffer(GL_FRAMEBUFFER, m_faceFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + GLenum(face), m_id, 0);
+	}
+	glViewport(0, 0, m_size, m_size);
+	// alpha 0 where nothing was drawn so the shader can fall back to the static environment
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	_draw(face, face < 0 ? ngl::Mat4() : faceView(_centre, face), project);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous));
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clear[0], clear[1], clear[2], clear[3]);
+	// live content can't go through the CPU filters, the driver mips are enough for rough reflections
+	TextureStorage::generateMipmaps(GL_TEXTURE_CUBE_MAP, m_id);
+	if (timing)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_captureQueryActive = true;
+	}
+}
+
+
+CubeMap::CubeMap(std::string *_names, CubeMipFilter _mips)
+	: m_mipFilter(_mips)
+{
+	loadFaces({{_names[0], _names[1], _names[2], _names[3], _names[4], _names[5]}});
+}
+
+
+CubeMap::CubeMap(const std::string &_equirect, int _faceSize)
 {
-	createCubeMap();
-	ngl::Image t(_right);
-	GLuint width=t.width();
-	GLuint height=t.height();
-	GLuint format=t.format();
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
-	t.load(_left);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
+	ngl::Image panorama;
+	if (!panorama.load(_equirect))
+	{
+		std::cerr << "CubeMap: unable to load " << _equirect << '\n';
+		return;
+	}
+	if (panorama.width() != 2 * panorama.height())
+	{
+		std::cerr << "CubeMap: " << _equirect << " is not a 2:1 equirectangular panorama\n";
+		return;
+	}
+	int channels = panorama.format() == GL_RGBA ? 4 : 3;
+	FloatImage linear = FloatImage::fromBytes(panorama.getPixels(), int(panorama.width()), int(panorama.height()), channels, true);
+	int size = _faceSize > 0 ? _faceSize : int(panorama.width()) / 4;
+	CubeImage cube = EnvironmentConverter::equirectToCube(linear, size, Resample::Cubic);
+	// level 0 is uploaded as 8 bit like the PNG faces
+	std::vector<unsigned char> bytes(size_t(size) * size_t(size) * 4 * 6);
+	std::array<const unsigned char *, 6> pixels;
+	for (int f = 0; f < 6; ++f)
+	{
+		unsigned char *face = bytes.data() + size_t(f) * size_t(size) * size_t(size) * 4;
+		cube.toBytes(f, face, true);
+		pixels[size_t(f)] = face;
+	}
+	build(pixels, size, 4, cube);
+}
 
-	t.load(_bottom);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
 
-	t.load(_top);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
+bool CubeMap::decodeFaces(const std::array<std::string, 6> &_names, std::array<ngl::Image, 6> &o_faces)
+{
+	// decode all six faces at once into their own images, the PNG decode is the slow part
+	std::array<bool, 6> loaded = {{false, false, false, false, false, false}};
+	ThreadPool::instance().parallelFor(o_faces.size(), [&](size_t _begin, size_t _end)
+	{
+		for (size_t i = _begin; i < _end; ++i)
+		{
+			loaded[i] = o_faces[i].load(_names[i]);
+		}
+	});
+
+	GLuint width = o_faces[0].width();
+	GLuint height = o_faces[0].height();
+	for (size_t i = 0; i < o_faces.size(); ++i)
+	{
+		if (!loaded[i])
+		{
+			std::cerr << "CubeMap: unable to load " << _names[i] << '\n';
+			return false;
+		}
+		if (o_faces[i].width() != width || o_faces[i].height() != height || width != height)
+		{
+			std::cerr << "CubeMap: faces must be square and the same size, " << _names[i] << " is "
+								<< o_faces[i].width() << 'x' << o_faces[i].height() << " expected " << width << 'x' << width << '\n';
+			return false;
+		}
+	}
+	return true;
+}
 
-	t.load(_front);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
 
-	t.load(_back);
-	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+void CubeMap::loadFaces(const std::array<std::string, 6> &_names)
+{
+	if (HDRImage::isHDR(_names[0]))
+	{
+		loadHDRFaces(_names);
+		return;
+	}
+	std::array<ngl::Image, 6> faces;
+	if (!decodeFaces(_names, faces))
+	{
+		return;
+	}
+	GLuint width = faces[0].width();
+	int channels = faces[0].format() == GL_RGBA ? 4 : 3;
+	std::array<const unsigned char *, 6> pixels;
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		pixels[i] = faces[i].getPixels();
+	}
+	// the PNGs are gamma encoded, all the filtering is done in linear
+	build(pixels, int(width), channels, CubeImage::fromBytes(pixels, int(width), channels, true));
+}
+
+
+void CubeMap::loadHDRFaces(const std::array<std::string, 6> &_names)
+{
+	std::array<FloatImage, 6> faces;
+	std::array<bool, 6> loaded = {{false, false, false, false, false, false}};
+	ThreadPool::instance().parallelFor(faces.size(), [&](size_t _begin, size_t _end)
+	{
+		for (size_t i = _begin; i < _end; ++i)
+		{
+			loaded[i] = HDRImage::load(_names[i], faces[i]);
+		}
+	});
+	int size = faces[0].width();
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		// HDRImage reports why it failed
+		if (!loaded[i])
+		{
+			return;
+		}
+		if (faces[i].width() != size || faces[i].height() != size)
+		{
+			std::cerr << "CubeMap: faces must be square and the same size, " << _names[i] << " is "
+								<< faces[i].width() << 'x' << faces[i].height() << " expected " << size << 'x' << size << '\n';
+			return;
+		}
+	}
+	CubeImage linear(size);
+	for (int f = 0; f < 6; ++f)
+	{
+		std::copy_n(faces[size_t(f)].data(), size_t(size) * size_t(size) * 4, linear.face(f));
+	}
+
+	GLsizei levels = TextureStorage::fullMipLevels(GLsizei(size));
+	std::vector<uint32_t> chain = prefilterPacked(linear, levels);
+	createCubeMap(GLsizei(size), levels, PackedHDR::internalFormat(m_hdrFormat));
+	GLenum type = PackedHDR::pixelType(m_hdrFormat);
+	const uint32_t *level = chain.data();
+	for (GLsizei l = 0; l < levels; ++l)
+	{
+		GLsizei levelSize = std::max(1, GLsizei(size) >> l);
+		for (GLint f = 0; f < 6; ++f)
+		{
+			TextureStorage::upload(GL_TEXTURE_CUBE_MAP, m_id, l, f, levelSize, levelSize, 1, GL_RGB, type, level);
+			level += levelSize * levelSize;
+		}
+	}
+	m_hdr = true;
+	m_formatName = PackedHDR::name(m_hdrFormat);
+	m_bytes = chain.size() * sizeof(uint32_t);
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	createIrradiance(linear);
 }
 
 
-CubeMap::CubeMap(std::string *_names)
+std::vector<uint32_t> CubeMap::prefilterPacked(const CubeImage &_linear, int _levels)
 {
-	createCubeMap();
-	for(int i = 0; i < 6; i++)
+	int size = _linear.size();
+	uint64_t params[] = {HDR_VERSION, PREFILTER_VERSION, uint64_t(size), uint64_t(_levels), PREFILTER_SAMPLES, uint64_t(m_hdrFormat)};
+	uint64_t key = fnv1a64(params, sizeof(params));
+	for (int f = 0; f < 6; ++f)
+	{
+		key = fnv1a64(_linear.face(f), size_t(size) * size_t(size) * 4 * sizeof(float), key);
+	}
+	size_t expected = 0;
+	for (int l = 0; l < _levels; ++l)
 	{
+		size_t levelSize = size_t(std::max(1, size >> l));
+		expected += levelSize * levelSize * 6;
+	}
+	std::vector<uint32_t> chain(expected);
+	std::vector<unsigned char> cached;
+	if (TextureCache::load(key, cached) && cached.size() == expected * sizeof(uint32_t))
+	{
+		std::memcpy(chain.data(), cached.data(), cached.size());
+		return chain;
+	}
+	// level 0 of the prefiltered chain is the source itself
+	CubeChain filtered = EnvironmentFilter::prefilterGGX(_linear, _levels, PREFILTER_SAMPLES);
+	uint32_t *out = chain.data();
+	for (const auto &level : filtered)
+	{
+		size_t texels = size_t(level.size()) * size_t(level.size()) * 6;
+		PackedHDR::pack(level.face(0), texels, m_hdrFormat, out);
+		out += texels;
+	}
+	TextureCache::store(key, chain.data(), chain.size() * sizeof(uint32_t));
+	return chain;
+}
+
 
-		ngl::Image t(_names[i]);
-		GLuint width=t.width();
-		GLuint height=t.height();
-		GLuint format=t.format();
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, t.getPixels());
+void CubeMap::build(const std::array<const unsigned char *, 6> &_pixels, int _size, int _channels, const CubeImage &_linear)
+{
+	// allocate every level once, level 0 is the faces as loaded and the rest are either the GGX prefiltered
+	// chain (roughness 0 to 1) or seam aware mips, both built here rather than by glGenerateMipmap
+	GLsizei levels = TextureStorage::fullMipLevels(GLsizei(_size));
+	auto start = std::chrono::steady_clock::now();
+	bool ggx = m_mipFilter == CubeMipFilter::GGX;
+	std::vector<unsigned char> chain = ggx ? prefilter(_pixels, _linear, _channels, levels) : seamlessMips(_linear, levels);
+	std::cout << "CubeMap: " << (ggx ? "GGX" : "seamless") << " mips for " << _size << 'x' << _size << " built in "
+						<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+	if (m_compress && buildCompressed(_pixels, _size, _channels, chain, levels))
+	{
+		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+		createIrradiance(_linear);
+		return;
+	}
+	createCubeMap(GLsizei(_size), levels);
+	GLenum format = _channels == 4 ? GL_RGBA : GL_RGB;
+	for (size_t i = 0; i < _pixels.size(); ++i)
+	{
+		TextureStorage::upload(GL_TEXTURE_CUBE_MAP, m_id, 0, GLint(i), _size, _size, 1, format, GL_UNSIGNED_BYTE, _pixels[i]);
+	}
+	m_bytes = size_t(_size) * size_t(_size) * 4 * 6;
+	const unsigned char *level = chain.data();
+	for (GLsizei l = 1; l < levels; ++l)
+	{
+		GLsizei size = std::max(1, GLsizei(_size) >> l);
+		m_bytes += size_t(size) * size_t(size) * 4 * 6;
+		for (GLint f = 0; f < 6; ++f)
+		{
+			TextureStorage::upload(GL_TEXTURE_CUBE_MAP, m_id, l, f, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, level);
+			level += size * size * 4;
+		}
 	}
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	createIrradiance(_linear);
+}
+
 
+bool CubeMap::buildCompressed(const std::array<const unsigned char *, 6> &_pixels, int _size, int _channels,
+															const std::vector<unsigned char> &_chain, int _levels)
+{
+	BlockFormat format = BlockCompressor::isSupported(BlockFormat::BC7) ? BlockFormat::BC7 : BlockFormat::BC1;
+	if (!BlockCompressor::isSupported(format))
+	{
+		std::cerr << "CubeMap: no block compressed format available, the faces are uploaded as RGBA8\n";
+		return false;
+	}
+	// every level is compressed as it is, the prefiltered chain isn't a box filtered one compressMipChain would make
+	size_t blockBytes = BlockCompressor::blockBytes(format);
+	size_t expected = 0;
+	for (int l = 0; l < _levels; ++l)
+	{
+		size_t blocks = size_t((std::max(1, _size >> l) + 3) / 4);
+		expected += blocks * blocks * blockBytes * 6;
+	}
+	uint64_t params[] = {COMPRESSED_VERSION, uint64_t(format), uint64_t(_size), uint64_t(_channels), uint64_t(_levels)};
+	uint64_t key = fnv1a64(params, sizeof(params));
+	for (const unsigned char *face : _pixels)
+	{
+		key = fnv1a64(face, size_t(_size) * size_t(_size) * size_t(_channels), key);
+	}
+	key = fnv1a64(_chain.data(), _chain.size(), key);
+	std::vector<unsigned char> blocks;
+	if (!TextureCache::load(key, blocks) || blocks.size() != expected)
+	{
+		auto start = std::chrono::steady_clock::now();
+		blocks.clear();
+		blocks.reserve(expected);
+		const unsigned char *level = _chain.data();
+		for (int l = 0; l < _levels; ++l)
+		{
+			int size = std::max(1, _size >> l);
+			for (size_t f = 0; f < _pixels.size(); ++f)
+			{
+				// level 0 is the faces as loaded, the rest RGBA8 from the chain
+				const unsigned char *texels = l == 0 ? _pixels[f] : level;
+				auto face = BlockCompressor::compress(texels, size, size, l == 0 ? _channels : 4, format, CompressionQuality::High);
+				blocks.insert(blocks.end(), face.begin(), face.end());
+				if (l != 0)
+				{
+					level += size_t(size) * size_t(size) * 4;
+				}
+			}
+		}
+		TextureCache::store(key, blocks.data(), blocks.size());
+		std::cout << "CubeMap: " << BlockCompressor::name(format) << " compressed in "
+							<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+	}
+
+	GLenum internalFormat = BlockCompressor::internalFormat(format);
+	createCubeMap(GLsizei(_size), GLsizei(_levels), internalFormat);
+	const unsigned char *data = blocks.data();
+	for (int l = 0; l < _levels; ++l)
+	{
+		int size = std::max(1, _size >> l);
+		GLsizei faceBytes = GLsizei(size_t((size + 3) / 4) * size_t((size + 3) / 4) * blockBytes);
+		for (GLint f = 0; f < 6; ++f)
+		{
+			TextureStorage::uploadCompressed(GL_TEXTURE_CUBE_MAP, m_id, l, f, size, size, 1, internalFormat, faceBytes, data);
+			data += faceBytes;
+		}
+	}
+	m_formatName = BlockCompressor::name(format);
+	m_bytes = blocks.size();
+	return true;
 }
 
 
-void CubeMap::createCubeMap()
+void CubeMap::createIrradiance(const CubeImage &_linear)
 {
-	glGenTextures(1, &m_id);
+	m_irradiance = SphericalHarmonics::irradiance(SphericalHarmonics::project(_linear));
+	// vec4 sh[9] in a std140 block is exactly the padded coefficient array
+	glGenBuffers(1, &m_irradianceBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_irradianceBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(m_irradiance.c), m_irradiance.c.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
 
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+std::vector<unsigned char> CubeMap::prefilter(const std::array<const unsigned char *, 6> &_pixels, const CubeImage &_linear, int _channels, int _levels)
+{
+	int size = _linear.size();
+	// the key covers the pixels of all six faces and everything that changes the output
+	uint64_t params[] = {PREFILTER_VERSION, uint64_t(size), uint64_t(_channels), uint64_t(_levels), PREFILTER_SAMPLES};
+	uint64_t key = fnv1a64(params, sizeof(params));
+	for (auto pixels : _pixels)
+	{
+		key = fnv1a64(pixels, size_t(size) * size_t(size) * size_t(_channels), key);
+	}
+	size_t expected = 0;
+	for (int l = 1; l < _levels; ++l)
+	{
+		size_t levelSize = size_t(std::max(1, size >> l));
+		expected += levelSize * levelSize * 4 * 6;
+	}
+	std::vector<unsigned char> chain;
+	if (TextureCache::load(key, chain) && chain.size() == expected)
+	{
+		return chain;
+	}
+	chain.clear();
+	// convolve in linear then re-encode
+	CubeChain filtered = EnvironmentFilter::prefilterGGX(_linear, _levels, PREFILTER_SAMPLES);
+	for (size_t l = 1; l < filtered.size(); ++l)
+	{
+		size_t faceBytes = size_t(filtered[l].size()) * size_t(filtered[l].size()) * 4;
+		for (int f = 0; f < 6; ++f)
+		{
+			chain.resize(chain.size() + faceBytes);
+			filtered[l].toBytes(f, chain.data() + chain.size() - faceBytes, true);
+		}
+	}
+	TextureCache::store(key, chain.data(), chain.size());
+	return chain;
+}
+
+
+std::vector<unsigned char> CubeMap::seamlessMips(const CubeImage &_linear, int _levels)
+{
+	CubeChain mips = CubeMipBuilder::build(_linear, _levels);
+	// every face of every level encodes independently into its slot of the upload buffer
+	std::vector<size_t> offsets;
+	size_t bytes = 0;
+	for (size_t l = 1; l < mips.size(); ++l)
+	{
+		for (int f = 0; f < 6; ++f)
+		{
+			offsets.push_back(bytes);
+			bytes += size_t(mips[l].size()) * size_t(mips[l].size()) * 4;
+		}
+	}
+	std::vector<unsigned char> chain(bytes);
+	ThreadPool::instance().parallelFor(offsets.size(), [&](size_t _begin, size_t _end)
+	{
+		for (size_t i = _begin; i < _end; ++i)
+		{
+			mips[1 + i / 6].toBytes(int(i % 6), chain.data() + offsets[i], true);
+		}
+	});
+	return chain;
+}
+
+
+void CubeMap::createCubeMap(GLsizei _size, GLsizei _levels, GLenum _internalFormat)
+{
+	SamplerState sampler;
+	sampler.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	sampler.magFilter = GL_LINEAR;
+	sampler.wrap = GL_CLAMP_TO_EDGE;
   //GLfloat anisotropy;
   //glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &anisotropy);
 
   //glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_MAX_TEXTURE_MAX_ANISOTROPY, anisotropy);
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-   // glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_AUTO_GENERATE_MIPMAP, GL_TRUE);
-
+	m_levels = int(_levels);
+	m_id = TextureStorage::create(GL_TEXTURE_CUBE_MAP, _levels, _internalFormat, _size, _size, 1, sampler);
 }
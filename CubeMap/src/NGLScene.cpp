@@ -2,6 +2,7 @@
 #include <QGuiApplication>
 
 #include "NGLScene.h"
+#include "Assets.h"
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/VAOFactory.h>
@@ -9,6 +10,8 @@
 #include <ngl/ShaderLib.h>
 #include <ngl/Texture.h>
 #include <ngl/NGLStream.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 const std::string NGLScene::s_vboNames[8] =
@@ -29,8 +32,22 @@ const static float INCREMENT = 0.01f;
 /// @brief the increment for the wheel zoom
 //----------------------------------------------------------------------------------------------------------------------
 const static float ZOOM = 0.1f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief FrameUniforms object slots, loadMatricesToShader queues the sky cube then the object
+//----------------------------------------------------------------------------------------------------------------------
+const static size_t SKY_SLOT = 0;
+const static size_t OBJECT_SLOT = 1;
+const static size_t SATELLITE_SLOT = 2;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the objects orbiting the reflective one and the texture unit of their live reflection
+//----------------------------------------------------------------------------------------------------------------------
+const static std::string SATELLITES[4] = {"teapot", "torus", "cube", "sphere"};
+const static ngl::Vec4 SATELLITE_COLOURS[4] = {{0.9f, 0.2f, 0.2f, 1.0f}, {0.2f, 0.8f, 0.3f, 1.0f}, {0.2f, 0.4f, 0.9f, 1.0f},
+                                               {0.9f, 0.8f, 0.2f, 1.0f}};
+const static GLuint DYNAMIC_UNIT = 2;
+const static int DYNAMIC_SIZE = 256;
 
-NGLScene::NGLScene()
+NGLScene::NGLScene(const std::string &_hdrDirectory) : m_hdrDirectory(_hdrDirectory)
 {
   // re-size the widget to that of the parent (in this case the GLFrame passed in on construction)
   m_rotate = false;
@@ -79,6 +96,8 @@ void NGLScene::createSkyBox()
 
 NGLScene::~NGLScene()
 {
+  glDeleteQueries(1, &m_samplesQuery);
+  glDeleteVertexArrays(1, &m_skyTriangleVAO);
   std::cout << "Shutting down NGL, removing VAO's and Shaders\n";
 }
 
@@ -87,6 +106,7 @@ void NGLScene::resizeGL(int _w, int _h)
   m_project = ngl::perspective(45.0f, (float)_w / _h, 0.05f, 350.0f);
   m_width = _w * devicePixelRatio();
   m_height = _h * devicePixelRatio();
+  m_text->setScreenSize(_w, _h);
 }
 
 void NGLScene::initializeGL()
@@ -94,6 +114,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("CubeMap.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -117,8 +139,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("TextureVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("TextureFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("TextureVertex");
   ngl::ShaderLib::compileShader("TextureFragment");
@@ -126,8 +148,56 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "TextureFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
-  ngl::ShaderLib::use("TextureShader");
-  ngl::ShaderLib::autoRegisterUniforms("TextureShader");
+  // the fullscreen triangle skybox shares the fragment shader
+  ngl::ShaderLib::createShaderProgram("SkyboxShader");
+  ngl::ShaderLib::attachShader("SkyboxVertex", ngl::ShaderType::VERTEX);
+  Assets::loadShaderSource("SkyboxVertex", "shaders/SkyboxVert.glsl");
+  ngl::ShaderLib::compileShader("SkyboxVertex");
+  ngl::ShaderLib::attachShaderToProgram("SkyboxShader", "SkyboxVertex");
+  ngl::ShaderLib::attachShaderToProgram("SkyboxShader", "TextureFragment");
+  ngl::ShaderLib::linkProgramObject("SkyboxShader");
+  // flat coloured orbiting objects, and the layered version that renders them into all six cube faces
+  ngl::ShaderLib::createShaderProgram("ColourShader");
+  ngl::ShaderLib::createShaderProgram("ColourCaptureShader");
+  ngl::ShaderLib::attachShader("ColourVertex", ngl::ShaderType::VERTEX);
+  ngl::ShaderLib::attachShader("ColourCaptureVertex", ngl::ShaderType::VERTEX);
+  ngl::ShaderLib::attachShader("CaptureGeometry", ngl::ShaderType::GEOMETRY);
+  ngl::ShaderLib::attachShader("ColourFragment", ngl::ShaderType::FRAGMENT);
+  Assets::loadShaderSource("ColourVertex", "shaders/ColourVert.glsl");
+  Assets::loadShaderSource("ColourCaptureVertex", "shaders/ColourCaptureVert.glsl");
+  Assets::loadShaderSource("CaptureGeometry", "shaders/CaptureGeom.glsl");
+  Assets::loadShaderSource("ColourFragment", "shaders/ColourFrag.glsl");
+  for (auto name : {"ColourVertex", "ColourCaptureVertex", "CaptureGeometry", "ColourFragment"})
+  {
+    ngl::ShaderLib::compileShader(name);
+  }
+  ngl::ShaderLib::attachShaderToProgram("ColourShader", "ColourVertex");
+  ngl::ShaderLib::attachShaderToProgram("ColourShader", "ColourFragment");
+  ngl::ShaderLib::attachShaderToProgram("ColourCaptureShader", "ColourCaptureVertex");
+  ngl::ShaderLib::attachShaderToProgram("ColourCaptureShader", "CaptureGeometry");
+  ngl::ShaderLib::attachShaderToProgram("ColourCaptureShader", "ColourFragment");
+  ngl::ShaderLib::linkProgramObject("ColourShader");
+  ngl::ShaderLib::linkProgramObject("ColourCaptureShader");
+  for (auto name : {"ColourShader", "ColourCaptureShader"})
+  {
+    ngl::ShaderLib::use(name);
+    ngl::ShaderLib::autoRegisterUniforms(name);
+    FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID(name));
+  }
+  GLuint capture = ngl::ShaderLib::getProgramID("ColourCaptureShader");
+  glUniformBlockBinding(capture, glGetUniformBlockIndex(capture, "CaptureData"), CubeMap::CAPTURE_BINDING);
+  // the SH irradiance block is fed from whichever CubeMap is enabled
+  // and the matrices from the FrameUniforms blocks
+  for (auto name : {"SkyboxShader", "TextureShader"})
+  {
+    ngl::ShaderLib::use(name);
+    ngl::ShaderLib::autoRegisterUniforms(name);
+    ngl::ShaderLib::setUniform("octMap", static_cast<int>(OctahedralMap::TEXTURE_UNIT));
+    ngl::ShaderLib::setUniform("dynamicMap", static_cast<int>(DYNAMIC_UNIT));
+    GLuint program = ngl::ShaderLib::getProgramID(name);
+    glUniformBlockBinding(program, glGetUniformBlockIndex(program, "SHIrradiance"), CubeMap::IRRADIANCE_BINDING);
+    FrameUniforms::bindBlocks(program);
+  }
   ngl::VAOPrimitives::createSphere("sphere", 1.0, 40);
   ngl::VAOPrimitives::createCylinder("cylinder", 0.5f, 5.0f, 30.0f, 30.0f);
   ngl::VAOPrimitives::createCone("cone", 0.5f, 1.4f, 20.0f, 20.0f);
@@ -136,57 +206,112 @@ void NGLScene::initializeGL()
   ngl::VAOPrimitives::createTorus("torus", 0.15f, 0.4f, 40.0f, 40.0f);
   // as re-size is not explicitly called we need to do this.
   glViewport(0, 0, width(), height());
+  // block compressed where the context allows, the debug faces stay RGBA8 so their seams show as they are
   m_cubeMap.reset(new CubeMap("textures/right.png", "textures/left.png",
                               "textures/bottom.png", "textures/top.png",
-                              "textures/front.png", "textures/back.png"));
+                              "textures/front.png", "textures/back.png", PackedFormat::RGB9E5, true));
   std::string debug[6] = {"textures/DebugRight.png", "textures/DebugLeft.png",
                           "textures/DebugBottom.png", "textures/DebugTop.png",
                           "textures/DebugFront.png", "textures/DebugBack.png"};
-  m_cubeMapDebug.reset(new CubeMap(debug));
+  // plain mips on the debug faces so Up / Down walk the levels and show the seams between faces
+  m_cubeMapDebug.reset(new CubeMap(debug, CubeMipFilter::Seamless));
+  // the same environments as single octahedral textures for comparison
+  m_octMap.reset(new OctahedralMap("textures/right.png", "textures/left.png",
+                                   "textures/bottom.png", "textures/top.png",
+                                   "textures/front.png", "textures/back.png"));
+  // debug[] is in raw GL face order (DebugBottom goes to +Y) while OctahedralMap takes named faces and puts
+  // _top on +Y, so pass the two swapped to get the same layout as the debug cube map
+  m_octMapDebug.reset(new OctahedralMap(debug[0], debug[1], debug[3], debug[2], debug[4], debug[5]));
+  std::cout << "Environment memory, cube map " << m_cubeMap->formatName() << ' ' << m_cubeMap->sizeInBytes() / 1024 << " KB (6 faces + mips) "
+            << "octahedral " << m_octMap->sizeInBytes() / 1024 << " KB (1 texture + mips)\n";
+  // HDR versions of the environment, the same faces in both packed formats for comparison
+  if (!m_hdrDirectory.empty())
+  {
+    const std::string &dir = m_hdrDirectory;
+    const PackedFormat formats[2] = {PackedFormat::RGB9E5, PackedFormat::R11G11B10F};
+    for (size_t i = 0; i < m_hdrMaps.size(); ++i)
+    {
+      m_hdrMaps[i].reset(new CubeMap(dir + "/right.hdr", dir + "/left.hdr", dir + "/bottom.hdr", dir + "/top.hdr",
+                                     dir + "/front.hdr", dir + "/back.hdr", formats[i]));
+      // a map that didn't load has no texture, it is dropped so H never selects it
+      if (m_hdrMaps[i]->getTexID() == 0)
+      {
+        std::cerr << "HDR cube map " << PackedHDR::name(formats[i]) << " not loaded, left out of the H cycle\n";
+        m_hdrMaps[i].reset();
+        continue;
+      }
+      std::cout << "HDR cube map " << PackedHDR::name(formats[i]) << ' ' << m_hdrMaps[i]->sizeInBytes() / 1024 << " KB\n";
+    }
+  }
+  glGenQueries(1, &m_samplesQuery);
+  // GL_SAMPLES_PASSED counts every covered multisample
+  glGetIntegerv(GL_SAMPLES, &m_samples);
 
   createSkyBox();
+  // core profile needs a bound VAO even when the vertices come from gl_VertexID
+  glGenVertexArrays(1, &m_skyTriangleVAO);
+  m_dynamicMap.reset(new CubeMap(DYNAMIC_SIZE));
+  startTimer(16);
+  m_text = std::make_unique<ngl::Text>("fonts/Arial.ttf", 14);
+  m_text->setScreenSize(width(), height());
 }
 
 void NGLScene::loadMatricesToShader()
 {
-  ngl::ShaderLib::use("TextureShader");
-  ngl::Mat4 M = m_transform.getMatrix() * m_mouseGlobalTX;
-  ngl::Mat4 MVP = m_project * m_view * M;
-  ngl::ShaderLib::setUniform("MVP", MVP);
-  ngl::ShaderLib::setUniform("M", M);
-  ngl::ShaderLib::setUniform("cameraPos", ngl::Vec3(M.openGL()[12], M.openGL()[13], M.openGL()[14]));
-  ngl::Mat3 normalMatrix = m_view * M;
+  // both draws' matrices go up in one uniform buffer write, the normal matrix is worked out once here
+  m_uniforms.beginFrame(m_view, m_project);
+  m_uniforms.addObject(ngl::Mat4::scale(5.0f, 5.0f, 5.0f));
+  ngl::Mat3 normalMatrix = m_view * m_mouseGlobalTX;
   normalMatrix.inverse().transpose();
-  ngl::ShaderLib::setUniform("normalMatrix", normalMatrix);
+  m_uniforms.addObject(m_mouseGlobalTX, normalMatrix);
+  if (m_captureMode != 0)
+    queueSatellites(m_uniforms);
+  m_uniforms.upload();
 }
 
-void NGLScene::paintGL()
+void NGLScene::setEnvironmentUniforms(const std::string &_program, CubeMap *_cubeMap, bool _octahedral)
 {
-  // clear the screen and depth buffer
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glViewport(0, 0, m_width, m_height);
-
-  // need to bind the active texture before drawing
+  ngl::ShaderLib::use(_program);
+  ngl::ShaderLib::setUniform("octahedral", _octahedral ? 1 : 0);
+  ngl::ShaderLib::setUniform("hdr", _cubeMap->isHDR() ? 1 : 0);
+  ngl::ShaderLib::setUniform("exposure", m_exposure);
+}
 
-  // render skybox without depth test
+void NGLScene::drawCubeSkyBox()
+{
+  // the old way, a big cube drawn first without depth test so every pixel is shaded again by the object
   glDisable(GL_DEPTH_TEST);
-  m_transform.setScale(5, 5, 5);
-  // m_transform.setRotation(0,0,90);
-  m_mouseGlobalTX.identity();
-  loadMatricesToShader();
-  if (m_debug)
-    m_cubeMapDebug->enable();
-  else
-    m_cubeMap->enable();
+  ngl::ShaderLib::use("TextureShader");
+  ngl::ShaderLib::setUniform("reflectOn", 0);
+  m_uniforms.bindObject(SKY_SLOT);
   m_skybox->bind();
   m_skybox->draw();
   m_skybox->unbind();
-  ngl::ShaderLib::setUniform("reflectOn", 0);
-  // now draw object
   glEnable(GL_DEPTH_TEST);
-  //  glEnable(GL_CULL_FACE);
+}
 
-  m_transform.reset();
+void NGLScene::drawFullscreenSkyBox()
+{
+  // drawn last at the far plane, early Z throws away every pixel the object already covers. The view
+  // direction comes from the FrameData block
+  ngl::ShaderLib::use("SkyboxShader");
+  ngl::ShaderLib::setUniform("reflectOn", 0);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glDepthFunc(GL_LEQUAL);
+  glDepthMask(GL_FALSE);
+  glBindVertexArray(m_skyTriangleVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+}
+
+void NGLScene::paintGL()
+{
+  m_profiler.beginFrame();
+  // clear the screen and depth buffer
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glViewport(0, 0, m_width, m_height);
   // Rotation based on the mouse position for our global transform
   auto rotX = ngl::Mat4::rotateX(m_spinXFace);
   auto rotY = ngl::Mat4::rotateY(m_spinYFace);
@@ -196,11 +321,87 @@ void NGLScene::paintGL()
   m_mouseGlobalTX.m_m[3][0] = m_modelPos.m_x;
   m_mouseGlobalTX.m_m[3][1] = m_modelPos.m_y;
   m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
+  // the capture has its own uniform ring, the main upload afterwards rebinds the camera block
+  if (m_captureMode != 0)
+    captureDynamicMap();
+  loadMatricesToShader();
+
+  // samples shaded for the skybox + object, read back a frame later so we never stall waiting. The profiler times
+  // the same draws
+  if (m_samplesQueryActive)
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(m_samplesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+      GLuint64 samples = 0;
+      glGetQueryObjectui64v(m_samplesQuery, GL_QUERY_RESULT, &samples);
+      m_envSamples += double(samples);
+      ++m_envFrames;
+      m_lastShadedPerPixel = double(samples) / (double(m_width) * double(m_height) * double(std::max(1, m_samples)));
+      m_samplesQueryActive = false;
+    }
+  }
+  m_profiler.beginPass("environment");
+  bool counting = !m_samplesQueryActive;
+  if (counting)
+  {
+    glBeginQuery(GL_SAMPLES_PASSED, m_samplesQuery);
+  }
+  // the cube map also binds the SH irradiance so is always enabled
+  CubeMap *cubeMap = activeCubeMap();
+  cubeMap->enable();
+  // the octahedral maps are LDR only
+  bool octahedral = m_octahedral && !cubeMap->isHDR();
+  if (octahedral)
+    (m_debug ? m_octMapDebug : m_octMap)->enable();
+  setEnvironmentUniforms("SkyboxShader", cubeMap, octahedral);
+  setEnvironmentUniforms("TextureShader", cubeMap, octahedral);
+  if (!m_fullscreenSky)
+    drawCubeSkyBox();
+  // now draw object
+  //  glEnable(GL_CULL_FACE);
+
   glPolygonMode(GL_FRONT_AND_BACK, m_polyMode);
+  ngl::ShaderLib::use("TextureShader");
   ngl::ShaderLib::setUniform("reflectOn", 1);
-
-  loadMatricesToShader();
+  ngl::ShaderLib::setUniform("roughness", m_roughness);
+  ngl::ShaderLib::setUniform("diffuseOn", m_diffuse ? 1 : 0);
+  int levels = octahedral ? (m_debug ? m_octMapDebug : m_octMap)->numLevels() : cubeMap->numLevels();
+  ngl::ShaderLib::setUniform("maxLod", float(levels - 1));
+
+  ngl::ShaderLib::setUniform("dynamicOn", m_captureMode != 0 ? 1 : 0);
+  ngl::ShaderLib::setUniform("dynamicMaxLod", float(m_dynamicMap->numLevels() - 1));
+  glActiveTexture(GL_TEXTURE0 + DYNAMIC_UNIT);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, m_dynamicMap->getTexID());
+  glActiveTexture(GL_TEXTURE0);
+
+  m_uniforms.bindObject(OBJECT_SLOT);
   ngl::VAOPrimitives::draw(s_vboNames[m_primIndex]);
+  if (m_captureMode != 0)
+  {
+    ngl::ShaderLib::use("ColourShader");
+    drawSatellites(m_uniforms, SATELLITE_SLOT);
+    glPolygonMode(GL_FRONT_AND_BACK, m_polyMode);
+  }
+  if (m_fullscreenSky)
+    drawFullscreenSkyBox();
+  if (counting)
+  {
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_samplesQueryActive = true;
+  }
+  m_uniforms.endFrame();
+  m_profiler.beginPass("overlay");
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  m_text->setColour(1.0f, 1.0f, 0.0f);
+  m_text->renderText(10, 700, fmt::format("Skybox {} (B to change)", m_fullscreenSky ? "fullscreen triangle drawn last" : "cube drawn first"));
+  m_text->renderText(10, 680, fmt::format("Environment pass {:.2f} fragments shaded per pixel", m_lastShadedPerPixel));
+  const char *captureModes[] = {"off", "layered, 6 faces a frame", "amortized, 1 face a frame"};
+  m_text->renderText(10, 660, fmt::format("Dynamic reflection {} {:.3f} ms GPU a frame (C to change)", captureModes[m_captureMode],
+                                          m_captureMode != 0 ? m_dynamicMap->captureTime() : 0.0));
+  m_profiler.draw(*m_text, 10, 640);
+  m_profiler.endFrame();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -330,6 +531,55 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_D:
     m_debug ^= true;
     break;
+  // surface roughness picks the prefiltered mip
+  case Qt::Key_Up:
+    m_roughness = std::min(1.0f, m_roughness + 0.1f);
+    break;
+  case Qt::Key_Down:
+    m_roughness = std::max(0.0f, m_roughness - 0.1f);
+    break;
+  // diffuse SH lighting instead of the reflection
+  case Qt::Key_I:
+    m_diffuse ^= true;
+    break;
+  // cube map / octahedral environment, prints the cost of the mode being left
+  case Qt::Key_O:
+    reportEnvironmentCost();
+    m_octahedral ^= true;
+    break;
+  // LDR / RGB9E5 / R11G11B10F environment when an HDR directory was given
+  case Qt::Key_H:
+    if (m_hdrMaps[0] || m_hdrMaps[1])
+    {
+      reportEnvironmentCost();
+      // on to the next map that loaded, the LDR one always has
+      do
+      {
+        m_hdrMode = (m_hdrMode + 1) % 3;
+      } while (m_hdrMode > 0 && !m_hdrMaps[size_t(m_hdrMode - 1)]);
+    }
+    break;
+  // exposure of the HDR environment
+  case Qt::Key_Plus:
+  case Qt::Key_Equal:
+    m_exposure *= 1.25f;
+    break;
+  case Qt::Key_Minus:
+    m_exposure /= 1.25f;
+    break;
+  // dynamic reflection off / layered / amortized
+  case Qt::Key_C:
+    m_captureMode = (m_captureMode + 1) % 3;
+    break;
+  // cube skybox drawn first / fullscreen triangle drawn last, prints the cost of the mode being left
+  case Qt::Key_B:
+    reportEnvironmentCost();
+    m_fullscreenSky ^= true;
+    break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("CubeMapProfile.csv");
+    break;
 
   default:
     break;
@@ -339,6 +589,97 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   update();
 }
 
+void NGLScene::timerEvent(QTimerEvent *)
+{
+  if (m_captureMode != 0)
+  {
+    m_time += 0.016f;
+    update();
+  }
+}
+
+void NGLScene::queueSatellites(FrameUniforms &_uniforms)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    float angle = m_time * 0.6f + float(i) * 1.5707963f;
+    ngl::Mat4 position = ngl::Mat4::translate(2.2f * std::cos(angle), 0.4f * std::sin(2.0f * angle), 2.2f * std::sin(angle));
+    ngl::Mat4 spin = ngl::Mat4::rotateY(m_time * 90.0f + float(i) * 45.0f);
+    _uniforms.addObject(position * spin * ngl::Mat4::scale(0.4f, 0.4f, 0.4f));
+  }
+}
+
+void NGLScene::drawSatellites(FrameUniforms &_uniforms, size_t _firstSlot)
+{
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    ngl::ShaderLib::setUniform("colour", SATELLITE_COLOURS[i]);
+    _uniforms.bindObject(_firstSlot + i);
+    ngl::VAOPrimitives::draw(SATELLITES[i]);
+  }
+}
+
+void NGLScene::captureDynamicMap()
+{
+  // the reflective object sees the orbiting objects from its centre, everything else comes from the static map
+  ngl::Vec3 centre(m_mouseGlobalTX.m_m[3][0], m_mouseGlobalTX.m_m[3][1], m_mouseGlobalTX.m_m[3][2]);
+  CaptureMode mode = m_captureMode == 1 ? CaptureMode::Layered : CaptureMode::Amortized;
+  m_dynamicMap->capture(centre, mode, [&](int _face, const ngl::Mat4 &_view, const ngl::Mat4 &_project)
+  {
+    // layered projects in the geometry shader so the camera block isn't used, the amortized face is an
+    // ordinary draw with the face camera
+    m_captureUniforms.beginFrame(_face < 0 ? m_view : _view, _face < 0 ? m_project : _project);
+    queueSatellites(m_captureUniforms);
+    m_captureUniforms.upload();
+    ngl::ShaderLib::use(_face < 0 ? "ColourCaptureShader" : "ColourShader");
+    drawSatellites(m_captureUniforms, 0);
+    m_captureUniforms.endFrame();
+  });
+}
+
+CubeMap *NGLScene::activeCubeMap()
+{
+  if (m_hdrMode > 0 && m_hdrMaps[size_t(m_hdrMode - 1)])
+  {
+    return m_hdrMaps[size_t(m_hdrMode - 1)].get();
+  }
+  return m_debug ? m_cubeMapDebug.get() : m_cubeMap.get();
+}
+
+void NGLScene::reportEnvironmentCost()
+{
+  CubeMap *cubeMap = activeCubeMap();
+  bool octahedral = m_octahedral && !cubeMap->isHDR();
+  size_t bytes = octahedral ? (m_debug ? m_octMapDebug : m_octMap)->sizeInBytes() : cubeMap->sizeInBytes();
+  const char *format = octahedral ? "RGBA8" : cubeMap->formatName();
+  std::cout << (octahedral ? "octahedral " : (cubeMap->isHDR() ? "HDR cube map " : "cube map ")) << format << ' ' << bytes / 1024 << " KB, ";
+  std::cout << (m_fullscreenSky ? "fullscreen sky, " : "cube sky, ");
+  // the profiler's totals run on across modes, so average the difference since this mode started
+  size_t pass = m_profiler.passIndex("environment");
+  double envTime = 0.0;
+  size_t timed = 0;
+  if (pass < m_profiler.numPasses())
+  {
+    envTime = m_profiler.passGpuTime(pass).total() - m_envTimeStart;
+    timed = m_profiler.passGpuTime(pass).count() - m_envTimedStart;
+    m_envTimeStart = m_profiler.passGpuTime(pass).total();
+    m_envTimedStart = m_profiler.passGpuTime(pass).count();
+  }
+  if (timed > 0 && m_envFrames > 0)
+  {
+    double pixels = double(m_width) * double(m_height) * double(std::max(1, m_samples));
+    std::cout << envTime / double(timed) << " ms GPU avg over " << timed << " frames, "
+              << m_envSamples / m_envFrames / pixels << " fragments shaded per pixel\n";
+  }
+  else
+  {
+    std::cout << "no frames timed\n";
+  }
+  m_envSamples = 0.0;
+  m_envFrames = 0;
+}
+
 void NGLScene::nextPrim()
 {
 
@@ -0,0 +1,40 @@
+#include "OctahedralMap.h"
+#include "CubeMap.h"
+#include "EnvironmentConverter.h"
+#include "TextureStorage.h"
+#include <vector>
+
+OctahedralMap::OctahedralMap(const std::string &_right, const std::string &_left, const std::string &_bottom, const std::string &_top, const std::string &_front, const std::string &_back)
+{
+	std::array<ngl::Image, 6> faces;
+	if (!CubeMap::decodeFaces({{_right, _left, _top, _bottom, _front, _back}}, faces))
+	{
+		return;
+	}
+	int faceSize = int(faces[0].width());
+	int channels = faces[0].format() == GL_RGBA ? 4 : 3;
+	std::array<const unsigned char *, 6> pixels;
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		pixels[i] = faces[i].getPixels();
+	}
+	// twice the face size keeps about the same texel density as the cube around the equator
+	int size = 2 * faceSize;
+	FloatImage level = EnvironmentConverter::cubeToOctahedral(CubeImage::fromBytes(pixels, faceSize, channels, true), size);
+	m_levels = TextureStorage::fullMipLevels(size);
+	SamplerState sampler;
+	sampler.wrap = GL_CLAMP_TO_EDGE;
+	m_id = TextureStorage::create(GL_TEXTURE_2D, m_levels, GL_RGBA8, size, size, 1, sampler);
+	std::vector<unsigned char> bytes;
+	for (int l = 0; l < m_levels; ++l)
+	{
+		bytes.resize(size_t(level.width()) * size_t(level.height()) * 4);
+		level.toBytes(bytes.data(), true);
+		TextureStorage::upload(GL_TEXTURE_2D, m_id, l, 0, level.width(), level.height(), 1, GL_RGBA, GL_UNSIGNED_BYTE, bytes.data());
+		m_bytes += bytes.size();
+		if (l + 1 < m_levels)
+		{
+			level = EnvironmentConverter::downsampleOctahedral(level);
+		}
+	}
+}
@@ -30,8 +30,8 @@ int main(int argc, char **argv)
   // now set the depth buffer to 24 bits
   format.setDepthBufferSize(24);
   QSurfaceFormat::setDefaultFormat(format);
-  // now we are going to create our scene window
-  NGLScene window;
+  // now we are going to create our scene window, an optional directory of .hdr faces adds the HDR maps
+  NGLScene window(argc > 1 ? argv[1] : "");
   // we can now query the version to see if it worked
   std::cout<<"Profile is "<<format.majorVersion()<<" "<<format.minorVersion()<<"\n";
   // set the window size
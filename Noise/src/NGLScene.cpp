@@ -3,6 +3,8 @@
 
 #include "Noise.h"
 #include "NGLScene.h"
+#include "Assets.h"
+#include "TextureStorage.h"
 #include <ngl/Transformation.h>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
@@ -27,6 +29,8 @@ NGLScene::NGLScene()
   m_spinXFace = 0;
   m_spinYFace = 0;
   setTitle("Qt5 Simple NGL Demo");
+  // redraw continuously so the profiler times frames rather than the gaps between input events
+  m_redrawTimer = startTimer(0);
 }
 
 NGLScene::~NGLScene()
@@ -86,13 +90,14 @@ void NGLScene::makeMarbleTexture(float amp, float strength)
     T = 0.0;
     U += step;
   }
-  glGenTextures(1, &m_textureName);
-  glBindTexture(GL_TEXTURE_3D, m_textureName);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-
-  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB, MSIZE, MSIZE, MSIZE, 0, GL_RGB, GL_FLOAT, data.get());
-  glGenerateMipmap(GL_TEXTURE_3D); //  Allocate the mipmaps
+  SamplerState sampler;
+  sampler.magFilter = GL_NEAREST;
+  sampler.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+  // storage for the volume and all of its mips is allocated once then level 0 is filled
+  m_textureName = TextureStorage::create(GL_TEXTURE_3D, TextureStorage::fullMipLevels(MSIZE, MSIZE, MSIZE), GL_RGB8,
+                                         MSIZE, MSIZE, MSIZE, sampler);
+  TextureStorage::upload(GL_TEXTURE_3D, m_textureName, 0, 0, MSIZE, MSIZE, MSIZE, GL_RGB, GL_FLOAT, data.get());
+  TextureStorage::generateMipmaps(GL_TEXTURE_3D, m_textureName);
   //  Allocate the mipmaps
   std::cout << "done texture\n";
   // remove the Data
@@ -104,6 +109,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("Noise.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -128,8 +135,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("TextureVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("TextureFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("TextureVertex");
   ngl::ShaderLib::compileShader("TextureFragment");
@@ -137,6 +144,7 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "TextureFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("TextureShader"));
   ngl::ShaderLib::use("TextureShader");
   // as re-size is not explicitly called we need to do this.
   glViewport(0, 0, width(), height());
@@ -144,12 +152,17 @@ void NGLScene::initializeGL()
 
 void NGLScene::loadMatricesToShader()
 {
-  ngl::Mat4 MVP = m_project * m_view * m_mouseGlobalTX;
-  ngl::ShaderLib::setUniform("MVP", MVP);
+  // one object a frame, the camera and object blocks go up in a single buffer write
+  m_uniforms.beginFrame(m_view, m_project);
+  size_t object = m_uniforms.addObject(m_mouseGlobalTX);
+  m_uniforms.upload();
+  m_uniforms.bindObject(object);
 }
 
 void NGLScene::paintGL()
 {
+  m_profiler.beginFrame();
+  m_profiler.beginPass("scene");
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_width, m_height);
@@ -167,6 +180,13 @@ void NGLScene::paintGL()
   loadMatricesToShader();
   glBindTexture(GL_TEXTURE_3D, m_textureName);
   ngl::VAOPrimitives::draw("teapot");
+  m_uniforms.endFrame();
+  m_profiler.endFrame();
+  // no text overlay in this demo, the statistics go in the title, refreshed once a second rather than every frame
+  if (m_profiler.summaryDue())
+  {
+    setTitle(QString::fromStdString("Qt5 Simple NGL Demo | " + m_profiler.summary()));
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -287,6 +307,10 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N:
     showNormal();
     break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("NoiseProfile.csv");
+    break;
   default:
     break;
   }
@@ -294,3 +318,12 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   // if (isExposed())
   update();
 }
+
+void NGLScene::timerEvent(QTimerEvent *_event)
+{
+  if (_event->timerId() == m_redrawTimer)
+  {
+    // re-draw GL
+    update();
+  }
+}
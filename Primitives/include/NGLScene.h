@@ -5,6 +5,8 @@
 #include <ngl/Text.h>
 #include <QTime>
 #include <QOpenGLWindow>
+#include "FrameProfiler.h"
+#include "FrameUniforms.h"
 #include <memory>
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -105,6 +107,23 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     void loadMatricesToShader();
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief camera and object matrices as uniform buffers rather than named uniforms
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameUniforms m_uniforms;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frame, CPU and GPU times of the "scene" pass shown in the window title, P records them to
+    /// PrimitivesProfile.csv
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameProfiler m_profiler;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief id of the timer that redraws continuously
+    //----------------------------------------------------------------------------------------------------------------------
+    int m_redrawTimer;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief timer event used to redraw continuously
+    //----------------------------------------------------------------------------------------------------------------------
+    void timerEvent(QTimerEvent *) override;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
     //----------------------------------------------------------------------------------------------------------------------
@@ -1,10 +1,11 @@
 #include <QMouseEvent>
 #include <QGuiApplication>
 #include "NGLScene.h"
+#include "Assets.h"
+#include "BlockCompressor.h"
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
-#include <ngl/Texture.h>
 #include <array>
 #include <iostream>
 
@@ -38,6 +39,8 @@ NGLScene::NGLScene()
   m_spinXFace = 0;
   m_spinYFace = 0;
   setTitle("Simple OpenGL Texture");
+  // redraw continuously so the profiler times frames rather than the gaps between input events
+  m_redrawTimer = startTimer(0);
 
   m_polyMode = GL_FILL;
   m_primIndex = 0;
@@ -62,6 +65,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("Primitives.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -84,8 +89,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("TextureVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("TextureFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("TextureVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("TextureFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("TextureVertex");
   ngl::ShaderLib::compileShader("TextureFragment");
@@ -93,10 +98,14 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "TextureFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("TextureShader"));
   ngl::ShaderLib::use("TextureShader");
 
-  ngl::Texture texture("textures/ratGrid.png");
-  m_textureName = texture.setTextureGL();
+  // BC1 where the context has S3TC, RGBA8 otherwise, the size printed is of whichever was uploaded
+  bool compressed = false;
+  size_t bytes = 0;
+  m_textureName = BlockCompressor::createFromFile("textures/ratGrid.png", BlockFormat::BC1, CompressionQuality::High, compressed, bytes);
+  std::cout << "ratGrid.png " << (compressed ? BlockCompressor::name(BlockFormat::BC1) : "RGBA8") << ' ' << bytes / 1024 << " KB\n";
   ngl::VAOPrimitives::createSphere("sphere", 1.0, 40);
   ngl::VAOPrimitives::createCylinder("cylinder", 0.5, 5, 30, 30);
   ngl::VAOPrimitives::createCone("cone", 0.5, 1.4f, 20, 20);
@@ -109,14 +118,17 @@ void NGLScene::initializeGL()
 
 void NGLScene::loadMatricesToShader()
 {
-  ngl::ShaderLib::use("TextureShader");
-
-  ngl::Mat4 MVP = m_project * m_view * m_mouseGlobalTX;
-  ngl::ShaderLib::setUniform("MVP", MVP);
+  // one object a frame, the camera and object blocks go up in a single buffer write
+  m_uniforms.beginFrame(m_view, m_project);
+  size_t object = m_uniforms.addObject(m_mouseGlobalTX);
+  m_uniforms.upload();
+  m_uniforms.bindObject(object);
 }
 
 void NGLScene::paintGL()
 {
+  m_profiler.beginFrame();
+  m_profiler.beginPass("scene");
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_width, m_height);
@@ -136,6 +148,13 @@ void NGLScene::paintGL()
 
   loadMatricesToShader();
   ngl::VAOPrimitives::draw(s_vboNames[m_primIndex]);
+  m_uniforms.endFrame();
+  m_profiler.endFrame();
+  // no text overlay in this demo, the statistics go in the title, refreshed once a second rather than every frame
+  if (m_profiler.summaryDue())
+  {
+    setTitle(QString::fromStdString("Simple OpenGL Texture | " + m_profiler.summary()));
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -256,6 +275,10 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N:
     showNormal();
     break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("PrimitivesProfile.csv");
+    break;
   case Qt::Key_Left:
     previousPrim();
     break;
@@ -287,3 +310,12 @@ void NGLScene::previousPrim()
     m_primIndex = 0;
   }
 }
+
+void NGLScene::timerEvent(QTimerEvent *_event)
+{
+  if (_event->timerId() == m_redrawTimer)
+  {
+    // re-draw GL
+    update();
+  }
+}
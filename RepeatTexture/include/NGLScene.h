@@ -4,6 +4,8 @@
 #include <ngl/Mat4.h>
 #include <ngl/Text.h>
 #include <QOpenGLWindow>
+#include "FrameProfiler.h"
+#include "FrameUniforms.h"
 #include <QTime>
 #include <memory>
 
@@ -105,6 +107,15 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     void loadMatricesToShader();
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief camera and object matrices as uniform buffers rather than named uniforms
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameUniforms m_uniforms;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frame, CPU and GPU times of the "scene" pass shown in the window title, P records them to
+    /// RepeatTextureProfile.csv
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameProfiler m_profiler;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief load the texture
     //----------------------------------------------------------------------------------------------------------------------
     void loadTexture();
@@ -1,11 +1,12 @@
 #include <QMouseEvent>
 #include <QGuiApplication>
 #include "NGLScene.h"
+#include "Assets.h"
+#include "BlockCompressor.h"
 #include <ngl/Transformation.h>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
-#include <ngl/Texture.h>
 #include <iostream>
 
 //#include <QGLWidget>
@@ -32,8 +33,11 @@ NGLScene::NGLScene()
 
 void NGLScene::loadTexture()
 {
-  ngl::Texture t("textures/Road.png");
-  m_textureName = t.setTextureGL();
+  // BC1 where the context has S3TC, RGBA8 otherwise, the size printed is of whichever was uploaded
+  bool compressed = false;
+  size_t bytes = 0;
+  m_textureName = BlockCompressor::createFromFile("textures/Road.png", BlockFormat::BC1, CompressionQuality::High, compressed, bytes);
+  std::cout << "Road.png " << (compressed ? BlockCompressor::name(BlockFormat::BC1) : "RGBA8") << ' ' << bytes / 1024 << " KB\n";
 }
 
 NGLScene::~NGLScene()
@@ -55,6 +59,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("RepeatTexture.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -79,8 +85,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("SimpleVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("SimpleFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("SimpleVertex");
   ngl::ShaderLib::compileShader("SimpleFragment");
@@ -88,6 +94,7 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "SimpleFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("TextureShader"));
   ngl::ShaderLib::use("TextureShader");
 
   // now pass the modelView and projection values to the shader
@@ -105,13 +112,17 @@ void NGLScene::initializeGL()
 
 void NGLScene::loadMatricesToShader()
 {
-
-  ngl::Mat4 MVP = m_project * m_view * m_mouseGlobalTX;
-  ngl::ShaderLib::setUniform("MVP", MVP);
+  // one object a frame, the camera and object blocks go up in a single buffer write
+  m_uniforms.beginFrame(m_view, m_project);
+  size_t object = m_uniforms.addObject(m_mouseGlobalTX);
+  m_uniforms.upload();
+  m_uniforms.bindObject(object);
 }
 
 void NGLScene::paintGL()
 {
+  m_profiler.beginFrame();
+  m_profiler.beginPass("scene");
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_width, m_height);
@@ -134,6 +145,13 @@ void NGLScene::paintGL()
 
   loadMatricesToShader();
   ngl::VAOPrimitives::draw("plane");
+  m_uniforms.endFrame();
+  m_profiler.endFrame();
+  // no text overlay in this demo, the statistics go in the title, refreshed once a second rather than every frame
+  if (m_profiler.summaryDue())
+  {
+    setTitle(QString::fromStdString("Simple OpenGL Texture | " + m_profiler.summary()));
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -254,6 +272,10 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N:
     showNormal();
     break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("RepeatTextureProfile.csv");
+    break;
   case Qt::Key_Minus:
     incrementSpeed();
     break;
@@ -3,7 +3,9 @@
 #include <ngl/Transformation.h>
 #include <ngl/Text.h>
 #include <QOpenGLWindow>
-#include <QTime>
+#include "FrameProfiler.h"
+#include "FrameUniforms.h"
+#include "MeshBuilder.h"
 #include <memory>
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -103,9 +105,9 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     ngl::Vec3 m_modelPos;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief method to load transform matrices to the shader
+    /// @brief camera and per cube matrices, uploaded once a frame
     //----------------------------------------------------------------------------------------------------------------------
-    void loadMatricesToShader();
+    FrameUniforms m_uniforms;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
@@ -140,13 +142,14 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     void createCube( GLfloat _scale );
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief timer event used for the fps counter
+    /// @brief timer event used to redraw continuously
     //----------------------------------------------------------------------------------------------------------------------
     void timerEvent(QTimerEvent *) override;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief ID for the cube VAO
+    /// @brief ID for the cube VAO, m_cube.vao of the indexed interleaved cube
     //----------------------------------------------------------------------------------------------------------------------
     GLuint m_vaoID;
+    Mesh m_cube;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief load the texture and store the id in m_textureName
     //----------------------------------------------------------------------------------------------------------------------
@@ -158,21 +161,17 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     GLenum m_polyMode;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief flag for the fps timer
+    /// @brief id of the timer that redraws continuously
     //----------------------------------------------------------------------------------------------------------------------
-    int m_fpsTimer;
+    int m_redrawTimer;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief the fps to draw
+    /// @brief frame, CPU and GPU times with a "cubes" and an "overlay" pass, P records them to ShowMipMapProfile.csv
     //----------------------------------------------------------------------------------------------------------------------
-    int m_fps;
+    FrameProfiler m_profiler;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief frame counter
+    /// @brief our font / text
     //----------------------------------------------------------------------------------------------------------------------
-    int m_frames;
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief timer used for FPS counting
-    //----------------------------------------------------------------------------------------------------------------------
-    QTime m_timer;
+    std::unique_ptr<ngl::Text> m_text;
 
 };
 
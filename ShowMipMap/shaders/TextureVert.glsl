@@ -1,7 +1,12 @@
 #version 330 core
 
-/// @brief MVP passed from app
-uniform mat4 MVP;
+// per object matrices from the FrameUniforms ring buffer (binding 1)
+layout(std140) uniform ObjectData
+{
+  mat4 model;
+  mat4 MVP;
+  mat3 normalMatrix;
+};
 // first attribute the vertex values from our VAO
 layout (location=0) in vec3 inVert;
 // second attribute the UV values from our VAO
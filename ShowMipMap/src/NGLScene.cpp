@@ -1,6 +1,9 @@
 #include <QMouseEvent>
 #include <QGuiApplication>
 #include "NGLScene.h"
+#include "Assets.h"
+#include "MeshBuilder.h"
+#include "TextureStorage.h"
 #include <ngl/Transformation.h>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
@@ -27,10 +30,7 @@ NGLScene::NGLScene()
   m_spinXFace = 0;
   m_spinYFace = 0;
   setTitle("Simple OpenGL Texture");
-  m_fpsTimer = startTimer(0);
-  m_fps = 0;
-  m_frames = 0;
-  // m_timer.start();
+  m_redrawTimer = startTimer(0);
   m_polyMode = GL_FILL;
 }
 
@@ -38,9 +38,11 @@ void NGLScene::loadTexture()
 {
 
   int mipLevel = 0;
-
-  glGenTextures(1, &m_textureName);
-  glBindTexture(GL_TEXTURE_2D, m_textureName);
+  SamplerState sampler;
+  sampler.magFilter = GL_NEAREST;
+  sampler.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+  // 128 down to 4 is 6 levels, all allocated up front and filled one by one below
+  m_textureName = TextureStorage::create(GL_TEXTURE_2D, 6, GL_RGB8, 128, 128, 1, sampler);
   // using an image width of 128 gives us 6 mip levels so need 6 colours;
   std::array<ngl::Vec3, 6> colours = {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}}};
   for (int ml = 128; ml >= 4; ml /= 2)
@@ -52,18 +54,14 @@ void NGLScene::loadTexture()
     {
       c = colours[mipLevel];
     }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, mipLevel, GL_RGB, ml, ml, 0, GL_RGB, GL_FLOAT, &data[0].m_r);
+    TextureStorage::upload(GL_TEXTURE_2D, m_textureName, mipLevel, 0, ml, ml, 1, GL_RGB, GL_FLOAT, &data[0].m_r);
 
     ++mipLevel;
   }
   //  glGenerateMipmap(GL_TEXTURE_2D);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevel - 1);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LOD, mipLevel - 1);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
+  TextureStorage::setParameter(GL_TEXTURE_2D, m_textureName, GL_TEXTURE_BASE_LEVEL, 0);
+  TextureStorage::setParameter(GL_TEXTURE_2D, m_textureName, GL_TEXTURE_MAX_LEVEL, mipLevel - 1);
+  TextureStorage::setParameter(GL_TEXTURE_2D, m_textureName, GL_TEXTURE_MAX_LOD, GLfloat(mipLevel - 1));
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -92,34 +90,16 @@ void NGLScene::createCube(GLfloat _scale)
 
   };
 
-  std::cout << sizeof(vertices) / sizeof(GLfloat) << "\n";
-  // first we scale our vertices to _scale
-  for (uint i = 0; i < sizeof(vertices) / sizeof(GLfloat); ++i)
+  // each corner goes in as position + UV, the builder shares repeated corners and writes one interleaved VBO. The
+  // UVs are 0 or 1 so half floats hold them exactly, 16 bytes a vertex rather than 20
+  MeshBuilder builder(VertexLayout({{0, 3, AttributeFormat::Float}, {1, 2, AttributeFormat::HalfFloat}}));
+  for (size_t corner = 0; corner < sizeof(texture) / (2 * sizeof(GLfloat)); ++corner)
   {
-    vertices[i] *= _scale;
+    builder.addVertex({vertices[3 * corner] * _scale, vertices[3 * corner + 1] * _scale, vertices[3 * corner + 2] * _scale,
+                       texture[2 * corner], texture[2 * corner + 1]});
   }
-
-  // first we create a vertex array Object
-  glGenVertexArrays(1, &m_vaoID);
-
-  // now bind this to be the currently active one
-  glBindVertexArray(m_vaoID);
-  // now we create two VBO's one for each of the objects these are only used here
-  // as they will be associated with the vertex array object
-  GLuint vboID[2];
-  glGenBuffers(2, &vboID[0]);
-  // now we will bind an array buffer to the first one and load the data for the verts
-  glBindBuffer(GL_ARRAY_BUFFER, vboID[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices) * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
-  // now we bind the vertex attribute pointer for this object in this case the
-  // vertex data
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(0);
-  // now we repeat for the UV data using the second VBO
-  glBindBuffer(GL_ARRAY_BUFFER, vboID[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(texture) * sizeof(GLfloat), texture, GL_STATIC_DRAW);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(1);
+  m_cube = builder.upload();
+  m_vaoID = m_cube.vao;
 }
 
 NGLScene::~NGLScene()
@@ -127,6 +107,7 @@ NGLScene::~NGLScene()
   std::cout << "Shutting down NGL, removing VAO's and Shaders\n";
   // remove the texture now we are done
   glDeleteTextures(1, &m_textureName);
+  m_cube.release();
 }
 
 void NGLScene::resizeGL(int _w, int _h)
@@ -134,6 +115,7 @@ void NGLScene::resizeGL(int _w, int _h)
   m_project = ngl::perspective(45.0f, (float)_w / _h, 0.05f, 350.0f);
   m_width = _w * devicePixelRatio();
   m_height = _h * devicePixelRatio();
+  m_text->setScreenSize(_w, _h);
 }
 
 void NGLScene::initializeGL()
@@ -141,6 +123,8 @@ void NGLScene::initializeGL()
   // we must call this first before any other GL commands to load and link the
   // gl commands from the lib, if this is not done program will crash
   ngl::NGLInit::initialize();
+  // all the shaders / textures are packed into one archive at build time
+  Assets::mount("ShowMipMap.assets");
 
   glClearColor(0.4f, 0.4f, 0.4f, 1.0f); // Grey Background
   // enable depth testing for drawing
@@ -163,8 +147,8 @@ void NGLScene::initializeGL()
 
   ngl::ShaderLib::attachShader("SimpleVertex", ngl::ShaderType::VERTEX);
   ngl::ShaderLib::attachShader("SimpleFragment", ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
-  ngl::ShaderLib::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
+  Assets::loadShaderSource("SimpleVertex", "shaders/TextureVert.glsl");
+  Assets::loadShaderSource("SimpleFragment", "shaders/TextureFrag.glsl");
 
   ngl::ShaderLib::compileShader("SimpleVertex");
   ngl::ShaderLib::compileShader("SimpleFragment");
@@ -172,23 +156,18 @@ void NGLScene::initializeGL()
   ngl::ShaderLib::attachShaderToProgram("TextureShader", "SimpleFragment");
 
   ngl::ShaderLib::linkProgramObject("TextureShader");
+  FrameUniforms::bindBlocks(ngl::ShaderLib::getProgramID("TextureShader"));
   ngl::ShaderLib::use("TextureShader");
 
   createCube(0.2f);
   loadTexture();
-}
-
-void NGLScene::loadMatricesToShader()
-{
-  ngl::Mat4 MVP = m_project * m_view *
-                  m_mouseGlobalTX *
-                  m_transform.getMatrix();
-
-  ngl::ShaderLib::setUniform("MVP", MVP);
+  m_text = std::make_unique<ngl::Text>("fonts/Arial.ttf", 14);
+  m_text->setScreenSize(width(), height());
 }
 
 void NGLScene::paintGL()
 {
+  m_profiler.beginFrame();
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_width, m_height);
@@ -206,11 +185,15 @@ void NGLScene::paintGL()
   // now we bind back our vertex array object and draw
   glBindVertexArray(m_vaoID); // select first VAO
 
+  m_profiler.beginPass("cubes");
   int instances = 0;
   // need to bind the active texture before drawing
   glBindTexture(GL_TEXTURE_2D, m_textureName);
   glPolygonMode(GL_FRONT_AND_BACK, m_polyMode);
 
+  // queue every cube first so all the matrices go up in one buffer write, each draw then only moves the
+  // ObjectData binding to its slot
+  m_uniforms.beginFrame(m_view, m_project);
   for (float z = -34; z < 35; z += 0.5)
   {
     for (float x = -34; x < 35; x += 0.5)
@@ -219,15 +202,24 @@ void NGLScene::paintGL()
       {
         m_transform.setRotation(x * 20.0f, (x * z) * 40.0f, z * 2.0f);
         m_transform.setPosition(x, 0.49f, z);
-        loadMatricesToShader();
-        ++instances;
-        glDrawArrays(GL_TRIANGLES, 0, 36); // draw object
+        m_uniforms.addObject(m_mouseGlobalTX * m_transform.getMatrix());
       }
     }
   }
-  // calculate and draw FPS
-  ++m_frames;
+  m_uniforms.upload();
+  for (size_t i = 0; i < m_uniforms.numObjects(); ++i)
+  {
+    m_uniforms.bindObject(i);
+    ++instances;
+    glDrawElements(GL_TRIANGLES, m_cube.numIndices, m_cube.indexType, nullptr); // draw object
+  }
+  m_uniforms.endFrame();
+  m_profiler.beginPass("overlay");
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  m_text->setColour(1.0f, 1.0f, 0.0f);
+  m_text->renderText(10, 700, fmt::format("Show Mip Map Demo {} cubes", instances));
+  m_profiler.draw(*m_text, 10, 680);
+  m_profiler.endFrame();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -348,6 +340,10 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N:
     showNormal();
     break;
+  // start / stop recording per frame timings
+  case Qt::Key_P:
+    m_profiler.toggleRecording("ShowMipMapProfile.csv");
+    break;
   default:
     break;
   }
@@ -358,15 +354,9 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
 
 void NGLScene::timerEvent(QTimerEvent *_event)
 {
-  // if(_event->timerId() == m_fpsTimer)
-  // 	{
-  // 		if( m_timer.elapsed() > 1000.0)
-  // 		{
-  // 			m_fps=m_frames;
-  // 			m_frames=0;
-  // 			m_timer.restart();
-  // 		}
-  // 	 }
-  // re-draw GL
-  update();
+  if (_event->timerId() == m_redrawTimer)
+  {
+    // re-draw GL
+    update();
+  }
 }